@@ -12,3 +12,9 @@ export 'src/gpu_print.dart';
 export 'src/gpu_pooling.dart';
 export 'src/gpu_ops.dart';
 export 'src/gpu_linear_ops.dart';
+export 'src/gpu_normalization.dart';
+export 'src/gpu_quant.dart';
+export 'src/gpu_random.dart' show TensorRandom;
+export 'src/gpu_scan.dart';
+export 'src/gpu_sort.dart';
+export 'src/gpu_warmup.dart';
@@ -1,141 +1,57 @@
 import 'package:minigpu/minigpu.dart';
 import '../gpu_tensor.dart';
+import 'gpu_kernel.dart';
+
+/// Activation applied in the epilogue of fused ops such as
+/// [TensorLinearOperator.linear]. [wgsl] maps the pre-activation `x` to the
+/// output value.
+enum Activation {
+  none('x'),
+  relu('max(x, 0.0)'),
+  sigmoid('1.0 / (1.0 + exp(-x))'),
+  tanh('tanh(x)'),
+  // Tanh approximation, as used by GPT-style MLPs.
+  gelu('0.5 * x * (1.0 + tanh(0.7978845608 * (x + 0.044715 * x * x * x)))');
+
+  const Activation(this.wgsl);
+
+  final String wgsl;
+}
 
 extension GpuActivation on Tensor {
   /// Applies the ReLU activation function elementwise.
   Future<Tensor> relu() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
-@group(0) @binding(1) var<storage, read_write> output: array<f32>;
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    let v: f32 = input[i];
-    output[i] = select(v, 0.0, v < 0.0);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'select(a, 0.0, a < 0.0)');
   }
 
   /// Applies the Sigmoid activation function elementwise.
   Future<Tensor> sigmoid() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
-@group(0) @binding(1) var<storage, read_write> output: array<f32>;
-
+    return elementwise(gpu, [this], shape, 'sigmoid(a)', helpers: '''
 fn sigmoid(x: f32) -> f32 {
   return 1.0 / (1.0 + exp(-x));
 }
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    output[i] = sigmoid(input[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+''');
   }
 
   /// Computes the sine of each element.
   Future<Tensor> sin() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if(i < ${size}u) {
-    B[i] = sin(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int wk = (size + 255) ~/ 256;
-    await shader.dispatch(wk, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'sin(a)');
   }
 
   /// Computes the cosine of each element.
   Future<Tensor> cos() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if(i < ${size}u) {
-    B[i] = cos(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int wk = (size + 255) ~/ 256;
-    await shader.dispatch(wk, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'cos(a)');
   }
 
   /// Applies the Tanh activation function elementwise.
   Future<Tensor> tanh() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
-@group(0) @binding(1) var<storage, read_write> output: array<f32>;
-
+    return elementwise(gpu, [this], shape, 'tanh_func(a)', helpers: '''
 fn tanh_func(x: f32) -> f32 {
   let expPos = exp(x);
   let expNeg = exp(-x);
   return (expPos - expNeg) / (expPos + expNeg);
 }
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    output[i] = tanh_func(input[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+''');
   }
 
   /// Applies the Softmax activation function along the last dimension.
@@ -152,40 +68,37 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
     }
     Tensor result = await Tensor.create(shape);
     final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> input: array<${wgslArrayType(this)}>;
 @group(0) @binding(1) var<storage, read_write> output: array<f32>;
 
+${wgslLoadFn('load_in', 'input', this)}
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let global: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let global: u32 = $wgslLinearIndex;
   if (global < ${total}u) {
     let d: u32 = ${d}u;
     let batchIndex: u32 = global / d;
     let offset: u32 = batchIndex * d;
     
     // Compute maximum value within this softmax group.
-    var max_val: f32 = input[offset];
+    var max_val: f32 = load_in(offset);
     for (var j: u32 = 1u; j < d; j = j + 1u) {
-      max_val = max(max_val, input[offset + j]);
+      max_val = max(max_val, load_in(offset + j));
     }
     
-    let shifted: f32 = input[global] - max_val;
+    let shifted: f32 = load_in(global) - max_val;
     let exp_val: f32 = exp(shifted);
     var sum_exp: f32 = 0.0;
     for (var j: u32 = 0u; j < d; j = j + 1u) {
-      sum_exp = sum_exp + exp(input[offset + j] - max_val);
+      sum_exp = sum_exp + exp(load_in(offset + j) - max_val);
     }
     output[global] = exp_val / sum_exp;
   }
 }
 ''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
     int workgroups = (total + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], workgroups);
     return result;
   }
 }
@@ -1,31 +1,39 @@
 import 'dart:typed_data';
 import 'package:minigpu/minigpu.dart';
 
+import 'gpu_kernel.dart';
 import 'gpu_tensor_base.dart';
 
 extension TensorData on Tensor {
   /// Creates a new tensor by slicing the flattened tensor data.
   /// [start] is the starting flat index and [end] is the ending flat index (exclusive).
+  ///
+  /// Row-major tensors are sliced without copying: the result is a 1D view
+  /// sharing this tensor's buffer.
   Future<Tensor> sliceLinear({required int start, required int end}) async {
     if (start < 0 || end > size || start >= end) {
       throw Exception(
           "Invalid slice indices: start=$start, end=$end, size=$size.");
     }
     int newSize = end - start;
-    // Create a temporary CPU buffer to hold the sliced data.
-    final slicedData = Float32List(newSize);
-    // Use the buffer's read method using the flat offset.
-    await buffer.read(slicedData, newSize, readOffset: start);
-    // Create and return a new tensor from the sliced data.
-    // Here we assume a 1D shape for the sliced tensor.
-    return await Tensor.create([newSize], data: slicedData, gpu: gpu);
+    if (isRowMajor) {
+      return Tensor.fromBuffer(buffer, [newSize],
+          gpu: gpu, offset: offset + start, dtype: dtype);
+    }
+    // Strided views have no flat order in memory; gather them first.
+    final Tensor dense = await contiguous();
+    final Tensor view = Tensor.fromBuffer(dense.buffer, [newSize],
+        gpu: gpu, offset: start, dtype: dtype);
+    // The view keeps the gathered buffer alive on its own.
+    dense.destroy();
+    return view;
   }
 
   /// Slices the tensor based on multi-dimensional indices.
   ///
   /// [startIndices] and [endIndices] specify the lower (inclusive) and upper (exclusive)
-  /// bounds for each dimension. The function computes the flat offset and the total number
-  /// of elements to transfer based on the tensor's shape.
+  /// bounds for each dimension. The result is a view sharing this tensor's
+  /// buffer: only the shape and base offset change.
   Future<Tensor> slice({
     required List<int> startIndices,
     required List<int> endIndices,
@@ -36,14 +44,8 @@ extension TensorData on Tensor {
           "startIndices and endIndices must match tensor rank (${shape.length}).");
     }
 
-    // Calculate strides for the tensor.
-    List<int> strides = List.filled(shape.length, 1);
-    for (int i = shape.length - 2; i >= 0; i--) {
-      strides[i] = strides[i + 1] * shape[i + 1];
-    }
-
-    // Compute the flat offset from multi-dimensional indices.
-    int flatOffset = 0;
+    // Compute the view offset from multi-dimensional indices.
+    int viewOffset = offset;
     for (int i = 0; i < shape.length; i++) {
       if (startIndices[i] < 0 ||
           endIndices[i] > shape[i] ||
@@ -51,43 +53,29 @@ extension TensorData on Tensor {
         throw Exception(
             "Invalid slice indices for dimension $i: start=${startIndices[i]}, end=${endIndices[i]}, shape=${shape[i]}.");
       }
-      flatOffset += startIndices[i] * strides[i];
+      viewOffset += startIndices[i] * strides[i];
     }
 
-    // Compute the new shape and the total number of elements to read.
+    // Compute the new shape; strides are inherited unchanged.
     List<int> newShape = [];
-    int numElems = 1;
     for (int i = 0; i < shape.length; i++) {
-      int dimSize = endIndices[i] - startIndices[i];
-      newShape.add(dimSize);
-      numElems *= dimSize;
+      newShape.add(endIndices[i] - startIndices[i]);
     }
-
-    // Read only the necessary portion from the GPU buffer.
-    final slicedData = Float32List(numElems);
-    await buffer.read(slicedData, numElems, readOffset: flatOffset);
-
-    // Create and return the new tensor from the sliced data.
-    return await Tensor.create(newShape, data: slicedData, gpu: gpu);
+    return Tensor.fromBuffer(buffer, newShape,
+        gpu: gpu,
+        strides: List<int>.from(strides),
+        offset: viewOffset,
+        dtype: dtype);
   }
 
-  /// Returns the value of the tensor element at the given [indices].
-  /// Throws an exception if the [indices] length does not match the tensor rank
-  /// or if any index is out of bounds.
-  Future<double> getElement(List<int> indices) async {
+  /// Buffer position of the element at [indices], validating them against
+  /// the shape.
+  int _bufferIndex(List<int> indices) {
     if (indices.length != shape.length) {
       throw Exception(
           "Indices length (${indices.length}) does not match tensor rank (${shape.length}).");
     }
-
-    // Calculate strides for the tensor (assumes row-major order).
-    List<int> strides = List.filled(shape.length, 1);
-    for (int i = shape.length - 2; i >= 0; i--) {
-      strides[i] = strides[i + 1] * shape[i + 1];
-    }
-
-    // Compute the flat offset from multi-dimensional indices.
-    int flatIndex = 0;
+    int flatIndex = offset;
     for (int i = 0; i < shape.length; i++) {
       if (indices[i] < 0 || indices[i] >= shape[i]) {
         throw Exception(
@@ -95,6 +83,28 @@ extension TensorData on Tensor {
       }
       flatIndex += indices[i] * strides[i];
     }
+    return flatIndex;
+  }
+
+  /// Uploads the buffer positions of [indices] as a u32 buffer.
+  Buffer _uploadPositions(List<List<int>> indices) {
+    final positions = Uint32List(indices.length);
+    for (int i = 0; i < indices.length; i++) {
+      positions[i] = _bufferIndex(indices[i]);
+    }
+    final Buffer buffer = gpu.createBuffer(positions.length * 4);
+    buffer.setData(positions.buffer.asFloat32List(), positions.length);
+    return buffer;
+  }
+
+  /// Returns the value of the tensor element at the given [indices].
+  /// Throws an exception if the [indices] length does not match the tensor rank
+  /// or if any index is out of bounds.
+  Future<double> getElement(List<int> indices) async {
+    final int flatIndex = _bufferIndex(indices);
+    if (dtype != DType.f32) {
+      return (await getElements([indices]))[0];
+    }
 
     // Instead of pulling the entire tensor data, allocate a small
     // buffer to hold only the required single element.
@@ -103,56 +113,99 @@ extension TensorData on Tensor {
     return elementData[0];
   }
 
+  /// Returns the elements at each of [indices], in order.
+  ///
+  /// The buffer positions are uploaded once and one gather kernel packs the
+  /// elements into a dense buffer, which is read back in a single transfer.
+  /// The kernel does not depend on the indices, so it is compiled once.
+  Future<Float32List> getElements(List<List<int>> indices) async {
+    if (indices.isEmpty) return Float32List(0);
+    final Float32List data = gpu.allocHostBuffer(indices.length);
+    final Buffer positions = _uploadPositions(indices);
+    final Buffer gathered = gpu.createBuffer(indices.length * 4);
+    final shaderCode = '''
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> P: array<u32>;
+@group(0) @binding(2) var<storage, read_write> Out: array<f32>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < arrayLength(&P)) {
+    Out[i] = ${wgslBufferRead('A', 'P[i]', this)};
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, [buffer, positions, gathered],
+        (indices.length + 255) ~/ 256);
+    await gathered.read(data, indices.length);
+    positions.destroy();
+    gathered.destroy();
+    return data;
+  }
+
   /// Sets the value of the tensor element at the given [indices] to [value].
   /// Throws an exception if the [indices] length does not match the tensor rank
   /// or if any index is out of bounds.
-  Future<void> setElement(List<int> indices, double value) async {
-    if (indices.length != shape.length) {
-      throw Exception(
-          "Indices length (${indices.length}) does not match tensor rank (${shape.length}).");
-    }
-    // Calculate strides for the tensor (assumes row-major order).
-    List<int> strides = List.filled(shape.length, 1);
-    for (int i = shape.length - 2; i >= 0; i--) {
-      strides[i] = strides[i + 1] * shape[i + 1];
-    }
-    // Compute the flat offset from multi-dimensional indices.
-    int flatIndex = 0;
-    for (int i = 0; i < shape.length; i++) {
-      if (indices[i] < 0 || indices[i] >= shape[i]) {
-        throw Exception(
-            "Index out of bounds for dimension $i: ${indices[i]} not in [0, ${shape[i] - 1}].");
-      }
-      flatIndex += indices[i] * strides[i];
-    }
+  Future<void> setElement(List<int> indices, double value) =>
+      setElements([indices], Float32List.fromList([value]));
 
-    // Create a compute shader that writes the given value at the computed flat index.
-    final shaderCode = '''
+  /// Writes `values[i]` to the element at `indices[i]` for every `i`.
+  ///
+  /// The buffer positions and values are uploaded once and scattered by one
+  /// kernel, which does not depend on them and so is compiled only once. If
+  /// the same element appears more than once, which write lands is
+  /// unspecified.
+  Future<void> setElements(
+      List<List<int>> indices, List<double> values) async {
+    requireF32(this);
+    if (values.length != indices.length) {
+      throw Exception("Got ${values.length} values for ${indices.length} "
+          "indices.");
+    }
+    if (indices.isEmpty) return;
+    final Buffer positions = _uploadPositions(indices);
+    final Buffer scattered = gpu.createBuffer(values.length * 4);
+    scattered.setData(
+        values is Float32List ? values : Float32List.fromList(values),
+        values.length);
+    const shaderCode = '''
 @group(0) @binding(0) var<storage, read_write> A: array<f32>;
-  
-@compute @workgroup_size(1)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  A[${flatIndex}u] = $value;
+@group(0) @binding(1) var<storage, read_write> P: array<u32>;
+@group(0) @binding(2) var<storage, read_write> V: array<f32>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < arrayLength(&P)) {
+    A[P[i]] = V[i];
+  }
 }
 ''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    // IMPORTANT: Bind the tensor's GPU buffer to the shader.
-    shader.setBuffer('A', buffer);
-    // Dispatch a single workgroup (1,1,1) to perform the write.
-    await shader.dispatch(1, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, positions, scattered],
+        (indices.length + 255) ~/ 256);
+    positions.destroy();
+    scattered.destroy();
   }
 
   /// Reshapes the tensor into a new shape without changing the underlying data.
-  /// Throws an exception if the total number of elements would differ.
+  /// Throws an exception if the total number of elements would differ, or if
+  /// this is a strided view whose elements are not laid out in row-major order
+  /// (call [contiguous] first).
   Tensor reshape(List<int> newShape) {
     int newSize = newShape.reduce((a, b) => a * b);
     if (newSize != size) {
       throw Exception(
           "New shape $newShape does not match total number of elements $size");
     }
-    return Tensor.fromBuffer(buffer, newShape);
+    if (!isRowMajor) {
+      throw Exception(
+          "Cannot reshape a non row-major view; call contiguous() first.");
+    }
+    return Tensor.fromBuffer(buffer, newShape,
+        gpu: gpu, offset: offset, dtype: dtype);
   }
 
   /// Transposes a tensor according to the given [axes] permutation.
@@ -160,10 +213,18 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
   /// For example, for a tensor with shape [2,3,4]:
   ///   - transpose() produces a tensor with shape [4,3,2].
   ///   - transpose(axes: [1,0,2]) swaps the first two dimensions producing shape [3,2,4].
+  ///
+  /// The result is a view; no data is moved. See [permute].
   Future<Tensor> transpose({List<int>? axes}) async {
     final int rank = shape.length;
     // Use reverse order if no permutation is provided.
     axes ??= List<int>.generate(rank, (i) => rank - i - 1);
+    return permute(axes);
+  }
+
+  /// Returns a view with the dimensions reordered so that dimension `i` of the
+  /// result is dimension `axes[i]` of this tensor.
+  Tensor permute(List<int> axes) {
     if (axes.length != rank) {
       throw Exception(
           "Axes length (${axes.length}) must equal tensor rank ($rank).");
@@ -175,80 +236,169 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
         throw Exception("Invalid axes permutation: $axes.");
       }
     }
+    return Tensor.fromBuffer(buffer, axes.map((i) => shape[i]).toList(),
+        gpu: gpu,
+        strides: axes.map((i) => strides[i]).toList(),
+        offset: offset,
+        dtype: dtype);
+  }
 
-    // Compute the new shape.
-    List<int> newShape = axes.map((i) => shape[i]).toList();
-    // Compute total number of elements of the output.
-    final int outSize = newShape.fold(1, (prod, e) => prod * e);
-
-    // Compute input strides (row-major layout) for the original tensor.
-    List<int> inputStrides = List.filled(rank, 1);
-    for (int i = rank - 2; i >= 0; i--) {
-      inputStrides[i] = inputStrides[i + 1] * shape[i + 1];
+  /// Returns a view broadcasting this tensor to [newShape] without copying.
+  ///
+  /// Follows NumPy rules: dimensions are aligned from the right, size-1
+  /// dimensions may be expanded to any size and new leading dimensions may be
+  /// added. Expanded dimensions get a stride of 0.
+  Tensor expand(List<int> newShape) {
+    if (newShape.length < rank) {
+      throw Exception("Cannot expand shape $shape to lower rank $newShape.");
     }
-
-    // Compute factors for unraveling an output flat index into indices in [newShape].
-    // outFactors[i] = product(newShape[i+1:]) with outFactors[last] = 1.
-    List<int> outFactors = List.filled(rank, 1);
+    final int lead = newShape.length - rank;
+    List<int> newStrides = List.filled(newShape.length, 0);
     for (int i = 0; i < rank; i++) {
-      int prod = 1;
-      for (int j = i + 1; j < rank; j++) {
-        prod *= newShape[j];
+      if (shape[i] == newShape[lead + i]) {
+        newStrides[lead + i] = strides[i];
+      } else if (shape[i] != 1) {
+        throw Exception("Cannot expand shape $shape to $newShape.");
+      }
+    }
+    return Tensor.fromBuffer(buffer, List<int>.from(newShape),
+        gpu: gpu, strides: newStrides, offset: offset, dtype: dtype);
+  }
+
+  /// Returns a view without size-1 dimensions. With [axis], only that
+  /// dimension is removed (it must have size 1). A tensor never drops below
+  /// rank 1.
+  Tensor squeeze({int? axis}) {
+    List<int> keep;
+    if (axis != null) {
+      if (axis < 0) axis += rank;
+      if (axis < 0 || axis >= rank || shape[axis] != 1) {
+        throw Exception("Cannot squeeze axis $axis of shape $shape.");
       }
-      outFactors[i] = prod;
+      keep = [
+        for (int i = 0; i < rank; i++)
+          if (i != axis) i
+      ];
+    } else {
+      keep = [
+        for (int i = 0; i < rank; i++)
+          if (shape[i] != 1) i
+      ];
+    }
+    if (keep.isEmpty) keep = [rank - 1];
+    return Tensor.fromBuffer(buffer, keep.map((i) => shape[i]).toList(),
+        gpu: gpu,
+        strides: keep.map((i) => strides[i]).toList(),
+        offset: offset,
+        dtype: dtype);
+  }
+
+  /// Returns a view with a size-1 dimension inserted at [axis].
+  Tensor unsqueeze(int axis) {
+    if (axis < 0) axis += rank + 1;
+    if (axis < 0 || axis > rank) {
+      throw Exception("Cannot unsqueeze axis $axis of shape $shape.");
+    }
+    return Tensor.fromBuffer(buffer, List<int>.from(shape)..insert(axis, 1),
+        gpu: gpu,
+        strides: List<int>.from(strides)..insert(axis, 0),
+        offset: offset,
+        dtype: dtype);
+  }
+
+  /// Returns a dense row-major copy of this tensor, or the tensor itself when
+  /// it already is one.
+  ///
+  /// When the view's fastest-moving source dimension differs from the
+  /// output's (e.g. after a transpose), the copy is staged through 32×32
+  /// workgroup tiles so that both the reads and the writes are coalesced.
+  /// Otherwise it is a plain strided gather.
+  Future<Tensor> contiguous() async {
+    if (isContiguous) return this;
+    if (dtype != DType.f32) {
+      // The tiled copy below moves raw f32 words.
+      return elementwise(gpu, [this], shape, 'a');
     }
 
-    // Compute the inverse permutation.
-    // For each original dimension d, find its new position: invPermutation[d] = j if axes[j] == d.
-    List<int> invPermutation = List.filled(rank, 0);
-    for (int j = 0; j < rank; j++) {
-      invPermutation[axes[j]] = j;
+    final collapsed = collapseDims(shape, strides);
+    final List<int> sizes = collapsed[0];
+    final List<int> steps = collapsed[1];
+    final int a = sizes.length - 1;
+    int b = -1;
+    for (int d = 0; d < a; d++) {
+      if (steps[d] != 0 && (b == -1 || steps[d] < steps[b])) b = d;
+    }
+    if (a < 1 || b == -1 || steps[a] <= steps[b]) {
+      return elementwise(gpu, [this], shape, 'a');
     }
 
-    // Helper to format integer lists as WGSL constant arrays.
-    String formatArray(List<int> arr) => arr.map((x) => "${x}u").join(", ");
+    final List<int> outStrides = Tensor.rowMajorStrides(sizes);
+    int outer = 1;
+    final sb = StringBuffer();
+    for (int d = a - 1; d >= 0; d--) {
+      if (d == b) continue;
+      outer *= sizes[d];
+      sb.writeln('  srcBase = srcBase + (rem % ${sizes[d]}u) * ${steps[d]}u;');
+      sb.writeln('  dstBase = dstBase + (rem % ${sizes[d]}u) * ${outStrides[d]}u;');
+      sb.writeln('  rem = rem / ${sizes[d]}u;');
+    }
 
+    final grid = WorkgroupGrid(
+        (sizes[a] + 31) ~/ 32, (sizes[b] + 31) ~/ 32, outer);
     final String shaderCode = '''
-const outSize : u32 = ${outSize}u;
-const rank : u32 = ${rank}u;
-const outFactors : array<u32, $rank> = array<u32, $rank>(${formatArray(outFactors)});
-const inputStrides : array<u32, $rank> = array<u32, $rank>(${formatArray(inputStrides)});
-const invPermutation : array<u32, $rank> = array<u32, $rank>(${formatArray(invPermutation)});
+const SA: u32 = ${sizes[a]}u;
+const SB: u32 = ${sizes[b]}u;
+const TA: u32 = ${steps[a]}u;
+const TB: u32 = ${steps[b]}u;
+const DB: u32 = ${outStrides[b]}u;
 
-@group(0) @binding(0) var<storage, read> input: array<f32>;
+@group(0) @binding(0) var<storage, read_write> input: array<f32>;
 @group(0) @binding(1) var<storage, read_write> output: array<f32>;
 
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) global_id: vec3<u32>) {
-  let i: u32 = global_id.x;
-  if (i >= outSize) {
-    return;
-  }
-  var remainder: u32 = i;
-  var outIndices: array<u32, rank>;
-  for (var j: u32 = 0u; j < rank; j = j + 1u) {
-    outIndices[j] = remainder / outFactors[j];
-    remainder = remainder % outFactors[j];
-  }
-  var inIndex: u32 = 0u;
-  // Reconstruct the input index using the inverse permutation.
-  for (var d: u32 = 0u; d < rank; d = d + 1u) {
-    let pos = outIndices[invPermutation[d]];
-    inIndex = inIndex + pos * inputStrides[d];
-  }
-  output[i] = input[inIndex];
+var<workgroup> tile: array<array<f32, 33>, 32>;
+
+@compute @workgroup_size(32, 8, 1)
+fn main(@builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+${grid.wgslGroupId}
+  var rem: u32 = wg.z;
+  var srcBase: u32 = ${offset}u;
+  var dstBase: u32 = 0u;
+${sb.toString()}
+  let aBase: u32 = wg.x * 32u;
+  let bBase: u32 = wg.y * 32u;
+  // Read with consecutive threads walking the source's fastest dimension.
+  for (var j: u32 = 0u; j < 32u; j = j + 8u) {
+    let aIdx: u32 = aBase + j + lid.y;
+    let bIdx: u32 = bBase + lid.x;
+    if (aIdx < SA && bIdx < SB) {
+      tile[j + lid.y][lid.x] = input[srcBase + bIdx * TB + aIdx * TA];
+    }
+  }
+  workgroupBarrier();
+  // Write with consecutive threads walking the output's fastest dimension.
+  for (var j: u32 = 0u; j < 32u; j = j + 8u) {
+    let aIdx: u32 = aBase + lid.x;
+    let bIdx: u32 = bBase + j + lid.y;
+    if (aIdx < SA && bIdx < SB) {
+      output[dstBase + bIdx * DB + aIdx] = tile[lid.x][j + lid.y];
+    }
+  }
 }
 ''';
 
-    Tensor result = await Tensor.create(newShape, gpu: gpu);
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer("input", buffer);
-    shader.setBuffer("output", result.buffer);
-    int wgCount = (outSize + 255) ~/ 256;
-    await shader.dispatch(wgCount, 1, 1);
-    shader.destroy();
+    Tensor result = await Tensor.create(shape, gpu: gpu);
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], grid.count);
 
     return result;
   }
+
+  /// Returns a dense copy of this tensor stored as [target], or the tensor
+  /// itself when it already has that dtype. Values are rounded to nearest
+  /// when narrowing to f16.
+  Future<Tensor> toDType(DType target) async {
+    if (dtype == target) return this;
+    return elementwise(gpu, [this], shape, 'a', dtype: target);
+  }
 }
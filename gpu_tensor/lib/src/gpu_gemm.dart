@@ -0,0 +1,247 @@
+/// Shared tiled GEMM kernel generator.
+///
+/// Every matrix-shaped op (matMul, implicit-GEMM convolution, ...) maps onto
+/// the same workgroup-tiled kernel. Callers only describe how to read the
+/// operands and how to write the result, which keeps the tiling, the
+/// workgroup-memory staging and the bounds handling in one place.
+/// Products with only a few rows go to [skinnyGemmShader] instead, which
+/// takes the same kind of accessors.
+library;
+
+import 'gpu_kernel.dart';
+
+/// Output rows covered by one workgroup.
+const int gemmTileM = 64;
+
+/// Output columns covered by one workgroup.
+const int gemmTileN = 64;
+
+/// Depth of the K slice staged in workgroup memory per iteration.
+const int gemmTileK = 16;
+
+/// Builds a WGSL kernel computing `C[b] = A[b] · B[b]` where, for each batch
+/// `b`, `A` is `[m, k]`, `B` is `[k, n]` and `C` is `[m, n]`.
+///
+/// [bindings] holds the `@group/@binding` declarations and any constants the
+/// accessors need. [loadA], [loadB] and [storeC] are WGSL function bodies for:
+///
+///   fn loadA(b: u32, row: u32, kk: u32) -> f32
+///   fn loadB(b: u32, kk: u32, col: u32) -> f32
+///   fn storeC(b: u32, row: u32, col: u32, value: f32)
+///
+/// Reads outside `[m, k]` / `[k, n]` are zero-filled by the template, and
+/// stores are only issued for in-range elements, so the accessors never need
+/// to bounds-check the GEMM coordinates themselves.
+///
+/// Each workgroup of 16×16 threads computes a [gemmTileM]×[gemmTileN] tile of
+/// `C`, with every thread accumulating a 4×4 micro-tile in registers, for
+/// [batch] products. Dispatch with [gemmWorkgroups].
+String tiledGemmShader({
+  required int m,
+  required int n,
+  required int k,
+  required String bindings,
+  required String loadA,
+  required String loadB,
+  required String storeC,
+  int batch = 1,
+}) {
+  final WorkgroupGrid grid = gemmWorkgroups(m, n, batch);
+  return '''
+$bindings
+
+const GEMM_M: u32 = ${m}u;
+const GEMM_N: u32 = ${n}u;
+const GEMM_K: u32 = ${k}u;
+const TILE_M: u32 = ${gemmTileM}u;
+const TILE_N: u32 = ${gemmTileN}u;
+const TILE_K: u32 = ${gemmTileK}u;
+
+var<workgroup> tileA: array<f32, ${gemmTileM * gemmTileK}>;
+var<workgroup> tileB: array<f32, ${gemmTileK * gemmTileN}>;
+
+fn loadA(b: u32, row: u32, kk: u32) -> f32 {
+$loadA
+}
+
+fn loadB(b: u32, kk: u32, col: u32) -> f32 {
+$loadB
+}
+
+fn storeC(b: u32, row: u32, col: u32, value: f32) {
+$storeC
+}
+
+@compute @workgroup_size(16, 16, 1)
+fn main(@builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+${grid.wgslGroupId}
+  let batch: u32 = wg.z;
+  let rowBase: u32 = wg.y * TILE_M;
+  let colBase: u32 = wg.x * TILE_N;
+  let tid: u32 = lid.y * 16u + lid.x;
+
+  var acc: array<f32, 16>;
+  var a: array<f32, 4>;
+  var bv: array<f32, 4>;
+
+  for (var k0: u32 = 0u; k0 < GEMM_K; k0 = k0 + TILE_K) {
+    // Stage a TILE_M x TILE_K slice of A and a TILE_K x TILE_N slice of B.
+    for (var l: u32 = 0u; l < 4u; l = l + 1u) {
+      let e: u32 = tid + l * 256u;
+      let ar: u32 = rowBase + e / TILE_K;
+      let ak: u32 = k0 + e % TILE_K;
+      var va: f32 = 0.0;
+      if (ar < GEMM_M && ak < GEMM_K) {
+        va = loadA(batch, ar, ak);
+      }
+      tileA[e] = va;
+
+      let bk: u32 = k0 + e / TILE_N;
+      let bc: u32 = colBase + e % TILE_N;
+      var vb: f32 = 0.0;
+      if (bk < GEMM_K && bc < GEMM_N) {
+        vb = loadB(batch, bk, bc);
+      }
+      tileB[e] = vb;
+    }
+    workgroupBarrier();
+
+    for (var kk: u32 = 0u; kk < TILE_K; kk = kk + 1u) {
+      for (var i: u32 = 0u; i < 4u; i = i + 1u) {
+        a[i] = tileA[(lid.y * 4u + i) * TILE_K + kk];
+        bv[i] = tileB[kk * TILE_N + lid.x * 4u + i];
+      }
+      for (var i: u32 = 0u; i < 4u; i = i + 1u) {
+        for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+          acc[i * 4u + j] = acc[i * 4u + j] + a[i] * bv[j];
+        }
+      }
+    }
+    workgroupBarrier();
+  }
+
+  for (var i: u32 = 0u; i < 4u; i = i + 1u) {
+    let row: u32 = rowBase + lid.y * 4u + i;
+    for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+      let col: u32 = colBase + lid.x * 4u + j;
+      if (row < GEMM_M && col < GEMM_N) {
+        storeC(batch, row, col, acc[i * 4u + j]);
+      }
+    }
+  }
+}
+''';
+}
+
+/// Workgroup grid of a [tiledGemmShader] kernel; launch [WorkgroupGrid.count]
+/// workgroups.
+WorkgroupGrid gemmWorkgroups(int m, int n, int batch) => WorkgroupGrid(
+    (n + gemmTileN - 1) ~/ gemmTileN, (m + gemmTileM - 1) ~/ gemmTileM, batch);
+
+/// Largest row count routed to [skinnyGemmShader] instead of the tiled
+/// kernel.
+const int skinnyGemmMaxM = 8;
+
+/// Threads across the output columns of a [skinnyGemmShader] workgroup; each
+/// owns four adjacent columns.
+const int _skinnyThreadsN = 64;
+
+/// Threads splitting K for each column quad.
+const int _skinnyThreadsK = 4;
+
+/// Builds a WGSL kernel for `C[b] = A[b] · B[b]` when `A` has only a few
+/// rows (`m <= [skinnyGemmMaxM]`), as in token-by-token decoding.
+///
+/// The tiled kernel would leave most of its 64-row tile idle. Instead each
+/// thread owns four adjacent output columns for all `m` rows, walks its
+/// share of K reading one `vec4` of `B` per step (coalesced across the
+/// workgroup), and the K partials are summed in workgroup memory.
+///
+/// The accessors have the same roles as in [tiledGemmShader]:
+///
+///   fn loadA(b: u32, row: u32, kk: u32) -> f32
+///   fn loadB4(b: u32, kk: u32, col: u32) -> vec4<f32>  // cols col..col+3
+///   fn storeC(b: u32, row: u32, col: u32, value: f32)
+///
+/// `loadB4` is only called with `col < n` but must zero-fill columns past
+/// `n` itself; stores are only issued in range. [batch] counts the products;
+/// dispatch with [skinnyGemmWorkgroups].
+String skinnyGemmShader({
+  required int m,
+  required int n,
+  required int k,
+  required String bindings,
+  required String loadA,
+  required String loadB4,
+  required String storeC,
+  int batch = 1,
+}) {
+  const int threads = _skinnyThreadsN * _skinnyThreadsK;
+  final WorkgroupGrid grid = skinnyGemmWorkgroups(n, batch);
+  return '''
+$bindings
+
+const GEMM_M: u32 = ${m}u;
+const GEMM_N: u32 = ${n}u;
+const GEMM_K: u32 = ${k}u;
+const THREADS_N: u32 = ${_skinnyThreadsN}u;
+const THREADS_K: u32 = ${_skinnyThreadsK}u;
+
+var<workgroup> partial: array<vec4<f32>, $threads>;
+
+fn loadA(b: u32, row: u32, kk: u32) -> f32 {
+$loadA
+}
+
+fn loadB4(b: u32, kk: u32, col: u32) -> vec4<f32> {
+$loadB4
+}
+
+fn storeC(b: u32, row: u32, col: u32, value: f32) {
+$storeC
+}
+
+@compute @workgroup_size(${_skinnyThreadsN}, ${_skinnyThreadsK}, 1)
+fn main(@builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+${grid.wgslGroupId}
+  let batch: u32 = wg.z;
+  let col: u32 = (wg.x * THREADS_N + lid.x) * 4u;
+
+  var acc: array<vec4<f32>, GEMM_M>;
+  if (col < GEMM_N) {
+    for (var kk: u32 = lid.y; kk < GEMM_K; kk = kk + THREADS_K) {
+      let w: vec4<f32> = loadB4(batch, kk, col);
+      for (var r: u32 = 0u; r < GEMM_M; r = r + 1u) {
+        acc[r] = acc[r] + loadA(batch, r, kk) * w;
+      }
+    }
+  }
+
+  for (var r: u32 = 0u; r < GEMM_M; r = r + 1u) {
+    partial[lid.y * THREADS_N + lid.x] = acc[r];
+    workgroupBarrier();
+    if (lid.y == 0u && col < GEMM_N) {
+      var total: vec4<f32> = partial[lid.x];
+      for (var s: u32 = 1u; s < THREADS_K; s = s + 1u) {
+        total = total + partial[s * THREADS_N + lid.x];
+      }
+      for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+        if (col + j < GEMM_N) {
+          storeC(batch, r, col + j, total[j]);
+        }
+      }
+    }
+    workgroupBarrier();
+  }
+}
+''';
+}
+
+/// Workgroup grid of a [skinnyGemmShader] kernel; launch
+/// [WorkgroupGrid.count] workgroups.
+WorkgroupGrid skinnyGemmWorkgroups(int n, int batch) => WorkgroupGrid(
+    (n + _skinnyThreadsN * 4 - 1) ~/ (_skinnyThreadsN * 4), 1, batch);
@@ -0,0 +1,694 @@
+/// WGSL generation helpers shared by the gpu_tensor ops.
+///
+/// Not exported from the package: ops use these to turn tensor metadata
+/// (shape, strides, offset) into index math, either baked into their kernels
+/// or read from a [KernelParams] buffer.
+library;
+
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_data.dart';
+import 'gpu_tensor_base.dart';
+
+/// Merges adjacent dimensions that are laid out back to back in memory, so
+/// generated index math only pays for the dimensions that actually differ.
+/// Size-1 dimensions are dropped. Returns `[sizes, strides]`.
+List<List<int>> collapseDims(List<int> shape, List<int> strides) {
+  final sizes = <int>[];
+  final steps = <int>[];
+  for (int d = 0; d < shape.length; d++) {
+    if (shape[d] == 1) continue;
+    if (sizes.isNotEmpty && steps.last == strides[d] * shape[d]) {
+      sizes[sizes.length - 1] *= shape[d];
+      steps[steps.length - 1] = strides[d];
+    } else {
+      sizes.add(shape[d]);
+      steps.add(strides[d]);
+    }
+  }
+  return [sizes, steps];
+}
+
+/// Emits `fn <name>(i: u32) -> u32`, mapping the flat row-major index `i`
+/// over [t]'s logical shape onto the buffer element of [t] it refers to.
+///
+/// Dense tensors get the identity; strided views unravel `i` and re-linearize
+/// it with the view's strides and base offset.
+///
+/// Kernels using it read the buffer as `array<f32>`, so it throws for other
+/// dtypes; dtype-aware kernels use [wgslLoadFn] instead. With [params], the
+/// sizes, strides and offset are read from it rather than baked in.
+String wgslIndexFn(String name, Tensor t, [KernelParams? params]) {
+  requireF32(t);
+  return _indexFn(name, t, params);
+}
+
+/// Throws for tensors whose storage is not f32, for ops whose kernels only
+/// read `array<f32>`.
+void requireF32(Tensor t) {
+  if (t.dtype != DType.f32) {
+    throw UnsupportedError("This op does not support ${t.dtype.name} "
+        "tensors; convert with toDType(DType.f32) first.");
+  }
+}
+
+/// Whether f16 tensors on [gpu] are bound as `array<f16>`. Without the
+/// shader-f16 feature they are bound as `array<u32>`, two halves per word.
+bool nativeF16(Minigpu gpu) => gpu.hasFeature(MinigpuFeature.shaderF16);
+
+/// The `enable f16;` directive when any of [tensors] is bound as
+/// `array<f16>`, otherwise empty. Must come first in the module.
+String wgslEnableF16(Minigpu gpu, List<Tensor> tensors) =>
+    nativeF16(gpu) && tensors.any((t) => t.dtype == DType.f16)
+        ? 'enable f16;\n'
+        : '';
+
+/// WGSL element type of the storage array [t] is bound as.
+String wgslArrayType(Tensor t) => switch (t.dtype) {
+      DType.f32 => 'f32',
+      DType.f16 => nativeF16(t.gpu) ? 'f16' : 'u32',
+    };
+
+/// Emits `fn <name>(i: u32) -> f32` reading logical element `i` of [t] from
+/// the storage array [array] (declared with [wgslArrayType]) and widening it
+/// to f32. [params] is used as in [wgslIndexFn].
+String wgslLoadFn(String name, String array, Tensor t,
+    [KernelParams? params]) {
+  final String index = _indexFn('${name}_idx', t, params);
+  return '${index}fn $name(i: u32) -> f32 { '
+      'let j: u32 = ${name}_idx(i); '
+      'return ${wgslBufferRead(array, 'j', t)}; }\n';
+}
+
+/// WGSL expression reading buffer element [index] (a position in the
+/// buffer, not a logical index) of [t]'s storage array [array] as f32.
+String wgslBufferRead(String array, String index, Tensor t) =>
+    switch (t.dtype) {
+      DType.f32 => '$array[$index]',
+      DType.f16 => nativeF16(t.gpu)
+          ? 'f32($array[$index])'
+          : 'unpack2x16float($array[($index) >> 1u])[($index) & 1u]',
+    };
+
+String _indexFn(String name, Tensor t, KernelParams? params) {
+  if (t.isContiguous) {
+    return 'fn $name(i: u32) -> u32 { return i; }\n';
+  }
+  final collapsed = collapseDims(t.shape, t.strides);
+  final sizes = collapsed[0];
+  final steps = collapsed[1];
+  String u(int value) => params?.u32(value) ?? '${value}u';
+
+  // Broadcast operands collapse to one of a few shapes; give those a
+  // closed form instead of the general unravel.
+  if (sizes.every((s) => s == 1) || steps.every((s) => s == 0)) {
+    // Scalar: every output element reads the same value.
+    return 'fn $name(i: u32) -> u32 { return ${u(t.offset)}; }\n';
+  }
+  if (sizes.length == 2 && steps[0] == 0 && steps[1] == 1) {
+    // Row vector repeated down the rows.
+    return 'fn $name(i: u32) -> u32 { '
+        'return ${u(t.offset)} + i % ${u(sizes[1])}; }\n';
+  }
+  if (sizes.length == 2 && steps[0] == 1 && steps[1] == 0) {
+    // Column vector repeated across the columns.
+    return 'fn $name(i: u32) -> u32 { '
+        'return ${u(t.offset)} + i / ${u(sizes[1])}; }\n';
+  }
+
+  final sb = StringBuffer()
+    ..writeln('fn $name(i: u32) -> u32 {')
+    ..writeln('  var rem: u32 = i;')
+    ..writeln('  var idx: u32 = ${u(t.offset)};');
+  for (int d = sizes.length - 1; d >= 0; d--) {
+    if (d == 0) {
+      if (steps[d] != 0) sb.writeln('  idx = idx + rem * ${u(steps[d])};');
+    } else {
+      final String size = u(sizes[d]);
+      if (steps[d] != 0) {
+        sb.writeln('  idx = idx + (rem % $size) * ${u(steps[d])};');
+      }
+      sb.writeln('  rem = rem / $size;');
+    }
+  }
+  sb
+    ..writeln('  return idx;')
+    ..writeln('}');
+  return sb.toString();
+}
+
+/// Flat thread index of a 1D launch with 256-thread workgroups.
+///
+/// The runtime folds 1D grids past the per-dimension workgroup limit
+/// (65535) into 2D/3D, so kernels declare `@builtin(num_workgroups) nwg`
+/// and use this in place of `gid.x`. Their usual bounds check also skips
+/// the overshoot of the folded grid.
+const String wgslLinearIndex = 'gid.x + (gid.y + gid.z * nwg.y) * nwg.x * 256u';
+
+/// Flat workgroup index of a 1D launch, the counterpart of [wgslLinearIndex]
+/// for kernels that work per workgroup; `wid` is the `workgroup_id` builtin.
+const String wgslGroupIndex = 'wid.x + (wid.y + wid.z * nwg.y) * nwg.x';
+
+/// A 2D/3D workgroup grid launched as a flat 1D one.
+///
+/// The runtime only folds 1D grids past the per-dimension limit, so kernels
+/// with an `(x, y, z)` grid dispatch [count] workgroups and rebuild their
+/// workgroup id with [wgslGroupId]. Every dimension may then pass 65535.
+class WorkgroupGrid {
+  const WorkgroupGrid(this.x, [this.y = 1, this.z = 1]);
+
+  final int x;
+  final int y;
+  final int z;
+
+  /// Workgroups to dispatch.
+  int get count => x * y * z;
+
+  /// WGSL statements declaring `wg: vec3<u32>`, the workgroup's position in
+  /// this grid. Workgroups past the end of the folded grid return; that
+  /// branch is uniform, so later barriers stay valid.
+  String get wgslGroupId => '''
+  let flatGroup: u32 = $wgslGroupIndex;
+  if (flatGroup >= ${count}u) {
+    return;
+  }
+  let wg: vec3<u32> = vec3<u32>(flatGroup % ${x}u, flatGroup / ${x}u % ${y}u,
+                                flatGroup / ${x * y}u);
+''';
+}
+
+final _bindingElements = Expando<int>();
+
+/// Largest number of f32 elements one storage binding may cover on [gpu]'s
+/// device, rounded down to the storage offset alignment so chunk starts can
+/// be bound directly.
+int maxBindingElements(Minigpu gpu) {
+  return _bindingElements[gpu] ??= () {
+    final limits = gpu.limits;
+    final int bytes = limits?.maxStorageBufferBindingSize ?? 134217728;
+    final int align = limits?.minStorageBufferOffsetAlignment ?? 256;
+    return (bytes - bytes % align) ~/ 4;
+  }();
+}
+
+final _commandLists = Expando<CommandList>();
+
+/// Reusable command list for [gpu]. Helpers that fill it submit it before
+/// returning, so it is always empty between ops.
+CommandList commandList(Minigpu gpu) =>
+    _commandLists[gpu] ??= gpu.createCommandList();
+
+/// Values a kernel reads from a small `Params: array<u32>` storage buffer
+/// instead of having them spliced into its source, so one compiled pipeline
+/// serves every size, stride and scalar of an op rather than one per value.
+///
+/// [u32] and [f32] record a value and return the WGSL expression reading it
+/// back. Words are laid out in call order, so a caller that records its
+/// per-launch values first can rewrite them in [words] between launches.
+class KernelParams {
+  final List<int> _words = [];
+
+  String u32(int value) {
+    _words.add(value);
+    return 'Params[${_words.length - 1}]';
+  }
+
+  String f32(double value) {
+    final bits = ByteData(4)..setFloat32(0, value);
+    return 'bitcast<f32>(${u32(bits.getUint32(0))})';
+  }
+
+  /// The `Params` declaration at [binding].
+  String declaration(int binding) => '@group(0) @binding($binding) '
+      'var<storage, read_write> Params: array<u32>;';
+
+  /// A fresh copy of the recorded words; bindings cannot be empty, so there
+  /// is at least one.
+  Uint32List get words => Uint32List.fromList(_words.isEmpty ? [0] : _words);
+}
+
+/// Small buffers that carry [KernelParams], handed out round-robin.
+///
+/// The runtime only submits its recorded passes before an upload when one
+/// of them reads the uploaded buffer. The ring has more slots than the
+/// runtime batches passes, so by the time a slot comes round again the
+/// passes that read it have been submitted and parameter uploads never
+/// break up a batch. Slots grow to the largest parameter block seen.
+class _ParamRing {
+  _ParamRing(this.gpu);
+
+  static const int slots = 64;
+  static const int minBytes = 256;
+
+  final Minigpu gpu;
+  final List<Buffer?> _buffers = List.filled(slots, null);
+  final List<int> _bytes = List.filled(slots, 0);
+  int _next = 0;
+
+  Buffer take(int bytes) {
+    final int slot = _next;
+    _next = (_next + 1) % slots;
+    if (_bytes[slot] < bytes) {
+      _buffers[slot]?.destroy();
+      _bytes[slot] = bytes > minBytes ? bytes : minBytes;
+      _buffers[slot] = gpu.createBuffer(_bytes[slot]);
+    }
+    return _buffers[slot]!;
+  }
+}
+
+final _paramRings = Expando<_ParamRing>();
+
+/// Records an upload of [words] into the next params slot of [gpu] on
+/// [list] and returns the slot to bind.
+Buffer uploadParams(Minigpu gpu, CommandList list, Uint32List words) {
+  final Buffer slot =
+      (_paramRings[gpu] ??= _ParamRing(gpu)).take(words.lengthInBytes);
+  list.upload(slot, Float32List.view(words.buffer));
+  return slot;
+}
+
+const Symbol _captureKey = #gpu_tensor.capture;
+
+/// Runs [body] with every kernel launch recording its source instead of
+/// running, and returns the recorded sources in launch order.
+///
+/// Tensors created meanwhile only carry their metadata (shape, dtype) over
+/// a one-word placeholder buffer, as nothing reads or writes them, so ops
+/// can be run on any declared shape to learn the kernels they would launch.
+Future<List<String>> captureKernels(Future<void> Function() body) async {
+  final List<String> sources = [];
+  await runZoned(body, zoneValues: {_captureKey: sources});
+  return sources;
+}
+
+/// Whether a [captureKernels] body is running.
+bool get capturingKernels => Zone.current[_captureKey] != null;
+
+/// Under [captureKernels], records [source] and returns true; the caller
+/// then skips its launch. Returns false otherwise.
+bool captureKernel(String source) {
+  final sources = Zone.current[_captureKey] as List<String>?;
+  sources?.add(source);
+  return sources != null;
+}
+
+/// Enqueues one launch of [source] with [buffers] bound to `@binding(0)`,
+/// `@binding(1)`, ... in order, and [params], if given, uploaded to a params
+/// slot bound after them. The kernel is registered with the runtime on first
+/// use, after which a launch is a single native call.
+void launchKernel(
+    Minigpu gpu, String source, List<Buffer> buffers, int workgroups,
+    {KernelParams? params}) {
+  if (captureKernel(source)) return;
+  final int kernel = gpu.registerKernel(source);
+  final CommandList list = commandList(gpu);
+  for (int i = 0; i < buffers.length; i++) {
+    list.bind(kernel, i, buffers[i]);
+  }
+  if (params != null) {
+    list.bind(kernel, buffers.length, uploadParams(gpu, list, params.words));
+  }
+  list.dispatch(kernel, workgroups);
+  list.submit();
+}
+
+/// Turns the first [length] u32s of [data] into their exclusive prefix sum
+/// in place. Each workgroup scans 512 values and records its total; the
+/// totals are scanned the same way and added back, so any length takes
+/// `O(log512(length))` levels.
+void exclusiveScanU32(Minigpu gpu, Buffer data, int length) {
+  final int blocks = (length + 511) ~/ 512;
+  final Buffer sums = gpu.createBuffer(blocks * 4);
+  final shaderCode = '''
+@group(0) @binding(0) var<storage, read_write> Data: array<u32>;
+@group(0) @binding(1) var<storage, read_write> Sums: array<u32>;
+const LEN: u32 = ${length}u;
+const BLOCKS: u32 = ${blocks}u;
+var<workgroup> partial: array<u32, 256>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let block: u32 = $wgslGroupIndex;
+  if (block >= BLOCKS) {
+    return;
+  }
+  let i: u32 = block * 512u + 2u * lid.x;
+  var a: u32 = 0u;
+  var b: u32 = 0u;
+  if (i < LEN) {
+    a = Data[i];
+  }
+  if (i + 1u < LEN) {
+    b = Data[i + 1u];
+  }
+  // Inclusive Hillis-Steele scan of the pair sums.
+  var acc: u32 = a + b;
+  partial[lid.x] = acc;
+  workgroupBarrier();
+  for (var s: u32 = 1u; s < 256u; s = s << 1u) {
+    if (lid.x >= s) {
+      acc = acc + partial[lid.x - s];
+    }
+    workgroupBarrier();
+    partial[lid.x] = acc;
+    workgroupBarrier();
+  }
+  let before: u32 = acc - a - b;
+  if (i < LEN) {
+    Data[i] = before;
+  }
+  if (i + 1u < LEN) {
+    Data[i + 1u] = before + a;
+  }
+  if (lid.x == 255u) {
+    Sums[block] = acc;
+  }
+}
+''';
+  launchKernel(gpu, shaderCode, [data, sums], blocks);
+  if (blocks > 1) {
+    exclusiveScanU32(gpu, sums, blocks);
+    final addCode = '''
+@group(0) @binding(0) var<storage, read_write> Data: array<u32>;
+@group(0) @binding(1) var<storage, read_write> Sums: array<u32>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < ${length}u) {
+    Data[i] = Data[i] + Sums[i / 512u];
+  }
+}
+''';
+    launchKernel(gpu, addCode, [data, sums], (length + 255) ~/ 256);
+  }
+  sums.destroy();
+}
+
+/// An axis seen as `rows` independent rows of `d` elements. Element `j` of
+/// row `r` sits at `(r / inner) * d * inner + r % inner + j * inner`.
+class AxisRows {
+  AxisRows(List<int> shape, int axis)
+      : d = shape[axis],
+        inner = shape.sublist(axis + 1).fold(1, (a, b) => a * b),
+        rows = shape.fold(1, (a, b) => a * b) ~/ shape[axis];
+
+  final int d;
+  final int inner;
+  final int rows;
+
+  /// WGSL position of element `j` of `row` in a row-major tensor of the
+  /// same shape except that the axis has [length] elements.
+  String wgslPos(String row, String j, int length) =>
+      '($row / ${inner}u) * ${length * inner}u + $row % ${inner}u + '
+      '$j * ${inner}u';
+}
+
+/// Number of buffer elements [t] can touch, counted from the buffer start.
+int _footprint(Tensor t) {
+  int last = t.offset;
+  for (int d = 0; d < t.rank; d++) {
+    last += (t.shape[d] - 1) * t.strides[d];
+  }
+  return last + 1;
+}
+
+/// Returns the NumPy-style broadcast of shapes [a] and [b]: dimensions are
+/// aligned from the right and each pair must be equal or contain a 1.
+/// Throws if the shapes are incompatible.
+List<int> broadcastShapes(List<int> a, List<int> b) {
+  final int rank = a.length > b.length ? a.length : b.length;
+  final out = List<int>.filled(rank, 1);
+  for (int i = 0; i < rank; i++) {
+    final int da = i < rank - a.length ? 1 : a[i - (rank - a.length)];
+    final int db = i < rank - b.length ? 1 : b[i - (rank - b.length)];
+    if (da != db && da != 1 && db != 1) {
+      throw Exception("Shapes $a and $b cannot be broadcast together.");
+    }
+    out[i] = da == 1 ? db : da;
+  }
+  return out;
+}
+
+const _inputNames = ['A', 'B', 'C', 'D'];
+
+bool _sameShape(List<int> a, List<int> b) {
+  if (a.length != b.length) return false;
+  for (int i = 0; i < a.length; i++) {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+/// Runs a one-thread-per-element kernel over [outShape] and returns the
+/// (dense) result.
+///
+/// Input `k` is bound as `A`, `B`, ... and read through its index function
+/// into the local `a`, `b`, ...; [expression] combines those locals into the
+/// output value. Inputs whose shape differs from [outShape] are broadcast to
+/// it as stride-0 views, so the small operand is never materialized.
+/// [helpers] is spliced in at module scope for any WGSL functions the
+/// expression needs. The expression may also read the flat output index `i`
+/// and the output size `n`, so with no inputs it generates values on the
+/// device, and [scalars] as the f32 locals `s0`, `s1`, ...
+///
+/// Sizes, strides and scalars are passed in a [KernelParams] buffer, so the
+/// kernel source only depends on the expression and the inputs' layouts, and
+/// one pipeline serves every shape and scalar value.
+///
+/// Inputs of any dtype are widened to f32 before [expression] runs. The
+/// result is f16 when every input is, f32 otherwise, unless [dtype] says.
+///
+/// Outputs larger than one storage binding ([maxBindingElements]) are
+/// computed in chunks, each binding only its slice of the output and of the
+/// dense inputs.
+Future<Tensor> elementwise(
+  Minigpu gpu,
+  List<Tensor> inputs,
+  List<int> outShape,
+  String expression, {
+  String helpers = '',
+  List<double> scalars = const [],
+  DType? dtype,
+}) async {
+  final List<Tensor> broadcast = [
+    for (final t in inputs)
+      if (!_sameShape(t.shape, outShape)) t.expand(outShape)
+  ];
+  int next = 0;
+  inputs = [
+    for (final t in inputs)
+      _sameShape(t.shape, outShape) ? t : broadcast[next++]
+  ];
+  dtype ??= inputs.isNotEmpty && inputs.every((t) => t.dtype == DType.f16)
+      ? DType.f16
+      : DType.f32;
+  Tensor result = await Tensor.create(outShape, gpu: gpu, dtype: dtype);
+  await _runElementwise(gpu, inputs, result, expression, helpers, scalars);
+  for (final view in broadcast) {
+    view.destroy();
+  }
+  return result;
+}
+
+/// Overwrites the dense tensor [dst] with [expression] evaluated at each
+/// flat index `i`, as an input-less [elementwise].
+Future<void> generateInto(Tensor dst, String expression,
+        {List<double> scalars = const []}) =>
+    _runElementwise(dst.gpu, const [], dst, expression, '', scalars);
+
+/// WGSL f32 literal with exactly the bits of [value] rounded to f32, which
+/// also covers infinities and NaN.
+String wgslF32(double value) {
+  final bits = ByteData(4)..setFloat32(0, value);
+  return 'bitcast<f32>(0x${bits.getUint32(0).toRadixString(16)}u)';
+}
+
+/// `let s0: f32 = ...;` lines reading [scalars] from [params].
+String wgslScalarLets(
+        List<double> scalars, KernelParams params, String indent) =>
+    [
+      for (int k = 0; k < scalars.length; k++)
+        '${indent}let s$k: f32 = ${params.f32(scalars[k])};\n'
+    ].join();
+
+Future<void> _runElementwise(Minigpu gpu, List<Tensor> inputs, Tensor result,
+    String expression, String helpers, List<double> scalars) async {
+  if (result.size > maxBindingElements(gpu)) {
+    if (result.dtype != DType.f32 || inputs.any((t) => t.dtype != DType.f32)) {
+      throw UnsupportedError(
+          "f16 tensors past the storage binding limit are not supported.");
+    }
+    await _elementwiseChunked(
+        gpu, inputs, result, expression, helpers, scalars);
+  } else {
+    _elementwiseInto(gpu, inputs, result, expression, helpers, scalars);
+  }
+}
+
+/// Copies [src] into the dense tensor [dst] of the same shape, converting to
+/// [dst]'s dtype.
+void convertInto(Tensor src, Tensor dst) {
+  if (src.size > maxBindingElements(src.gpu)) {
+    throw UnsupportedError(
+        "f16 tensors past the storage binding limit are not supported.");
+  }
+  _elementwiseInto(src.gpu, [src], dst, 'a', '', const []);
+}
+
+/// The single-kernel body of [elementwise], writing into [result].
+void _elementwiseInto(Minigpu gpu, List<Tensor> inputs, Tensor result,
+    String expression, String helpers, List<double> scalars) {
+  final int size = result.size;
+  final params = KernelParams();
+  // Packed f16 output: each thread writes both halves of one word.
+  final bool packed = wgslArrayType(result) == 'u32';
+  final String threads = params.u32(packed ? (size + 1) ~/ 2 : size);
+  final String n = params.u32(size);
+
+  final sb = StringBuffer(wgslEnableF16(gpu, [...inputs, result]));
+  for (int k = 0; k < inputs.length; k++) {
+    sb.writeln('@group(0) @binding($k) var<storage, read_write> '
+        '${_inputNames[k]}: array<${wgslArrayType(inputs[k])}>;');
+  }
+  sb.writeln('@group(0) @binding(${inputs.length}) '
+      'var<storage, read_write> Out: array<${wgslArrayType(result)}>;');
+  sb.writeln(params.declaration(inputs.length + 1));
+  sb.writeln(helpers);
+  for (int k = 0; k < inputs.length; k++) {
+    final name = _inputNames[k];
+    sb.write(wgslLoadFn('load_$name', name, inputs[k], params));
+  }
+  sb.writeln('fn ew_value(i: u32) -> f32 {');
+  sb.writeln('  let n: u32 = $n;');
+  sb.write(wgslScalarLets(scalars, params, '  '));
+  for (int k = 0; k < inputs.length; k++) {
+    final name = _inputNames[k];
+    sb.writeln('  let ${name.toLowerCase()}: f32 = load_$name(i);');
+  }
+  sb.writeln('  return $expression;\n}');
+
+  final String store = switch (wgslArrayType(result)) {
+    'u32' => '''
+    var hi: f32 = 0.0;
+    if (2u * i + 1u < $n) {
+      hi = ew_value(2u * i + 1u);
+    }
+    Out[i] = pack2x16float(vec2<f32>(ew_value(2u * i), hi));''',
+    'f16' => '    Out[i] = f16(ew_value(i));',
+    _ => '    Out[i] = ew_value(i);',
+  };
+  sb.writeln('''
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < $threads) {
+$store
+  }
+}''');
+
+  final int workgroups = ((packed ? (size + 1) ~/ 2 : size) + 255) ~/ 256;
+  launchKernel(gpu, sb.toString(),
+      [for (final t in inputs) t.buffer, result.buffer], workgroups,
+      params: params);
+}
+
+/// [elementwise] for outputs past the binding limit. Each chunk of the output
+/// is bound as its own range; dense inputs are bound over the matching range
+/// and indexed locally, while small (e.g. broadcast) inputs are bound whole
+/// and indexed by the global element. The chunk's start and length lead the
+/// [KernelParams] words and are rewritten per chunk, so every chunk reuses
+/// one pipeline.
+Future<void> _elementwiseChunked(Minigpu gpu, List<Tensor> inputs,
+    Tensor result, String expression, String helpers,
+    List<double> scalars) async {
+  final int size = result.size;
+  final int chunk = maxBindingElements(gpu);
+  final int align = (gpu.limits?.minStorageBufferOffsetAlignment ?? 256) ~/ 4;
+  final List<bool> ranged = [];
+  for (final t in inputs) {
+    if (t.isRowMajor && t.offset % align == 0 && _footprint(t) > chunk) {
+      ranged.add(true);
+    } else if (_footprint(t) <= chunk) {
+      ranged.add(false);
+    } else {
+      throw Exception(
+          "Strided view of ${t.size} elements exceeds the storage binding "
+          "limit; copy it into smaller tensors first.");
+    }
+  }
+
+  final params = KernelParams();
+  final String start = params.u32(0);
+  final String length = params.u32(0);
+  final String n = params.u32(size);
+
+  final sb = StringBuffer();
+  for (int k = 0; k < inputs.length; k++) {
+    sb.writeln('@group(0) @binding($k) var<storage, read_write> '
+        '${_inputNames[k]}: array<f32>;');
+  }
+  sb.writeln('@group(0) @binding(${inputs.length}) '
+      'var<storage, read_write> Out: array<f32>;');
+  sb.writeln(params.declaration(inputs.length + 1));
+  sb.writeln(helpers);
+  for (int k = 0; k < inputs.length; k++) {
+    if (!ranged[k]) {
+      sb.write(wgslIndexFn('idx_${_inputNames[k]}', inputs[k], params));
+    }
+  }
+  sb.writeln('''
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let local: u32 = $wgslLinearIndex;
+  if (local < $length) {
+    let i: u32 = $start + local;
+    let n: u32 = $n;''');
+  sb.write(wgslScalarLets(scalars, params, '    '));
+  for (int k = 0; k < inputs.length; k++) {
+    final name = _inputNames[k];
+    final index = ranged[k] ? 'local' : 'idx_$name(i)';
+    sb.writeln('    let ${name.toLowerCase()}: f32 = $name[$index];');
+  }
+  sb.writeln('''
+    Out[local] = $expression;
+  }
+}''');
+
+  if (captureKernel(sb.toString())) return;
+  // All chunks go out in one command list, each with its own params slot.
+  final int kernel = gpu.registerKernel(sb.toString());
+  final CommandList list = commandList(gpu);
+  for (int first = 0; first < size; first += chunk) {
+    final int count = first + chunk < size ? chunk : size - first;
+    final Buffer paramBuffer = uploadParams(
+        gpu,
+        list,
+        params.words
+          ..[0] = first
+          ..[1] = count);
+    for (int k = 0; k < inputs.length; k++) {
+      final t = inputs[k];
+      if (ranged[k]) {
+        list.bind(kernel, k, t.buffer,
+            offset: (t.offset + first) * 4, size: count * 4);
+      } else {
+        list.bind(kernel, k, t.buffer, size: _footprint(t) * 4);
+      }
+    }
+    list.bind(kernel, inputs.length, result.buffer,
+        offset: first * 4, size: count * 4);
+    list.bind(kernel, inputs.length + 1, paramBuffer);
+    list.dispatch(kernel, (count + 255) ~/ 256);
+  }
+  list.submit();
+}
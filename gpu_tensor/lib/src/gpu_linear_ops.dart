@@ -1,7 +1,266 @@
+import 'dart:math' as math;
+
 import 'package:minigpu/minigpu.dart';
 
+import 'gpu_activation.dart';
+import 'gpu_gemm.dart';
+import 'gpu_kernel.dart';
 import 'gpu_tensor_base.dart';
 
+/// Memory layout of batched image tensors used by
+/// [TensorLinearOperator.conv2dBatched].
+enum ConvLayout {
+  /// Activations are `[N, C, H, W]` and filters `[Cout, Cin, kH, kW]`.
+  nchw,
+
+  /// Activations are `[N, H, W, C]` and filters `[kH, kW, Cin, Cout]`.
+  nhwc,
+}
+
+/// Geometry of a single convolution plus the WGSL index expressions that map
+/// logical coordinates onto the flat input, filter and output buffers.
+///
+/// The expressions may reference:
+///   - input:  `n`, `c`, `y`, `x`
+///   - filter: `o`, `c`, `r`, `s`
+///   - output: `n`, `o`, `y`, `x`
+/// together with the upper-case dimension constants emitted by [constants].
+class _ConvPlan {
+  _ConvPlan({
+    required this.batch,
+    required this.cin,
+    required this.h,
+    required this.w,
+    required this.cout,
+    required this.kH,
+    required this.kW,
+    required this.strideH,
+    required this.strideW,
+    required this.padH,
+    required this.padW,
+    required this.dilationH,
+    required this.dilationW,
+    required this.inputIndex,
+    required this.weightIndex,
+    required this.outputIndex,
+    required this.channelsLast,
+  })  : outH = ((h + 2 * padH - (dilationH * (kH - 1) + 1)) ~/ strideH) + 1,
+        outW = ((w + 2 * padW - (dilationW * (kW - 1) + 1)) ~/ strideW) + 1;
+
+  final int batch, cin, h, w, cout, kH, kW;
+  final int strideH, strideW, padH, padW, dilationH, dilationW;
+  final int outH, outW;
+  final String inputIndex, weightIndex, outputIndex;
+
+  /// Orders the reduction dimension as (r, s, c) instead of (c, r, s) so that
+  /// consecutive K indices read consecutive channels of an NHWC input.
+  final bool channelsLast;
+
+  int get gemmM => batch * outH * outW;
+  int get gemmN => cout;
+  int get gemmK => cin * kH * kW;
+
+  bool get winogradEligible =>
+      kH == 3 &&
+      kW == 3 &&
+      strideH == 1 &&
+      strideW == 1 &&
+      dilationH == 1 &&
+      dilationW == 1;
+
+  String get constants => '''
+const N: u32 = ${batch}u;
+const H: u32 = ${h}u;
+const W: u32 = ${w}u;
+const CIN: u32 = ${cin}u;
+const KH: u32 = ${kH}u;
+const KW: u32 = ${kW}u;
+const COUT: u32 = ${cout}u;
+const OUT_H: u32 = ${outH}u;
+const OUT_W: u32 = ${outW}u;
+const STRIDE_H: u32 = ${strideH}u;
+const STRIDE_W: u32 = ${strideW}u;
+const PAD_H: i32 = $padH;
+const PAD_W: i32 = $padW;
+const DIL_H: u32 = ${dilationH}u;
+const DIL_W: u32 = ${dilationW}u;
+''';
+
+  String get _splitK => channelsLast
+      ? '''
+  let c: u32 = kk % CIN;
+  let s: u32 = (kk / CIN) % KW;
+  let r: u32 = kk / (CIN * KW);'''
+      : '''
+  let c: u32 = kk / (KH * KW);
+  let r: u32 = (kk / KW) % KH;
+  let s: u32 = kk % KW;''';
+
+  String get _splitRow => '''
+  let n: u32 = row / (OUT_H * OUT_W);
+  let p: u32 = row % (OUT_H * OUT_W);
+  let oy: u32 = p / OUT_W;
+  let ox: u32 = p % OUT_W;''';
+
+  /// Implicit-GEMM kernel: the im2col matrix is never materialized, each
+  /// K-slice of it is gathered straight into workgroup memory by `loadA`.
+  String gemmShader() => tiledGemmShader(
+        m: gemmM,
+        n: gemmN,
+        k: gemmK,
+        bindings: '''
+@group(0) @binding(0) var<storage, read_write> input: array<f32>;
+@group(0) @binding(1) var<storage, read_write> kernel: array<f32>;
+@group(0) @binding(2) var<storage, read_write> output: array<f32>;
+$constants''',
+        loadA: '''
+$_splitRow
+$_splitK
+  let iy: i32 = i32(oy * STRIDE_H + r * DIL_H) - PAD_H;
+  let ix: i32 = i32(ox * STRIDE_W + s * DIL_W) - PAD_W;
+  if (iy < 0 || iy >= i32(H) || ix < 0 || ix >= i32(W)) {
+    return 0.0;
+  }
+  let y: u32 = u32(iy);
+  let x: u32 = u32(ix);
+  return input[$inputIndex];''',
+        loadB: '''
+$_splitK
+  let o: u32 = col;
+  return kernel[$weightIndex];''',
+        storeC: '''
+$_splitRow
+  let o: u32 = col;
+  let y: u32 = oy;
+  let x: u32 = ox;
+  output[$outputIndex] = value;''',
+      );
+
+  int get tilesH => (outH + 1) ~/ 2;
+  int get tilesW => (outW + 1) ~/ 2;
+
+  /// Winograd F(2x2, 3x3) filter transform: U = G·g·Gᵀ for every (o, c).
+  String winogradFilterShader() => '''
+@group(0) @binding(0) var<storage, read_write> kernel: array<f32>;
+@group(0) @binding(1) var<storage, read_write> U: array<f32>;
+$constants
+
+fn weight(o: u32, c: u32, r: u32, s: u32) -> f32 {
+  return kernel[$weightIndex];
+}
+
+// Applies G = [1, 0, 0; .5, .5, .5; .5, -.5, .5; 0, 0, 1] to a 3-vector.
+fn gTransform(a: f32, b: f32, c: f32) -> vec4<f32> {
+  return vec4<f32>(a, 0.5 * (a + b + c), 0.5 * (a - b + c), c);
+}
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
+  if (idx >= COUT * CIN) {
+    return;
+  }
+  let o: u32 = idx / CIN;
+  let c: u32 = idx % CIN;
+
+  // Column transform of each filter row, then the row transform.
+  let g0: vec4<f32> = gTransform(weight(o, c, 0u, 0u), weight(o, c, 0u, 1u), weight(o, c, 0u, 2u));
+  let g1: vec4<f32> = gTransform(weight(o, c, 1u, 0u), weight(o, c, 1u, 1u), weight(o, c, 1u, 2u));
+  let g2: vec4<f32> = gTransform(weight(o, c, 2u, 0u), weight(o, c, 2u, 1u), weight(o, c, 2u, 2u));
+  var u: array<vec4<f32>, 4>;
+  u[0] = g0;
+  u[1] = 0.5 * (g0 + g1 + g2);
+  u[2] = 0.5 * (g0 - g1 + g2);
+  u[3] = g2;
+
+  let base: u32 = idx * 16u;
+  for (var i: u32 = 0u; i < 4u; i = i + 1u) {
+    for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+      U[base + i * 4u + j] = u[i][j];
+    }
+  }
+}
+''';
+
+  /// Winograd F(2x2, 3x3) main kernel: one thread per 2×2 output tile and
+  /// output channel, 16 multiplies per input channel instead of 36.
+  String winogradShader() => '''
+@group(0) @binding(0) var<storage, read_write> input: array<f32>;
+@group(0) @binding(1) var<storage, read_write> U: array<f32>;
+@group(0) @binding(2) var<storage, read_write> output: array<f32>;
+$constants
+const TILES_H: u32 = ${tilesH}u;
+const TILES_W: u32 = ${tilesW}u;
+
+fn readInput(n: u32, c: u32, iy: i32, ix: i32) -> f32 {
+  if (iy < 0 || iy >= i32(H) || ix < 0 || ix >= i32(W)) {
+    return 0.0;
+  }
+  let y: u32 = u32(iy);
+  let x: u32 = u32(ix);
+  return input[$inputIndex];
+}
+
+// Applies Bᵀ = [1, 0, -1, 0; 0, 1, 1, 0; 0, -1, 1, 0; 0, 1, 0, -1].
+fn bTransform(t: vec4<f32>) -> vec4<f32> {
+  return vec4<f32>(t.x - t.z, t.y + t.z, t.z - t.y, t.y - t.w);
+}
+
+fn writeOutput(n: u32, o: u32, y: u32, x: u32, value: f32) {
+  if (y < OUT_H && x < OUT_W) {
+    output[$outputIndex] = value;
+  }
+}
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
+  if (idx >= N * COUT * TILES_H * TILES_W) {
+    return;
+  }
+  let tx: u32 = idx % TILES_W;
+  let ty: u32 = (idx / TILES_W) % TILES_H;
+  let o: u32 = (idx / (TILES_W * TILES_H)) % COUT;
+  let n: u32 = idx / (TILES_W * TILES_H * COUT);
+  let y0: i32 = i32(ty * 2u) - PAD_H;
+  let x0: i32 = i32(tx * 2u) - PAD_W;
+
+  var m: array<vec4<f32>, 4>;
+  var d: array<vec4<f32>, 4>;
+  for (var c: u32 = 0u; c < CIN; c = c + 1u) {
+    for (var i: u32 = 0u; i < 4u; i = i + 1u) {
+      d[i] = vec4<f32>(
+        readInput(n, c, y0 + i32(i), x0),
+        readInput(n, c, y0 + i32(i), x0 + 1),
+        readInput(n, c, y0 + i32(i), x0 + 2),
+        readInput(n, c, y0 + i32(i), x0 + 3));
+    }
+    let base: u32 = (o * CIN + c) * 16u;
+    let v0: vec4<f32> = bTransform(d[0] - d[2]);
+    let v1: vec4<f32> = bTransform(d[1] + d[2]);
+    let v2: vec4<f32> = bTransform(d[2] - d[1]);
+    let v3: vec4<f32> = bTransform(d[1] - d[3]);
+    m[0] = m[0] + vec4<f32>(U[base], U[base + 1u], U[base + 2u], U[base + 3u]) * v0;
+    m[1] = m[1] + vec4<f32>(U[base + 4u], U[base + 5u], U[base + 6u], U[base + 7u]) * v1;
+    m[2] = m[2] + vec4<f32>(U[base + 8u], U[base + 9u], U[base + 10u], U[base + 11u]) * v2;
+    m[3] = m[3] + vec4<f32>(U[base + 12u], U[base + 13u], U[base + 14u], U[base + 15u]) * v3;
+  }
+
+  // Output transform Aᵀ·m·A with Aᵀ = [1, 1, 1, 0; 0, 1, -1, -1].
+  let s0: vec4<f32> = m[0] + m[1] + m[2];
+  let s1: vec4<f32> = m[1] - m[2] - m[3];
+  let oy: u32 = ty * 2u;
+  let ox: u32 = tx * 2u;
+  writeOutput(n, o, oy, ox, s0.x + s0.y + s0.z);
+  writeOutput(n, o, oy, ox + 1u, s0.y - s0.z - s0.w);
+  writeOutput(n, o, oy + 1u, ox, s1.x + s1.y + s1.z);
+  writeOutput(n, o, oy + 1u, ox + 1u, s1.y - s1.z - s1.w);
+}
+''';
+}
+
 extension TensorLinearOperator on Tensor {
   /// helper function to check if two batch shapes are equal
   bool _batchShapesEqual(List<int> shapeA, List<int> shapeB) {
@@ -14,114 +273,176 @@ extension TensorLinearOperator on Tensor {
 
   /// Matrix multiplication (dot product)
   /// for 2D tensors or batched matrix multiplication for higher dimensions.
+  ///
+  /// Both cases run the shared tiled GEMM kernel (see [tiledGemmShader]),
+  /// except products of at most [skinnyGemmMaxM] rows, which run as a GEMV
+  /// (see [skinnyGemmShader]).
+  ///
+  /// Either operand may be f16; products are accumulated and returned in
+  /// f32.
   Future<Tensor> matMul(Tensor other) async {
 // Both tensors must have rank at least 2.
     if (rank < 2 || other.rank < 2) {
       throw Exception("matMul requires tensors with rank >= 2.");
     }
 
-    // Handle rank-2 matrix multiplication.
-    if (rank == 2 && other.rank == 2) {
-      int m = shape[0];
-      int n = shape[1];
-      if (other.shape[0] != n) {
-        throw Exception(
-            "Inner dimensions do not match for matrix multiplication.");
-      }
-      int p = other.shape[1];
-      // The result has shape [m, p].
-      Tensor result = await Tensor.create([m, p]);
-
-      final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(8,8,1)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let row: u32 = gid.x;
-  let col: u32 = gid.y;
-  if (row < ${m}u && col < ${p}u) {
-    var sum: f32 = 0.0;
-    for (var k: u32 = 0u; k < ${n}u; k = k + 1u) {
-      let aIndex = row * ${n}u + k;
-      let bIndex = k * ${p}u + col;
-      sum = sum + A[aIndex] * B[bIndex];
+    int m = shape[rank - 2];
+    int n = shape.last;
+    if (other.shape[other.rank - 2] != n) {
+      throw Exception(
+          "Inner dimensions do not match for matrix multiplication.");
     }
-    let cIndex = row * ${p}u + col;
-    C[cIndex] = sum;
-  }
-}
-''';
+    int p = other.shape.last;
 
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('A', buffer);
-      shader.setBuffer('B', other.buffer);
-      shader.setBuffer('C', result.buffer);
-      int wgX = (m + 7) ~/ 8;
-      int wgY = (p + 7) ~/ 8;
-      await shader.dispatch(wgX, wgY, 1);
-      shader.destroy();
-      return result;
-    } else {
-// Assume we are doing batched matrix multiplication:
-// The left tensor has matrix dimensions [m, n] and the right [n, p]
-// where the batch is given by all preceding dimensions (which must match).
-      int m = shape[rank - 2];
-      int n = shape.last; // also left inner dim
-      int p = other.shape.last;
-
-// Get batch dimensions:
-      List<int> batchShapeA = shape.sublist(0, rank - 2);
-      List<int> batchShapeB = other.shape.sublist(0, other.rank - 2);
+// Get batch dimensions. A rank-2 matrix is simply a batch of one.
+    List<int> batchShapeA = shape.sublist(0, rank - 2);
+    List<int> batchShapeB = other.shape.sublist(0, other.rank - 2);
 // For simplicity, require exact equality of batch dims.
-      if (!_batchShapesEqual(batchShapeA, batchShapeB)) {
-        throw Exception("Batch dimensions must match for batched matMul.");
-      }
-      int batch = batchShapeA.isEmpty ? 1 : batchShapeA.reduce((a, b) => a * b);
+    if (!_batchShapesEqual(batchShapeA, batchShapeB)) {
+      throw Exception("Batch dimensions must match for batched matMul.");
+    }
+    int batch = batchShapeA.isEmpty ? 1 : batchShapeA.reduce((a, b) => a * b);
 
 // The result shape is [batchShape, m, p]
-      List<int> resultShape = List.from(batchShapeA)..addAll([m, p]);
-      Tensor result = await Tensor.create(resultShape);
+    List<int> resultShape = List.from(batchShapeA)..addAll([m, p]);
+    Tensor result = await Tensor.create(resultShape, gpu: gpu);
 
-// Use a shader aware of the batch dimension (using 3D dispatch):
-      final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
+    // Decode-style products (a handful of rows) would leave the tiled
+    // kernel mostly idle; run them as a GEMV that splits K instead.
+    if (m <= skinnyGemmMaxM) {
+      // Dense f32 B with rows a multiple of 4 long can be read as vec4.
+      final bool vec4 =
+          other.dtype == DType.f32 && other.isContiguous && p % 4 == 0;
+      final shaderCode = skinnyGemmShader(
+        m: m,
+        n: p,
+        k: n,
+        bindings: '''
+${wgslEnableF16(gpu, [this, other])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<${vec4 ? 'vec4<f32>' : wgslArrayType(other)}>;
 @group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(8,8,1)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-let b: u32 = gid.z;
-let row: u32 = gid.x;
-let col: u32 = gid.y;
-if (b < ${batch}u && row < ${m}u && col < ${p}u) {
-var sum: f32 = 0.0;
-let offsetA: u32 = b * ${m * n}u;
-let offsetB: u32 = b * ${n * p}u;
-for (var k: u32 = 0u; k < ${n}u; k = k + 1u) {
-let indexA = offsetA + row * ${n}u + k;
-let indexB = offsetB + k * ${p}u + col;
-sum = sum + A[indexA] * B[indexB];
-}
-let indexC: u32 = b * ${m * p}u + row * ${p}u + col;
-C[indexC] = sum;
-}
-}
-''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('A', buffer);
-      shader.setBuffer('B', other.buffer);
-      shader.setBuffer('C', result.buffer);
-
-// Compute workgroup counts.
-      int wgX = (m + 7) ~/ 8;
-      int wgY = (p + 7) ~/ 8;
-      int wgZ = batch; // Or choose to workgroup-split this if needed.
-      await shader.dispatch(wgX, wgY, wgZ);
-      shader.destroy();
+${wgslLoadFn('load_A', 'A', this)}
+${vec4 ? '' : wgslLoadFn('load_B', 'B', other)}''',
+        loadA: '  return load_A(b * ${m * n}u + row * ${n}u + kk);',
+        loadB4: vec4
+            ? '  return B[(b * ${n * p}u + kk * ${p}u + col) / 4u];'
+            : '''
+  var v: vec4<f32> = vec4<f32>(0.0);
+  for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+    if (col + j < ${p}u) {
+      v[j] = load_B(b * ${n * p}u + kk * ${p}u + col + j);
+    }
+  }
+  return v;''',
+        storeC: '  C[b * ${m * p}u + row * ${p}u + col] = value;',
+        batch: batch,
+      );
+      launchKernel(gpu, shaderCode, [buffer, other.buffer, result.buffer],
+          skinnyGemmWorkgroups(p, batch).count);
       return result;
     }
+
+    final shaderCode = tiledGemmShader(
+      m: m,
+      n: p,
+      k: n,
+      bindings: '''
+${wgslEnableF16(gpu, [this, other])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<${wgslArrayType(other)}>;
+@group(0) @binding(2) var<storage, read_write> C: array<f32>;
+${wgslLoadFn('load_A', 'A', this)}
+${wgslLoadFn('load_B', 'B', other)}''',
+      loadA: '  return load_A(b * ${m * n}u + row * ${n}u + kk);',
+      loadB: '  return load_B(b * ${n * p}u + kk * ${p}u + col);',
+      storeC: '  C[b * ${m * p}u + row * ${p}u + col] = value;',
+      batch: batch,
+    );
+
+    launchKernel(gpu, shaderCode, [buffer, other.buffer, result.buffer],
+        gemmWorkgroups(m, p, batch).count);
+    return result;
+  }
+
+  /// Dense layer `activation(x · W + bias) + residual` in a single kernel.
+  ///
+  /// This tensor is `[..., k]` and [weight] is `[k, n]`, or `[n, k]` with
+  /// [transposeWeight] (the usual layout of stored layer weights, read in
+  /// place without a transpose). [bias] has `n` elements and [residual]
+  /// must broadcast to the `[..., n]` result. Bias, activation and residual
+  /// are applied to each output in the GEMM epilogue, before its only store.
+  /// Any operand may be f16; the result is f32.
+  Future<Tensor> linear(Tensor weight,
+      {Tensor? bias,
+      Activation activation = Activation.none,
+      Tensor? residual,
+      bool transposeWeight = false}) async {
+    if (rank < 1 || weight.rank != 2) {
+      throw Exception("linear requires an input of rank >= 1 and a 2D weight.");
+    }
+    final int k = shape.last;
+    final int n = transposeWeight ? weight.shape[0] : weight.shape[1];
+    if ((transposeWeight ? weight.shape[1] : weight.shape[0]) != k) {
+      throw Exception(
+          "Weight shape ${weight.shape} does not match input shape $shape.");
+    }
+    if (bias != null && bias.size != n) {
+      throw Exception("bias must have $n elements.");
+    }
+    // Leading dimensions are folded into the GEMM rows.
+    final int m = size ~/ k;
+    final List<int> outShape = [...shape.sublist(0, rank - 1), n];
+    final Tensor? residualView = residual?.expand(outShape);
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
+
+    final String enableF16 = wgslEnableF16(gpu, [
+      this,
+      weight,
+      if (bias != null) bias,
+      if (residualView != null) residualView
+    ]);
+    final bindings = StringBuffer('''
+$enableF16@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<${wgslArrayType(weight)}>;
+@group(0) @binding(2) var<storage, read_write> C: array<f32>;
+${wgslLoadFn('load_A', 'A', this)}${wgslLoadFn('load_B', 'B', weight)}''');
+    final buffers = [buffer, weight.buffer, result.buffer];
+    final epilogue = StringBuffer('  var x: f32 = value;\n');
+    if (bias != null) {
+      bindings
+        ..writeln('@group(0) @binding(${buffers.length}) '
+            'var<storage, read_write> Bias: array<${wgslArrayType(bias)}>;')
+        ..write(wgslLoadFn('load_Bias', 'Bias', bias));
+      buffers.add(bias.buffer);
+      epilogue.writeln('  x = x + load_Bias(col);');
+    }
+    if (activation != Activation.none) {
+      epilogue.writeln('  x = ${activation.wgsl};');
+    }
+    if (residualView != null) {
+      bindings
+        ..writeln('@group(0) @binding(${buffers.length}) var<storage, '
+            'read_write> R: array<${wgslArrayType(residualView)}>;')
+        ..write(wgslLoadFn('load_R', 'R', residualView));
+      buffers.add(residualView.buffer);
+      epilogue.writeln('  x = x + load_R(row * ${n}u + col);');
+    }
+    epilogue.write('  C[row * ${n}u + col] = x;');
+
+    final shaderCode = tiledGemmShader(
+      m: m,
+      n: n,
+      k: k,
+      bindings: bindings.toString(),
+      loadA: '  return load_A(row * ${k}u + kk);',
+      loadB: transposeWeight
+          ? '  return load_B(col * ${k}u + kk);'
+          : '  return load_B(kk * ${n}u + col);',
+      storeC: epilogue.toString(),
+    );
+
+    launchKernel(gpu, shaderCode, buffers, gemmWorkgroups(m, n, 1).count);
+    residualView?.destroy();
+    return result;
   }
 
   /// Performs a convolution supporting dilation and multi-channel input.
@@ -137,7 +458,8 @@ C[indexC] = sum;
   /// input is stored in a planar (channel‑first) format, meaning that all
   /// values for channel 0 are stored contiguously, followed by all values
   /// for channel 1, etc.
-
+  ///
+  /// Runs on the same implicit-GEMM / Winograd engine as [conv2dBatched].
   Future<Tensor> conv({
     required Tensor kernel,
     int strideH = 1,
@@ -152,99 +474,33 @@ C[indexC] = sum;
       int H = shape[0];
       int W = shape[1];
       int Cin = shape[2];
-      int kH = kernel.shape[0];
-      int kW = kernel.shape[1];
       int kernelCin = kernel.shape[2];
-      int Cout = kernel.shape[3];
 
       if (Cin != kernelCin) {
         throw Exception(
             "Input channels ($Cin) do not match kernel channels ($kernelCin).");
       }
-      // Effective kernel size after dilation.
-      int eff_kH = dilationH * (kH - 1) + 1;
-      int eff_kW = dilationW * (kW - 1) + 1;
-      // Compute output dimensions.
-      int outH = ((H + 2 * padH - eff_kH) ~/ strideH) + 1;
-      int outW = ((W + 2 * padW - eff_kW) ~/ strideW) + 1;
-
-      // Create output tensor with shape [outH, outW, Cout].
-      Tensor result = await Tensor.create([outH, outW, Cout], gpu: gpu);
-
-      final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
-@group(0) @binding(1) var<storage, read_write> kernel: array<f32>;
-@group(0) @binding(2) var<storage, read_write> output: array<f32>;
-
-// Input dimensions
-const H: u32 = ${H}u;
-const W: u32 = ${W}u;
-const Cin: u32 = ${Cin}u;
-// Kernel dimensions
-const kH: u32 = ${kH}u;
-const kW: u32 = ${kW}u;
-const Cout: u32 = ${Cout}u;
-// Output dimensions
-const outH: u32 = ${outH}u;
-const outW: u32 = ${outW}u;
-// Convolution parameters
-const sH: u32 = ${strideH}u;
-const sW: u32 = ${strideW}u;
-const pH: i32 = $padH;
-const pW: i32 = $padW;
-const dH: u32 = ${dilationH}u;
-const dW: u32 = ${dilationW}u;
-
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
-  if (idx >= outH * outW * Cout) {
-    return;
-  }
-  // Decode output indices.
-  let tmp: u32 = idx / Cout;  // flatten [outH, outW]
-  let o_ch: u32 = idx % Cout;
-  let o_row: u32 = tmp / outW;
-  let o_col: u32 = tmp % outW;
-
-  var sum: f32 = 0.0;
-  // Compute starting coordinate in the input.
-  let inRowStart: i32 = i32(o_row * sH) - pH;
-  let inColStart: i32 = i32(o_col * sW) - pW;
-
-  // Loop over the kernel spatial dimensions.
-  for (var i: u32 = 0u; i < kH; i = i + 1u) {
-    for (var j: u32 = 0u; j < kW; j = j + 1u) {
-      // Calculate input coordinate considering dilation.
-      let inRow: i32 = inRowStart + i32(i * dH);
-      let inCol: i32 = inColStart + i32(j * dW);
-      for (var c: u32 = 0u; c < Cin; c = c + 1u) {
-        var inputVal: f32 = 0.0;
-        if (inRow >= 0 && inRow < i32(H) && inCol >= 0 && inCol < i32(W)) {
-          // Use channel-first (planar) ordering.
-          let inputIndex: u32 = c * (H * W) + (u32(inRow) * W + u32(inCol));
-          inputVal = input[inputIndex];
-        }
-        // Kernel index: kernel shape is [kH, kW, Cin, Cout].
-        let kernelIndex: u32 = ((i * kW + j) * Cin + c) * Cout + o_ch;
-        sum = sum + inputVal * kernel[kernelIndex];
-      }
-    }
-  }
-  // Write the result. Output shape is [outH, outW, Cout].
-  let outIndex: u32 = (o_row * outW + o_col) * Cout + o_ch;
-  output[outIndex] = sum;
-}
-''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', buffer);
-      shader.setBuffer('kernel', kernel.buffer);
-      shader.setBuffer('output', result.buffer);
-      int workgroups = ((outH * outW * Cout) + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
-      return result;
+      final plan = _ConvPlan(
+        batch: 1,
+        cin: Cin,
+        h: H,
+        w: W,
+        cout: kernel.shape[3],
+        kH: kernel.shape[0],
+        kW: kernel.shape[1],
+        strideH: strideH,
+        strideW: strideW,
+        padH: padH,
+        padW: padW,
+        dilationH: dilationH,
+        dilationW: dilationW,
+        // Planar input, [kH, kW, Cin, Cout] filter, [outH, outW, Cout] output.
+        inputIndex: 'c * (H * W) + y * W + x',
+        weightIndex: '((r * KW + s) * CIN + c) * COUT + o',
+        outputIndex: '(y * OUT_W + x) * COUT + o',
+        channelsLast: false,
+      );
+      return _runConv(plan, kernel, [plan.outH, plan.outW, plan.cout]);
     } else {
       // Fallback: for 2D input and 2D kernel use the existing conv2d.
       return conv2d(kernel);
@@ -270,57 +526,330 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
       throw Exception(
           "Kernel dimensions must be smaller than or equal to input dimensions.");
     }
-    int outH = H - kH + 1;
-    int outW = W - kW + 1;
-    int totalOut = outH * outW;
-    // Create the output tensor.
-    Tensor result = await Tensor.create([outH, outW], gpu: gpu);
-
-    // WGSL shader code: each invocation computes one output pixel.
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> input: array<f32>;
-@group(0) @binding(1) var<storage, read_write> kernel: array<f32>;
-@group(0) @binding(2) var<storage, read_write> output: array<f32>;
+    final plan = _ConvPlan(
+      batch: 1,
+      cin: 1,
+      h: H,
+      w: W,
+      cout: 1,
+      kH: kH,
+      kW: kW,
+      strideH: 1,
+      strideW: 1,
+      padH: 0,
+      padW: 0,
+      dilationH: 1,
+      dilationW: 1,
+      inputIndex: 'y * W + x',
+      weightIndex: 'r * KW + s',
+      outputIndex: 'y * OUT_W + x',
+      channelsLast: false,
+    );
+    return _runConv(plan, kernel, [plan.outH, plan.outW]);
+  }
 
-const H: u32 = ${H}u;
-const W: u32 = ${W}u;
-const kH: u32 = ${kH}u;
-const kW: u32 = ${kW}u;
-const outH: u32 = ${outH}u;
-const outW: u32 = ${outW}u;
+  /// Batched 2D convolution over `[N, C, H, W]` or `[N, H, W, C]` inputs.
+  ///
+  /// The filter layout follows [layout]: `[Cout, Cin, kH, kW]` for
+  /// [ConvLayout.nchw] and `[kH, kW, Cin, Cout]` for [ConvLayout.nhwc]. The
+  /// output uses the same activation layout as the input.
+  ///
+  /// The convolution is lowered onto the tiled GEMM kernel with an implicit
+  /// im2col (`M = N·outH·outW`, `N = Cout`, `K = Cin·kH·kW`). 3×3 filters with
+  /// unit stride and dilation take the Winograd F(2x2, 3x3) path instead,
+  /// unless [winograd] is false.
+  Future<Tensor> conv2dBatched(
+    Tensor kernel, {
+    ConvLayout layout = ConvLayout.nchw,
+    int strideH = 1,
+    int strideW = 1,
+    int padH = 0,
+    int padW = 0,
+    int dilationH = 1,
+    int dilationW = 1,
+    bool winograd = true,
+  }) async {
+    if (rank != 4 || kernel.rank != 4) {
+      throw Exception(
+          "conv2dBatched requires a rank-4 input and a rank-4 kernel.");
+    }
+    final bool nhwc = layout == ConvLayout.nhwc;
+    int batch = shape[0];
+    int H = nhwc ? shape[1] : shape[2];
+    int W = nhwc ? shape[2] : shape[3];
+    int Cin = nhwc ? shape[3] : shape[1];
+    int kH = nhwc ? kernel.shape[0] : kernel.shape[2];
+    int kW = nhwc ? kernel.shape[1] : kernel.shape[3];
+    int kernelCin = nhwc ? kernel.shape[2] : kernel.shape[1];
+    int Cout = nhwc ? kernel.shape[3] : kernel.shape[0];
+    if (Cin != kernelCin) {
+      throw Exception(
+          "Input channels ($Cin) do not match kernel channels ($kernelCin).");
+    }
 
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
-  if (idx >= outH * outW) {
-    return;
+    final plan = _ConvPlan(
+      batch: batch,
+      cin: Cin,
+      h: H,
+      w: W,
+      cout: Cout,
+      kH: kH,
+      kW: kW,
+      strideH: strideH,
+      strideW: strideW,
+      padH: padH,
+      padW: padW,
+      dilationH: dilationH,
+      dilationW: dilationW,
+      inputIndex: nhwc
+          ? '((n * H + y) * W + x) * CIN + c'
+          : '((n * CIN + c) * H + y) * W + x',
+      weightIndex: nhwc
+          ? '((r * KW + s) * CIN + c) * COUT + o'
+          : '((o * CIN + c) * KH + r) * KW + s',
+      outputIndex: nhwc
+          ? '((n * OUT_H + y) * OUT_W + x) * COUT + o'
+          : '((n * COUT + o) * OUT_H + y) * OUT_W + x',
+      channelsLast: nhwc,
+    );
+    if (plan.outH <= 0 || plan.outW <= 0) {
+      throw Exception(
+          "Convolution output would be empty for input $shape and kernel ${kernel.shape}.");
+    }
+    final outShape = nhwc
+        ? [batch, plan.outH, plan.outW, Cout]
+        : [batch, Cout, plan.outH, plan.outW];
+    return _runConv(plan, kernel, outShape, winograd: winograd);
   }
-  // Compute row, col in output.
-  let row: u32 = idx / outW;
-  let col: u32 = idx % outW;
-  var sum: f32 = 0.0;
-  // Loop over the kernel.
-  for (var i: u32 = 0u; i < kH; i = i + 1u) {
-    for (var j: u32 = 0u; j < kW; j = j + 1u) {
-      // Input index: corresponding row and col are shifted by kernel offsets.
-      let inRow: u32 = row + i;
-      let inCol: u32 = col + j;
-      let inputIndex: u32 = inRow * W + inCol;
-      let kernelIndex: u32 = i * kW + j;
-      sum = sum + input[inputIndex] * kernel[kernelIndex];
+
+  Future<Tensor> _runConv(_ConvPlan plan, Tensor kernel, List<int> outShape,
+      {bool winograd = true}) async {
+    requireF32(this);
+    requireF32(kernel);
+    // The plan's index math assumes dense operands.
+    final Tensor input = await contiguous();
+    final Tensor weights = await kernel.contiguous();
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
+
+    if (winograd && plan.winogradEligible) {
+      // Pre-transform the filters once: U has shape [Cout, Cin, 4, 4].
+      Tensor transformed =
+          await Tensor.create([plan.cout * plan.cin * 16], gpu: gpu);
+      launchKernel(
+          gpu,
+          plan.winogradFilterShader(),
+          [weights.buffer, transformed.buffer],
+          (plan.cout * plan.cin + 255) ~/ 256);
+
+      int tiles = plan.batch * plan.cout * plan.tilesH * plan.tilesW;
+      launchKernel(gpu, plan.winogradShader(),
+          [input.buffer, transformed.buffer, result.buffer],
+          (tiles + 255) ~/ 256);
+      transformed.destroy();
+      if (!identical(input, this)) input.destroy();
+      if (!identical(weights, kernel)) weights.destroy();
+      return result;
     }
+
+    launchKernel(gpu, plan.gemmShader(),
+        [input.buffer, weights.buffer, result.buffer],
+        gemmWorkgroups(plan.gemmM, plan.gemmN, 1).count);
+    if (!identical(input, this)) input.destroy();
+    if (!identical(weights, kernel)) weights.destroy();
+    return result;
   }
-  output[idx] = sum;
 }
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('kernel', kernel.buffer);
-    shader.setBuffer('output', result.buffer);
-    int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+
+/// Query rows handled by one attention workgroup, one per thread.
+const int _attentionRows = 64;
+
+/// Scaled dot-product attention, `softmax(q · kᵀ * scale + mask) · v`.
+///
+/// [q] is `[..., Lq, D]`, [k] is `[..., Lk, D]` and [v] is `[..., Lk, Dv]`;
+/// the leading (batch and head) dimensions must match and the result is
+/// `[..., Lq, Dv]`. Strided views such as heads split off with `permute` are
+/// read in place. Inputs may be f16; scores and sums are kept in f32 and the
+/// result is f32.
+///
+/// [mask], if given, is added to the scores and must broadcast to
+/// `[..., Lq, Lk]`; use a large negative value to exclude a position. With
+/// [causal], key `j` is hidden from query `i` when `j > i`. [scale]
+/// defaults to `1 / sqrt(D)`.
+///
+/// Each workgroup streams blocks of K and V through workgroup memory and
+/// keeps a running (online) softmax per query row, so the `[Lq, Lk]` score
+/// matrix is never stored.
+Future<Tensor> scaledDotProductAttention(Tensor q, Tensor k, Tensor v,
+    {Tensor? mask, bool causal = false, double? scale}) async {
+  if (q.rank < 2 || k.rank != q.rank || v.rank != q.rank) {
+    throw Exception(
+        "scaledDotProductAttention requires q, k and v of equal rank >= 2.");
+  }
+  final int rank = q.rank;
+  final int lq = q.shape[rank - 2];
+  final int d = q.shape.last;
+  final int lk = k.shape[rank - 2];
+  final int dv = v.shape.last;
+  final List<int> batchShape = q.shape.sublist(0, rank - 2);
+  for (int i = 0; i < rank - 2; i++) {
+    if (k.shape[i] != batchShape[i] || v.shape[i] != batchShape[i]) {
+      throw Exception("Batch dimensions of q, k and v must match.");
+    }
+  }
+  if (k.shape.last != d || v.shape[rank - 2] != lk) {
+    throw Exception("Shapes ${q.shape}, ${k.shape} and ${v.shape} are not "
+        "valid for attention.");
+  }
+  if (d + dv > 2048) {
+    throw Exception("Head dimensions above 2048 combined are not supported.");
+  }
+  final int batch =
+      batchShape.isEmpty ? 1 : batchShape.reduce((a, b) => a * b);
+  final Minigpu gpu = q.gpu;
+  scale ??= 1.0 / math.sqrt(d);
+
+  // Key/value rows staged per step, sized so both blocks fit in 16 KiB of
+  // workgroup memory.
+  final int blockKeys = math.min(64, 4096 ~/ (d + dv));
+
+  Tensor? maskView;
+  if (mask != null) {
+    final List<int> scoreShape = [...batchShape, lq, lk];
+    maskView = mask.expand(scoreShape);
+  }
+  Tensor result = await Tensor.create([...batchShape, lq, dv], gpu: gpu);
+
+  final String scoreMask = maskView != null
+      ? '\n        s = s + load_Mask(b * ${lq * lk}u + qi * LK + key);'
+      : '';
+  final String causalMask = causal
+      ? '\n        s = select(s, -3.0e38, key > qi);'
+      : '';
+  // Causal workgroups can stop at the last key their final query row sees.
+  final String keyEnd =
+      causal ? 'min(LK, rowBase + ${_attentionRows}u)' : 'LK';
+
+  final grid =
+      WorkgroupGrid((lq + _attentionRows - 1) ~/ _attentionRows, batch);
+  final String maskDecl = maskView == null
+      ? ''
+      : '@group(0) @binding(4) var<storage, read_write> Mask: '
+          'array<${wgslArrayType(maskView)}>;\n'
+          '${wgslLoadFn('load_Mask', 'Mask', maskView)}';
+  final String enableF16 =
+      wgslEnableF16(gpu, [q, k, v, if (maskView != null) maskView]);
+  final shaderCode = '''
+$enableF16@group(0) @binding(0) var<storage, read_write> Q: array<${wgslArrayType(q)}>;
+@group(0) @binding(1) var<storage, read_write> K: array<${wgslArrayType(k)}>;
+@group(0) @binding(2) var<storage, read_write> V: array<${wgslArrayType(v)}>;
+@group(0) @binding(3) var<storage, read_write> O: array<f32>;
+$maskDecl
+${wgslLoadFn('load_Q', 'Q', q)}${wgslLoadFn('load_K', 'K', k)}${wgslLoadFn('load_V', 'V', v)}
+const LQ: u32 = ${lq}u;
+const LK: u32 = ${lk}u;
+const D: u32 = ${d}u;
+const DV: u32 = ${dv}u;
+const BC: u32 = ${blockKeys}u;
+const scale: f32 = ${wgslF32(scale)};
+
+var<workgroup> Ks: array<f32, ${blockKeys * d}>;
+var<workgroup> Vs: array<f32, ${blockKeys * dv}>;
+
+@compute @workgroup_size($_attentionRows)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+${grid.wgslGroupId}
+  let b: u32 = wg.y;
+  let rowBase: u32 = wg.x * ${_attentionRows}u;
+  let qi: u32 = rowBase + lid.x;
+  let active: bool = qi < LQ;
+
+  var qv: array<f32, D>;
+  if (active) {
+    for (var c: u32 = 0u; c < D; c = c + 1u) {
+      qv[c] = load_Q((b * LQ + qi) * D + c) * scale;
+    }
+  }
+  var acc: array<f32, DV>;
+  var scores: array<f32, BC>;
+  // Running max and softmax denominator; the max starts finite so fully
+  // masked blocks never produce inf - inf.
+  var m: f32 = -3.0e38;
+  var l: f32 = 0.0;
+
+  let keyEnd: u32 = $keyEnd;
+  for (var kb: u32 = 0u; kb < keyEnd; kb = kb + BC) {
+    for (var e: u32 = lid.x; e < BC * D; e = e + ${_attentionRows}u) {
+      let key: u32 = kb + e / D;
+      var value: f32 = 0.0;
+      if (key < LK) {
+        value = load_K((b * LK + key) * D + e % D);
+      }
+      Ks[e] = value;
+    }
+    for (var e: u32 = lid.x; e < BC * DV; e = e + ${_attentionRows}u) {
+      let key: u32 = kb + e / DV;
+      var value: f32 = 0.0;
+      if (key < LK) {
+        value = load_V((b * LK + key) * DV + e % DV);
+      }
+      Vs[e] = value;
+    }
+    workgroupBarrier();
+
+    if (active) {
+      let count: u32 = min(BC, LK - kb);
+      var blockMax: f32 = m;
+      for (var j: u32 = 0u; j < count; j = j + 1u) {
+        let key: u32 = kb + j;
+        var s: f32 = 0.0;
+        for (var c: u32 = 0u; c < D; c = c + 1u) {
+          s = s + qv[c] * Ks[j * D + c];
+        }$scoreMask$causalMask
+        scores[j] = s;
+        blockMax = max(blockMax, s);
+      }
+      // Rescale what has been accumulated so far to the new maximum.
+      let correction: f32 = exp(m - blockMax);
+      l = l * correction;
+      for (var c: u32 = 0u; c < DV; c = c + 1u) {
+        acc[c] = acc[c] * correction;
+      }
+      for (var j: u32 = 0u; j < count; j = j + 1u) {
+        let p: f32 = select(exp(scores[j] - blockMax), 0.0,
+                            scores[j] <= -3.0e38);
+        l = l + p;
+        for (var c: u32 = 0u; c < DV; c = c + 1u) {
+          acc[c] = acc[c] + p * Vs[j * DV + c];
+        }
+      }
+      m = blockMax;
+    }
+    workgroupBarrier();
   }
+
+  if (active) {
+    // Rows with every key masked out produce zeros.
+    let inv: f32 = select(1.0 / l, 0.0, l == 0.0);
+    for (var c: u32 = 0u; c < DV; c = c + 1u) {
+      O[(b * LQ + qi) * DV + c] = acc[c] * inv;
+    }
+  }
+}
+''';
+
+  launchKernel(
+      gpu,
+      shaderCode,
+      [
+        q.buffer,
+        k.buffer,
+        v.buffer,
+        result.buffer,
+        if (maskView != null) maskView.buffer
+      ],
+      grid.count);
+  maskView?.destroy();
+  return result;
 }
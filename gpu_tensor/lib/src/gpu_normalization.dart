@@ -0,0 +1,286 @@
+import '../gpu_tensor.dart';
+import 'gpu_kernel.dart';
+
+/// Shared-memory state for a workgroup-wide Welford reduction.
+const String _welfordShared = '''
+var<workgroup> wn: array<f32, 256>;
+var<workgroup> wmean: array<f32, 256>;
+var<workgroup> wm2: array<f32, 256>;
+''';
+
+/// WGSL block that runs Welford's algorithm over the row elements
+/// `load(j)` for j = lid.x, lid.x + 256, ... < d, then merges the 256
+/// partial (count, mean, M2) triples with Chan's pairwise update. Afterwards
+/// `wmean[0]` holds the row mean and `wm2[0]` the sum of squared deviations.
+String _welfordRow(String Function(String j) load) => '''
+  var n: f32 = 0.0;
+  var m: f32 = 0.0;
+  var m2: f32 = 0.0;
+  for (var j: u32 = lid.x; j < d; j = j + 256u) {
+    let x: f32 = ${load('j')};
+    n = n + 1.0;
+    let delta: f32 = x - m;
+    m = m + delta / n;
+    m2 = m2 + delta * (x - m);
+  }
+  wn[lid.x] = n;
+  wmean[lid.x] = m;
+  wm2[lid.x] = m2;
+  workgroupBarrier();
+  for (var s: u32 = 128u; s > 0u; s = s >> 1u) {
+    if (lid.x < s && wn[lid.x + s] > 0.0) {
+      let na: f32 = wn[lid.x];
+      let nb: f32 = wn[lid.x + s];
+      let nab: f32 = na + nb;
+      let delta: f32 = wmean[lid.x + s] - wmean[lid.x];
+      wmean[lid.x] = wmean[lid.x] + delta * nb / nab;
+      wm2[lid.x] = wm2[lid.x] + wm2[lid.x + s] + delta * delta * na * nb / nab;
+      wn[lid.x] = nab;
+    }
+    workgroupBarrier();
+  }''';
+
+extension TensorNormalization on Tensor {
+  /// Computes the mean and variance along [axis] in a single pass using
+  /// Welford's algorithm, which stays accurate when the mean is large
+  /// compared to the spread. Returns `(mean, variance)`, both with [axis]
+  /// removed from the shape. The variance is the population variance unless
+  /// [unbiased] is set, in which case it is divided by `d - 1`.
+  Future<(Tensor, Tensor)> meanVar(
+      {int axis = -1, bool unbiased = false}) async {
+    int n = shape.length;
+    // Normalize negative axis.
+    if (axis < 0) {
+      axis += n;
+    }
+    if (axis < 0 || axis >= n) {
+      throw Exception("Axis out of range.");
+    }
+
+    int outer = 1;
+    for (int i = 0; i < axis; i++) {
+      outer *= shape[i];
+    }
+    int d = shape[axis];
+    int inner = 1;
+    for (int i = axis + 1; i < n; i++) {
+      inner *= shape[i];
+    }
+    int totalOut = outer * inner;
+    final int divisor = unbiased ? d - 1 : d;
+
+    List<int> outShape = List.from(shape)..removeAt(axis);
+    Tensor mean = await Tensor.create(outShape, gpu: gpu);
+    Tensor variance = await Tensor.create(outShape, gpu: gpu);
+
+    final header = '''
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> M: array<f32>;
+@group(0) @binding(2) var<storage, read_write> V: array<f32>;
+
+${wgslLoadFn('load_A', 'A', this)}
+const d: u32 = ${d}u;
+const inner: u32 = ${inner}u;
+const totalOut: u32 = ${totalOut}u;
+const divisor: f32 = ${divisor.toDouble()};
+''';
+
+    // Short reductions keep one thread per output; longer ones give each
+    // output a workgroup and merge the per-thread partials.
+    if (d < 256) {
+      final shaderCode = '''
+$header
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
+  if (idx < totalOut) {
+    let base: u32 = (idx / inner) * (d * inner) + idx % inner;
+    var m: f32 = 0.0;
+    var m2: f32 = 0.0;
+    for (var a: u32 = 0u; a < d; a = a + 1u) {
+      let x: f32 = load_A(base + a * inner);
+      let delta: f32 = x - m;
+      m = m + delta / f32(a + 1u);
+      m2 = m2 + delta * (x - m);
+    }
+    M[idx] = m;
+    V[idx] = m2 / divisor;
+  }
+}
+''';
+      launchKernel(gpu, shaderCode, [buffer, mean.buffer, variance.buffer],
+          (totalOut + 255) ~/ 256);
+    } else {
+      final shaderCode = '''
+$header$_welfordShared
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let row: u32 = $wgslGroupIndex;
+  if (row >= totalOut) {
+    return;
+  }
+  let base: u32 = (row / inner) * (d * inner) + row % inner;
+${_welfordRow((j) => 'load_A(base + $j * inner)')}
+  if (lid.x == 0u) {
+    M[row] = wmean[0];
+    V[row] = wm2[0] / divisor;
+  }
+}
+''';
+      launchKernel(
+          gpu, shaderCode, [buffer, mean.buffer, variance.buffer], totalOut);
+    }
+    return (mean, variance);
+  }
+
+  /// Computes the variance along [axis]; see [meanVar].
+  Future<Tensor> variance({int axis = -1, bool unbiased = false}) async {
+    final (mean, variance) = await meanVar(axis: axis, unbiased: unbiased);
+    mean.destroy();
+    return variance;
+  }
+
+  /// Layer normalization over the last dimension:
+  /// `(x - mean) / sqrt(var + eps) * gamma + beta`.
+  ///
+  /// [gamma] and [beta] hold one value per element of the last dimension and
+  /// may be null to skip the scale or the shift. Each row is reduced and
+  /// normalized by one workgroup in a single kernel.
+  Future<Tensor> layerNorm(Tensor? gamma, Tensor? beta,
+      {double eps = 1e-5}) async {
+    final int d = shape.last;
+    _checkRowParam(gamma, d, 'gamma');
+    _checkRowParam(beta, d, 'beta');
+    final int rows = size ~/ d;
+    Tensor result = await Tensor.create(shape, gpu: gpu);
+
+    final buffers = [buffer, result.buffer];
+    final decls = StringBuffer();
+    final loadFns = StringBuffer(wgslLoadFn('load_A', 'A', this));
+    String value = '(load_A(base + j) - mean) * rstd';
+    if (gamma != null) {
+      decls.writeln('@group(0) @binding(${buffers.length}) '
+          'var<storage, read_write> G: array<${wgslArrayType(gamma)}>;');
+      loadFns.write(wgslLoadFn('load_G', 'G', gamma));
+      buffers.add(gamma.buffer);
+      value = '$value * load_G(j)';
+    }
+    if (beta != null) {
+      decls.writeln('@group(0) @binding(${buffers.length}) '
+          'var<storage, read_write> C: array<${wgslArrayType(beta)}>;');
+      loadFns.write(wgslLoadFn('load_C', 'C', beta));
+      buffers.add(beta.buffer);
+      value = '$value + load_C(j)';
+    }
+
+    final String enableF16 = wgslEnableF16(
+        gpu, [this, if (gamma != null) gamma, if (beta != null) beta]);
+    final shaderCode = '''
+$enableF16@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<f32>;
+$decls
+$loadFns
+const d: u32 = ${d}u;
+const rows: u32 = ${rows}u;
+const eps: f32 = ${wgslF32(eps)};
+$_welfordShared
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let row: u32 = $wgslGroupIndex;
+  if (row >= rows) {
+    return;
+  }
+  let base: u32 = row * d;
+${_welfordRow((j) => 'load_A(base + $j)')}
+  let mean: f32 = wmean[0];
+  let rstd: f32 = inverseSqrt(wm2[0] / f32(d) + eps);
+  for (var j: u32 = lid.x; j < d; j = j + 256u) {
+    B[base + j] = $value;
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, buffers, rows);
+    return result;
+  }
+
+  /// RMS normalization over the last dimension:
+  /// `x / sqrt(mean(x^2) + eps) * weight`.
+  ///
+  /// [weight] holds one value per element of the last dimension and may be
+  /// null to skip the scale. Each row is reduced and normalized by one
+  /// workgroup in a single kernel.
+  Future<Tensor> rmsNorm(Tensor? weight, {double eps = 1e-6}) async {
+    final int d = shape.last;
+    _checkRowParam(weight, d, 'weight');
+    final int rows = size ~/ d;
+    Tensor result = await Tensor.create(shape, gpu: gpu);
+
+    final buffers = [buffer, result.buffer];
+    String value = 'load_A(base + j) * rstd';
+    String weightDecl = '';
+    String weightLoad = '';
+    if (weight != null) {
+      weightDecl = '@group(0) @binding(2) '
+          'var<storage, read_write> W: array<${wgslArrayType(weight)}>;';
+      weightLoad = wgslLoadFn('load_W', 'W', weight);
+      buffers.add(weight.buffer);
+      value = '$value * load_W(j)';
+    }
+
+    final String enableF16 =
+        wgslEnableF16(gpu, [this, if (weight != null) weight]);
+    final shaderCode = '''
+$enableF16@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<f32>;
+$weightDecl
+
+${wgslLoadFn('load_A', 'A', this)}$weightLoad
+const d: u32 = ${d}u;
+const rows: u32 = ${rows}u;
+const eps: f32 = ${wgslF32(eps)};
+var<workgroup> partial: array<f32, 256>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let row: u32 = $wgslGroupIndex;
+  if (row >= rows) {
+    return;
+  }
+  let base: u32 = row * d;
+  var acc: f32 = 0.0;
+  for (var j: u32 = lid.x; j < d; j = j + 256u) {
+    let x: f32 = load_A(base + j);
+    acc = acc + x * x;
+  }
+  partial[lid.x] = acc;
+  workgroupBarrier();
+  for (var s: u32 = 128u; s > 0u; s = s >> 1u) {
+    if (lid.x < s) {
+      partial[lid.x] = partial[lid.x] + partial[lid.x + s];
+    }
+    workgroupBarrier();
+  }
+  let rstd: f32 = inverseSqrt(partial[0] / f32(d) + eps);
+  for (var j: u32 = lid.x; j < d; j = j + 256u) {
+    B[base + j] = $value;
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, buffers, rows);
+    return result;
+  }
+
+  void _checkRowParam(Tensor? param, int d, String name) {
+    if (param != null && param.size != d) {
+      throw Exception(
+          "$name must have $d elements to match the last dimension.");
+    }
+  }
+}
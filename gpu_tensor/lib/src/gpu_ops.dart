@@ -1,65 +1,27 @@
 import 'package:minigpu/minigpu.dart';
 
+import 'gpu_kernel.dart';
 import 'gpu_tensor_base.dart';
 
 extension TensorOperator on Tensor {
+  /// Applies [expression] (over locals `a` and `b`) elementwise to this
+  /// tensor and [other], broadcast together NumPy-style: shapes are aligned
+  /// from the right and size-1 dimensions repeat. The smaller operand is read
+  /// in place through a stride-0 index, never expanded in memory.
+  Future<Tensor> _binary(Tensor other, String expression) async {
+    final List<int> outShape = broadcastShapes(shape, other.shape);
+    return elementwise(gpu, [this, other], outShape, expression);
+  }
+
   /// Elementwise addition. Returns a new tensor with the result.
-  /// (Assumes both tensors have the same shape.)
+  /// The shapes are broadcast together (e.g. adding a bias row to a matrix).
   Future<Tensor> add(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise addition");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-let i: u32 = gid.x;
-if (i < ${size}u) {
-C[i] = A[i] + B[i];
-}
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'a + b');
   }
 
   /// Elementwise subtraction.
   Future<Tensor> subtract(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise subtraction");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-let i: u32 = gid.x;
-if (i < ${size}u) {
-C[i] = A[i] - B[i];
-}
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'a - b');
   }
 
   /// Operator overloads for more natural syntax.
@@ -115,480 +77,113 @@ C[i] = A[i] - B[i];
 
   /// Elementwise multiplication (Hadamard product).
   Future<Tensor> multiply(Tensor other) async {
-    if (other.size != size) {
-      throw Exception(
-          "Tensor sizes do not match for elementwise multiplication");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-let i: u32 = gid.x;
-if (i < ${size}u) {
-C[i] = A[i] * B[i];
-}
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'a * b');
   }
 
   /// Adds a scalar value to every element in the tensor.
   Future<Tensor> addScalar(double scalar) async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = A[i] + $scalar;
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'a + s0', scalars: [scalar]);
   }
 
   /// Subtracts a scalar value from every element in the tensor.
   Future<Tensor> subtractScalar(double scalar) async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = A[i] - $scalar;
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'a - s0', scalars: [scalar]);
   }
 
   /// Multiplies every element in the tensor by a scalar value.
   Future<Tensor> multiplyScalar(double scalar) async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-let i: u32 = gid.x;
-if (i < ${size}u) {
-B[i] = A[i] * $scalar;
-}
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'a * s0', scalars: [scalar]);
   }
 
   /// Elementwise division (A / B).
   Future<Tensor> divide(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise division");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    C[i] = A[i] / B[i];
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'a / b');
   }
 
   /// Divides every element in the tensor by a scalar.
   Future<Tensor> divideScalar(double scalar) async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = A[i] / $scalar;
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'a / s0', scalars: [scalar]);
   }
 
   /// Raises every element in the tensor to the power of [exponent].
   Future<Tensor> powScalar(double exponent) async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = pow(A[i], $exponent);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'pow(a, s0)',
+        scalars: [exponent]);
   }
 
   /// Computes the natural logarithm (ln) of each element.
   Future<Tensor> log() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = log(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'log(a)');
   }
 
   /// Computes the exponential (e^x) of each element.
   Future<Tensor> exp() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = exp(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'exp(a)');
   }
 
   /// Computes the square root of each element.
   Future<Tensor> sqrt() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = sqrt(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'sqrt(a)');
   }
 
   /// Computes the modulus (remainder) of each element by [divisor].
   Future<Tensor> modScalar(double divisor) async {
-    // Ensure the divisor is expressed as a float literal (e.g. "3.0")
-    String divisorLiteral = divisor.toStringAsFixed(1);
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = A[i] % $divisorLiteral;
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'a % s0', scalars: [divisor]);
   }
 
   /// Elementwise modulus for two tensors.
   Future<Tensor> mod(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise modulus");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    C[i] = A[i] % B[i];
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'a % b');
   }
 
   /// Performs an elementwise "greater than" comparison.
   /// Returns a tensor where each element is 1.0 if A[i] > other[i], otherwise 0.0.
   Future<Tensor> greaterThan(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise comparison");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    if (A[i] > B[i]) {
-      C[i] = 1.0;
-    } else {
-      C[i] = 0.0;
-    }
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a > b)');
   }
 
   /// Performs an elementwise "less than" comparison.
   /// Returns a tensor where each element is 1.0 if A[i] < other[i], otherwise 0.0.
   Future<Tensor> lessThan(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise comparison");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    if (A[i] < B[i]) {
-      C[i] = 1.0;
-    } else {
-      C[i] = 0.0;
-    }
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a < b)');
   }
 
   /// Performs an elementwise equality comparison.
   /// Returns a tensor where each element is 1.0 if A[i] equals other[i], otherwise 0.0.
   Future<Tensor> equalTo(Tensor other) async {
-    if (other.size != size) {
-      throw Exception("Tensor sizes do not match for elementwise comparison");
-    }
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@group(0) @binding(2) var<storage, read_write> C: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    if (A[i] == B[i]) {
-      C[i] = 1.0;
-    } else {
-      C[i] = 0.0;
-    }
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', other.buffer);
-    shader.setBuffer('C', result.buffer);
-    int workgroups = (size + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a == b)');
   }
 
   /// Performs an elementwise "not equal" comparison.
   /// Returns a tensor where each element is 1.0 if A[i] != other[i], otherwise 0.0.
   Future<Tensor> notEqualTo(Tensor other) async {
-    // Implement by reusing equalTo and then subtracting from a tensor of ones.
-    Tensor eq = await equalTo(other);
-    Tensor ones = await Tensor.create(shape);
-    // Fill 'ones' with 1.0.
-    ones = await ones.addScalar(1.0);
-    // ones - eq gives 1.0 for not equal cases.
-    Tensor result = await ones.subtract(eq);
-    eq.destroy();
-    ones.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a != b)');
   }
 
   /// Performs an elementwise "greater than or equal to" comparison.
   /// Returns a tensor with 1.0 if A[i] >= other[i], otherwise 0.0.
   Future<Tensor> greaterThanOrEqual(Tensor other) async {
-    // A >= B is equivalent to NOT (A < B)
-    Tensor lt = await lessThan(other);
-    Tensor ones = await Tensor.create(shape);
-    ones = await ones.addScalar(1.0);
-    Tensor result = await ones.subtract(lt);
-    lt.destroy();
-    ones.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a >= b)');
   }
 
   /// Performs an elementwise "less than or equal to" comparison.
   /// Returns a tensor with 1.0 if A[i] <= other[i], otherwise 0.0.
   Future<Tensor> lessThanOrEqual(Tensor other) async {
-    // A <= B is equivalent to NOT (A > B)
-    Tensor gt = await greaterThan(other);
-    Tensor ones = await Tensor.create(shape);
-    ones = await ones.addScalar(1.0);
-    Tensor result = await ones.subtract(gt);
-    gt.destroy();
-    ones.destroy();
-    return result;
+    return _binary(other, 'select(0.0, 1.0, a <= b)');
   }
 
   /// Computes the absolute value of each element.
   Future<Tensor> abs() async {
-    Tensor result = await Tensor.create(shape);
-    final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
-@group(0) @binding(1) var<storage, read_write> B: array<f32>;
-@compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let i: u32 = gid.x;
-  if (i < ${size}u) {
-    B[i] = abs(A[i]);
-  }
-}
-''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
-    int wk = (size + 255) ~/ 256;
-    await shader.dispatch(wk, 1, 1);
-    shader.destroy();
-    return result;
+    return elementwise(gpu, [this], shape, 'abs(a)');
   }
 
   /// Reduces the tensor by summing values along the last dimension.
   /// For a tensor of shape [..., d], returns a tensor of shape [...].
-  Future<Tensor> sum({int axis = -1}) async {
+  Future<Tensor> sum({int axis = -1}) => _sum(axis, 1.0);
+
+  /// Sums along [axis] and multiplies each result by [scale] in the same
+  /// kernel.
+  Future<Tensor> _sum(int axis, double scale) async {
     int n = shape.length;
     // Normalize negative axis.
     if (axis < 0) {
@@ -612,19 +207,28 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
 
     // Build output shape by removing the reduced axis.
     List<int> outShape = List.from(shape)..removeAt(axis);
-    Tensor result = await Tensor.create(outShape);
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
+
+    // Long contiguous rows get a workgroup each instead of a single thread.
+    if (inner == 1 && d >= 1024 && totalOut <= 65535) {
+      await _sumRows(result, d, totalOut, scale);
+      return result;
+    }
 
     final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
 @group(0) @binding(1) var<storage, read_write> B: array<f32>;
 
+${wgslLoadFn('load_A', 'A', this)}
 const d: u32 = ${d}u;
 const inner: u32 = ${inner}u;
 const totalOut: u32 = ${totalOut}u;
+const scale: f32 = ${wgslF32(scale)};
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx < totalOut) {
     let outer: u32 = idx / inner;
     let r: u32 = idx % inner;
@@ -632,22 +236,80 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
     let base: u32 = outer * (d * inner) + r;
     var sum: f32 = 0.0;
     for (var a: u32 = 0u; a < d; a = a + 1u) {
-      sum = sum + A[base + a * inner];
+      sum = sum + load_A(base + a * inner);
     }
-    B[idx] = sum;
+    B[idx] = sum * scale;
   }
 }
 ''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], workgroups);
     return result;
   }
 
+  /// Sums [rows] rows of length [d] into [result], one workgroup per row,
+  /// multiplying each sum by [scale].
+  /// Partial sums are combined with subgroup operations when the device has
+  /// the subgroups feature, and with a shared-memory tree otherwise.
+  Future<void> _sumRows(Tensor result, int d, int rows, double scale) async {
+    final bool subgroups = gpu.hasFeature(MinigpuFeature.subgroups);
+    final String combine = subgroups
+        ? '''
+  // One partial per subgroup; subgroups are at least 4 wide.
+  let s: f32 = subgroupAdd(acc);
+  if (sg_id == 0u) {
+    partial[lid.x / sg_size] = s;
+  }
+  workgroupBarrier();
+  if (lid.x == 0u) {
+    var total: f32 = 0.0;
+    for (var i: u32 = 0u; i < 256u / sg_size; i = i + 1u) {
+      total = total + partial[i];
+    }
+    B[row] = total * scale;
+  }'''
+        : '''
+  partial[lid.x] = acc;
+  workgroupBarrier();
+  for (var s: u32 = 128u; s > 0u; s = s >> 1u) {
+    if (lid.x < s) {
+      partial[lid.x] = partial[lid.x] + partial[lid.x + s];
+    }
+    workgroupBarrier();
+  }
+  if (lid.x == 0u) {
+    B[row] = partial[0] * scale;
+  }''';
+    final String subgroupArgs = subgroups
+        ? ''',
+        @builtin(subgroup_invocation_id) sg_id: u32,
+        @builtin(subgroup_size) sg_size: u32'''
+        : '';
+    final shaderCode = '''
+${subgroups ? 'enable subgroups;' : ''}
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<f32>;
+
+${wgslLoadFn('load_A', 'A', this)}
+const d: u32 = ${d}u;
+const scale: f32 = ${wgslF32(scale)};
+var<workgroup> partial: array<f32, 256>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>$subgroupArgs) {
+  let row: u32 = wid.x;
+  let base: u32 = row * d;
+  var acc: f32 = 0.0;
+  for (var i: u32 = lid.x; i < d; i = i + 256u) {
+    acc = acc + load_A(base + i);
+  }
+$combine
+}
+''';
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], rows);
+  }
+
   /// Reduces the tensor by computing the mean along the given dimension.
   Future<Tensor> mean({int axis = -1}) async {
     int n = shape.length;
@@ -658,13 +320,8 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
     if (axis < 0 || axis >= n) {
       throw Exception("Axis out of range.");
     }
-    // Compute sum along the specified axis.
-    Tensor sums = await sum(axis: axis);
-    // Use the original dimension for division.
-    int d = shape[axis];
-    Tensor result = await sums.multiplyScalar(1.0 / d);
-    sums.destroy();
-    return result;
+    // The division is folded into the sum kernel.
+    return _sum(axis, 1.0 / shape[axis]);
   }
 
   /// Reduces the tensor by taking the maximum value along the last dimension.
@@ -692,41 +349,38 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
 
     // Build output shape by removing the reduced axis.
     List<int> outShape = List.from(shape)..removeAt(axis);
-    Tensor result = await Tensor.create(outShape);
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
 
     final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
 @group(0) @binding(1) var<storage, read_write> B: array<f32>;
 
+${wgslLoadFn('load_A', 'A', this)}
 const d: u32 = ${d}u;
 const inner: u32 = ${inner}u;
 const totalOut: u32 = ${totalOut}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx < totalOut) {
     let outer: u32 = idx / inner;
     let r: u32 = idx % inner;
     // Calculate the base index for this reduction slice.
     let base: u32 = outer * (d * inner) + r;
-    var max_val: f32 = A[base];
+    var max_val: f32 = load_A(base);
     // Iterate over the reduced dimension.
     for (var j: u32 = 1u; j < d; j = j + 1u) {
-      max_val = max(max_val, A[base + j * inner]);
+      max_val = max(max_val, load_A(base + j * inner));
     }
     B[idx] = max_val;
   }
 }
 ''';
 
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], workgroups);
     return result;
   }
 
@@ -755,40 +409,37 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
 
     // Build output shape by removing the reduced axis.
     List<int> outShape = List.from(shape)..removeAt(axis);
-    Tensor result = await Tensor.create(outShape);
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
 
     final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
 @group(0) @binding(1) var<storage, read_write> B: array<f32>;
 
+${wgslLoadFn('load_A', 'A', this)}
 const d: u32 = ${d}u;
 const inner: u32 = ${inner}u;
 const totalOut: u32 = ${totalOut}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx < totalOut) {
     let outer: u32 = idx / inner;
     let r: u32 = idx % inner;
     // Calculate base index for the reduction slice.
     let base: u32 = outer * (d * inner) + r;
-    var min_val: f32 = A[base];
+    var min_val: f32 = load_A(base);
     for (var j: u32 = 1u; j < d; j = j + 1u) {
-      min_val = min(min_val, A[base + j * inner]);
+      min_val = min(min_val, load_A(base + j * inner));
     }
     B[idx] = min_val;
   }
 }
 ''';
 
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], workgroups);
     return result;
   }
 
@@ -819,28 +470,30 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
 
     // Build output shape by removing the reduced axis.
     List<int> outShape = List.from(shape)..removeAt(axis);
-    Tensor result = await Tensor.create(outShape);
+    Tensor result = await Tensor.create(outShape, gpu: gpu);
 
     final shaderCode = '''
-@group(0) @binding(0) var<storage, read_write> A: array<f32>;
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
 @group(0) @binding(1) var<storage, read_write> B: array<f32>;
 
+${wgslLoadFn('load_A', 'A', this)}
 const d: u32 = ${d}u;
 const inner: u32 = ${inner}u;
 const totalOut: u32 = ${totalOut}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx < totalOut) {
     let outer: u32 = idx / inner;
     let r: u32 = idx % inner;
     // Calculate the base index for this reduction slice.
     let base: u32 = outer * (d * inner) + r;
-    var max_val: f32 = A[base];
+    var max_val: f32 = load_A(base);
     var max_index: u32 = 0u;
     for (var j: u32 = 1u; j < d; j = j + 1u) {
-      let val = A[base + j * inner];
+      let val = load_A(base + j * inner);
       if (val > max_val) {
          max_val = val;
          max_index = j;
@@ -851,13 +504,8 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
 }
 ''';
 
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('A', buffer);
-    shader.setBuffer('B', result.buffer);
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, result.buffer], workgroups);
     return result;
   }
 }
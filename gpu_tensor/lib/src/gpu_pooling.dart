@@ -1,5 +1,7 @@
 import 'package:minigpu/minigpu.dart';
 import 'gpu_tensor_base.dart';
+import 'gpu_data.dart';
+import 'gpu_kernel.dart';
 
 extension TensorPoolingMax on Tensor {
   Future<Tensor> maxPool({
@@ -8,6 +10,7 @@ extension TensorPoolingMax on Tensor {
     List<int>? pads,
     List<int>? poolAxes,
   }) async {
+    requireF32(this);
     int effectiveRank = shape.length;
     int numPool = poolSizes.length;
     strides ??= List.filled(numPool, 1);
@@ -72,8 +75,9 @@ ${() {
     }()}
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx >= totalOut) {
     return;
   }
@@ -147,13 +151,11 @@ ${() {
 }
 ''';
 
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
+    // The pooling loops index the input densely.
+    final Tensor input = await contiguous();
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [input.buffer, result.buffer], workgroups);
+    if (!identical(input, this)) input.destroy();
     return result;
   }
 }
@@ -165,6 +167,7 @@ extension TensorPoolingMin on Tensor {
     List<int>? pads,
     List<int>? poolAxes,
   }) async {
+    requireF32(this);
     int effectiveRank = shape.length;
     int numPool = poolSizes.length;
     strides ??= List.filled(numPool, 1);
@@ -229,8 +232,9 @@ ${() {
     }()}
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let idx: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
   if (idx >= totalOut) {
     return;
   }
@@ -304,13 +308,11 @@ ${() {
 }
 ''';
 
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', result.buffer);
+    // The pooling loops index the input densely.
+    final Tensor input = await contiguous();
     int workgroups = (totalOut + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [input.buffer, result.buffer], workgroups);
+    if (!identical(input, this)) input.destroy();
     return result;
   }
 }
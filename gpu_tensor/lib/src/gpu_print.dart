@@ -11,20 +11,20 @@ extension TensorPrintHelpers on Tensor {
       throw Exception(
           "Counts length (${counts.length}) does not match tensor rank (${shape.length}).");
     }
-    if (shape.length == 2) {
+    // Rows of a 2D tensor are read directly as long as each row is dense.
+    if (shape.length == 2 && strides[1] == 1) {
       int numRows = counts[0];
       int numCols = counts[1];
-      int totalCols = shape[1];
       List<List<double>> rows = [];
       for (int r = 0; r < numRows; r++) {
         final rowData = Float32List(numCols);
         // Compute flat offset for the row start.
-        await buffer.read(rowData, numCols, readOffset: r * totalCols);
+        await buffer.read(rowData, numCols, readOffset: offset + r * strides[0]);
         rows.add(rowData);
       }
       return _format2D(rows, pretty: pretty);
     } else {
-      // Fallback for tensor rank != 2: use slicing.
+      // Fallback for other ranks and strided rows: use slicing.
       List<int> startIndices = List.filled(shape.length, 0);
       Tensor subTensor =
           await slice(startIndices: startIndices, endIndices: counts);
@@ -40,7 +40,7 @@ extension TensorPrintHelpers on Tensor {
       throw Exception(
           "Counts length (${counts.length}) does not match tensor rank (${shape.length}).");
     }
-    if (shape.length == 2) {
+    if (shape.length == 2 && strides[1] == 1) {
       int numRows = counts[0];
       int numCols = counts[1];
       int totalCols = shape[1];
@@ -50,12 +50,12 @@ extension TensorPrintHelpers on Tensor {
       for (int r = startRow; r < shape[0]; r++) {
         final rowData = Float32List(numCols);
         await buffer.read(rowData, numCols,
-            readOffset: r * totalCols + startCol);
+            readOffset: offset + r * strides[0] + startCol);
         rows.add(rowData);
       }
       return _format2D(rows, pretty: pretty);
     } else {
-      // For higher-dimensional tensors, use slicing:
+      // For other ranks and strided rows, use slicing:
       List<int> startIndices = [];
       for (int i = 0; i < shape.length; i++) {
         if (counts[i] > shape[i]) {
@@ -0,0 +1,260 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_gemm.dart';
+import 'gpu_kernel.dart';
+import 'gpu_tensor_base.dart';
+
+/// A `[k, n]` weight matrix stored as unsigned 8- or 4-bit codes with a
+/// scale and zero point per group of [groupSize] rows of each column:
+///
+///   w[kk, col] = (code[kk, col] - zero[g, col]) * scale[g, col],
+///   g = kk ~/ groupSize
+///
+/// Codes are packed into u32 words along K, `32 ~/ bits` per word, with the
+/// words of one K step laid out across the columns (`word * n + col`), so
+/// neighbouring threads of a kernel read neighbouring words. [scales] and
+/// [zeros] are f32 tensors of shape `[groups, n]`.
+///
+/// Weights are dequantized in registers by [QuantizedMatMul.matMulQuantized];
+/// the f32 matrix is never materialized on the GPU.
+///
+/// The parts are ordinary tensors, so [Tensor.scope] does not see through a
+/// returned [QuantizedTensor]; quantize outside scopes or call [destroy].
+class QuantizedTensor {
+  QuantizedTensor._(this.shape, this.bits, this.groupSize, this.packed,
+      this.scales, this.zeros);
+
+  /// Logical shape `[k, n]`.
+  final List<int> shape;
+
+  /// Bits per code: 8 or 4.
+  final int bits;
+
+  /// Rows of K sharing one scale and zero point.
+  final int groupSize;
+
+  /// Packed codes, `ceil(k / (32 / bits)) * n` u32 words (uploaded through an
+  /// f32 view of the same bytes).
+  final Tensor packed;
+
+  final Tensor scales;
+  final Tensor zeros;
+
+  Minigpu get gpu => packed.gpu;
+
+  /// Codes per u32 word.
+  int get codesPerWord => 32 ~/ bits;
+
+  /// Device bytes used by codes, scales and zero points.
+  int get sizeInBytes => (packed.size + scales.size + zeros.size) * 4;
+
+  /// Quantizes the row-major `[k, n]` matrix [weights] on the CPU and
+  /// uploads it. Each group of [groupSize] rows of a column maps its min..max
+  /// range linearly onto the code range. [groupSize] must be a positive
+  /// multiple of 8.
+  static Future<QuantizedTensor> quantize(Float32List weights, List<int> shape,
+      {int bits = 8, int groupSize = 64, Minigpu? gpu}) async {
+    if (bits != 8 && bits != 4) {
+      throw Exception("Only 8- and 4-bit quantization is supported.");
+    }
+    if (shape.length != 2 || weights.length != shape[0] * shape[1]) {
+      throw Exception("quantize expects a [k, n] matrix, got shape $shape "
+          "with ${weights.length} values.");
+    }
+    if (groupSize <= 0 || groupSize % 8 != 0) {
+      throw Exception("groupSize must be a positive multiple of 8.");
+    }
+    final int k = shape[0];
+    final int n = shape[1];
+    final int perWord = 32 ~/ bits;
+    final int levels = (1 << bits) - 1;
+    final int groups = (k + groupSize - 1) ~/ groupSize;
+    final int words = (k + perWord - 1) ~/ perWord;
+
+    final scaleData = Float32List(groups * n);
+    final zeroData = Float32List(groups * n);
+    final packedData = Uint32List(words * n);
+    for (int g = 0; g < groups; g++) {
+      final int start = g * groupSize;
+      final int end = math.min(start + groupSize, k);
+      for (int col = 0; col < n; col++) {
+        double lo = double.infinity;
+        double hi = double.negativeInfinity;
+        for (int kk = start; kk < end; kk++) {
+          final double w = weights[kk * n + col];
+          lo = math.min(lo, w);
+          hi = math.max(hi, w);
+        }
+        // A constant group still needs a usable scale.
+        final double scale = hi > lo ? (hi - lo) / levels : 1.0;
+        final double zero = -lo / scale;
+        scaleData[g * n + col] = scale;
+        zeroData[g * n + col] = zero;
+        for (int kk = start; kk < end; kk++) {
+          final int code = (weights[kk * n + col] / scale + zero)
+              .round()
+              .clamp(0, levels);
+          packedData[(kk ~/ perWord) * n + col] |=
+              code << ((kk % perWord) * bits);
+        }
+      }
+    }
+
+    gpu ??= DefaultMinigpu.instance;
+    return QuantizedTensor._(
+      List<int>.from(shape),
+      bits,
+      groupSize,
+      await Tensor.create([packedData.length],
+          gpu: gpu, data: packedData.buffer.asFloat32List()),
+      await Tensor.create([groups, n], gpu: gpu, data: scaleData),
+      await Tensor.create([groups, n], gpu: gpu, data: zeroData),
+    );
+  }
+
+  /// WGSL constants and bindings for the packed weight, starting at
+  /// `@binding(first)`.
+  String _wgslDecls(int first) => '''
+@group(0) @binding($first) var<storage, read_write> Q: array<u32>;
+@group(0) @binding(${first + 1}) var<storage, read_write> S: array<f32>;
+@group(0) @binding(${first + 2}) var<storage, read_write> Z: array<f32>;
+const QK: u32 = ${shape[0]}u;
+const QN: u32 = ${shape[1]}u;
+const QBITS: u32 = ${bits}u;
+const QPER: u32 = ${codesPerWord}u;
+const QMASK: u32 = ${(1 << bits) - 1}u;
+const QGROUP: u32 = ${groupSize}u;
+
+fn dequant(kk: u32, col: u32) -> f32 {
+  let word: u32 = Q[(kk / QPER) * QN + col];
+  let code: u32 = (word >> ((kk % QPER) * QBITS)) & QMASK;
+  let g: u32 = (kk / QGROUP) * QN + col;
+  return (f32(code) - Z[g]) * S[g];
+}
+''';
+
+  /// Expands the weights to a dense f32 `[k, n]` tensor.
+  Future<Tensor> dequantize() async {
+    final int total = shape[0] * shape[1];
+    Tensor result = await Tensor.create(shape, gpu: gpu);
+    final shaderCode = '''
+${_wgslDecls(0)}
+@group(0) @binding(3) var<storage, read_write> Out: array<f32>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < ${total}u) {
+    Out[i] = dequant(i / QN, i % QN);
+  }
+}
+''';
+    launchKernel(
+        gpu,
+        shaderCode,
+        [packed.buffer, scales.buffer, zeros.buffer, result.buffer],
+        (total + 255) ~/ 256);
+    return result;
+  }
+
+  void destroy() {
+    packed.destroy();
+    scales.destroy();
+    zeros.destroy();
+  }
+}
+
+extension QuantizedMatMul on Tensor {
+  /// Multiplies this `[..., k]` tensor by the quantized `[k, n]` [weight],
+  /// returning `[..., n]`. Leading dimensions are folded into the rows.
+  ///
+  /// Up to [skinnyGemmMaxM] rows run a GEMV kernel in which each thread owns
+  /// one column and decodes a whole u32 word (4 or 8 K steps) per load; more
+  /// rows run the tiled GEMM, dequantizing while B tiles are staged.
+  Future<Tensor> matMulQuantized(QuantizedTensor weight) async {
+    final int k = weight.shape[0];
+    final int n = weight.shape[1];
+    if (shape.last != k) {
+      throw Exception(
+          "Input shape $shape does not match quantized weight ${weight.shape}.");
+    }
+    final int m = size ~/ k;
+    Tensor result =
+        await Tensor.create([...shape.sublist(0, rank - 1), n], gpu: gpu);
+    final buffers = [
+      buffer,
+      weight.packed.buffer,
+      weight.scales.buffer,
+      weight.zeros.buffer,
+      result.buffer
+    ];
+    final String decls = '''
+@group(0) @binding(0) var<storage, read_write> A: array<f32>;
+${weight._wgslDecls(1)}
+@group(0) @binding(4) var<storage, read_write> C: array<f32>;
+${wgslIndexFn('idx_A', this)}''';
+
+    if (m > skinnyGemmMaxM) {
+      final shaderCode = tiledGemmShader(
+        m: m,
+        n: n,
+        k: k,
+        bindings: decls,
+        loadA: '  return A[idx_A(row * ${k}u + kk)];',
+        loadB: '  return dequant(kk, col);',
+        storeC: '  C[row * ${n}u + col] = value;',
+      );
+      launchKernel(gpu, shaderCode, buffers, gemmWorkgroups(m, n, 1).count);
+      return result;
+    }
+
+    final shaderCode = '''
+$decls
+const M: u32 = ${m}u;
+const WORDS: u32 = ${(k + weight.codesPerWord - 1) ~/ weight.codesPerWord}u;
+var<workgroup> partial: array<f32, 256>;
+
+@compute @workgroup_size(64, 4, 1)
+fn main(@builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let col: u32 = ($wgslGroupIndex) * 64u + lid.x;
+  var acc: array<f32, M>;
+  if (col < QN) {
+    // The four rows of threads take every fourth word along K.
+    for (var w: u32 = lid.y; w < WORDS; w = w + 4u) {
+      let word: u32 = Q[w * QN + col];
+      let g: u32 = (w * QPER / QGROUP) * QN + col;
+      let scale: f32 = S[g];
+      let bias: f32 = -Z[g] * scale;
+      for (var j: u32 = 0u; j < QPER; j = j + 1u) {
+        let kk: u32 = w * QPER + j;
+        if (kk < QK) {
+          let v: f32 = f32((word >> (j * QBITS)) & QMASK) * scale + bias;
+          for (var r: u32 = 0u; r < M; r = r + 1u) {
+            acc[r] = acc[r] + A[idx_A(r * QK + kk)] * v;
+          }
+        }
+      }
+    }
+  }
+
+  for (var r: u32 = 0u; r < M; r = r + 1u) {
+    partial[lid.y * 64u + lid.x] = acc[r];
+    workgroupBarrier();
+    if (lid.y == 0u && col < QN) {
+      C[r * QN + col] = partial[lid.x] + partial[64u + lid.x] +
+          partial[128u + lid.x] + partial[192u + lid.x];
+    }
+    workgroupBarrier();
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, buffers, (n + 63) ~/ 64);
+    return result;
+  }
+}
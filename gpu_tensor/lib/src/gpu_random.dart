@@ -0,0 +1,208 @@
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_data.dart';
+import 'gpu_kernel.dart';
+import 'gpu_tensor_base.dart';
+
+/// Seed and next unused Philox counter of one context.
+class _RandomState {
+  _RandomState(this.seed);
+
+  int seed;
+  int counter = 0;
+}
+
+final _randomStates = Expando<_RandomState>('gpu_tensor.random');
+
+_RandomState _stateOf(Minigpu gpu) => _randomStates[gpu] ??=
+    _RandomState(DateTime.now().microsecondsSinceEpoch);
+
+/// Restarts [gpu]'s random stream from [seed]; see [Tensor.manualSeed].
+void seedRandom(Minigpu gpu, int seed) {
+  _stateOf(gpu)
+    ..seed = seed
+    ..counter = 0;
+}
+
+/// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+/// 1, 2, 3"). Each 128-bit counter maps to four independent u32s, so any
+/// element's value depends only on the seed and its counter, never on how
+/// the work is split into threads.
+const String _wgslPhilox = '''
+const PHILOX_M0: u32 = 0xD2511F53u;
+const PHILOX_M1: u32 = 0xCD9E8D57u;
+const PHILOX_W0: u32 = 0x9E3779B9u;
+const PHILOX_W1: u32 = 0xBB67AE85u;
+
+// Full 64-bit product as (hi, lo); WGSL has no widening multiply.
+fn mulhilo(a: u32, b: u32) -> vec2<u32> {
+  let ll: u32 = (a & 0xffffu) * (b & 0xffffu);
+  let lh: u32 = (a & 0xffffu) * (b >> 16u);
+  let hl: u32 = (a >> 16u) * (b & 0xffffu);
+  let hh: u32 = (a >> 16u) * (b >> 16u);
+  let mid: u32 = (ll >> 16u) + (lh & 0xffffu) + (hl & 0xffffu);
+  return vec2<u32>(hh + (lh >> 16u) + (hl >> 16u) + (mid >> 16u), a * b);
+}
+
+fn philox(counter: vec4<u32>, key: vec2<u32>) -> vec4<u32> {
+  var c: vec4<u32> = counter;
+  var k: vec2<u32> = key;
+  for (var i: u32 = 0u; i < 10u; i = i + 1u) {
+    let p0: vec2<u32> = mulhilo(PHILOX_M0, c.x);
+    let p1: vec2<u32> = mulhilo(PHILOX_M1, c.z);
+    c = vec4<u32>(p1.x ^ c.y ^ k.x, p1.y, p0.x ^ c.w ^ k.y, p0.y);
+    k = k + vec2<u32>(PHILOX_W0, PHILOX_W1);
+  }
+  return c;
+}
+
+// Top 24 bits as a float in [0, 1).
+fn uniform01(x: u32) -> f32 {
+  return f32(x >> 8u) * (1.0 / 16777216.0);
+}
+
+// Box-Muller over lanes (0, 1) and (2, 3): even lanes take the cosine,
+// odd lanes the sine of the same pair.
+fn normal(r: vec4<u32>, j: u32) -> f32 {
+  let pair: u32 = j & 2u;
+  // In (0, 1], keeping log() finite.
+  let u1: f32 = (f32(r[pair] >> 8u) + 1.0) * (1.0 / 16777216.0);
+  let angle: f32 = 6.2831853 * uniform01(r[pair + 1u]);
+  let radius: f32 = sqrt(-2.0 * log(u1));
+  return radius * select(sin(angle), cos(angle), (j & 1u) == 0u);
+}
+''';
+
+/// Fills the dense f32 tensor [dst] from the next `ceil(size / 4)` Philox
+/// counters of its context. Element `e` takes lane `e % 4` of counter
+/// `e ~/ 4`. [value] builds a WGSL expression of the counter's output `r`,
+/// the lane `j` and the element `e`; it may call `uniform01` and `normal`
+/// and read [scalars] as `s0`, `s1`, ...
+///
+/// An [input] is bound as `A`; [value] is handed the position of element `e`
+/// in it (`idx_A(e)`, or the chunk-local position for chunked launches).
+/// Seeds, counters, sizes and scalars all travel in the params buffer, so
+/// one shader serves every call with the same [value] and input layout.
+void _philoxInto(Tensor dst, String Function(String index) value,
+    {Tensor? input, List<double> scalars = const []}) {
+  final Minigpu gpu = dst.gpu;
+  final _RandomState state = _stateOf(gpu);
+  final int size = dst.size;
+  final int chunk = maxBindingElements(gpu);
+  final bool chunked = size > chunk;
+  if (chunked && input != null && !input.isContiguous) {
+    throw Exception("Strided view of ${input.size} elements exceeds the "
+        "storage binding limit; call contiguous() first.");
+  }
+
+  // Counters and seeds are split into u32 halves with arithmetic rather
+  // than shifts, which are 32-bit on the web.
+  const int word = 0x100000000;
+  final int counter = state.counter;
+  final params = KernelParams();
+  final String keyLo = params.u32(state.seed % word);
+  final String keyHi = params.u32(state.seed ~/ word % word);
+  final String counterLo = params.u32(counter % word);
+  final String counterHi = params.u32(counter ~/ word % word);
+  // Rewritten for each chunk.
+  final String start = params.u32(0);
+  final String length = params.u32(0);
+
+  final String inputDecls = input == null
+      ? ''
+      : '@group(0) @binding(1) var<storage, read_write> A: array<f32>;\n'
+          '${chunked ? '' : wgslIndexFn('idx_A', input, params)}';
+  final int paramBinding = input == null ? 1 : 2;
+  final String shaderCode = '''
+@group(0) @binding(0) var<storage, read_write> Out: array<f32>;
+$inputDecls
+${params.declaration(paramBinding)}
+$_wgslPhilox
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
+  let n: u32 = $length;
+  if (t * 4u >= n) {
+    return;
+  }
+  let start: u32 = $start;
+${wgslScalarLets(scalars, params, '  ')}
+  // 64-bit counter base + global group of four.
+  let step: u32 = start / 4u + t;
+  let lo: u32 = $counterLo + step;
+  let hi: u32 = $counterHi + select(0u, 1u, lo < step);
+  let r: vec4<u32> =
+      philox(vec4<u32>(lo, hi, 0u, 0u), vec2<u32>($keyLo, $keyHi));
+  for (var j: u32 = 0u; j < 4u; j = j + 1u) {
+    let local: u32 = t * 4u + j;
+    if (local < n) {
+      let e: u32 = start + local;
+      Out[local] = ${value(chunked ? 'local' : 'idx_A(e)')};
+    }
+  }
+}
+''';
+
+  // Captured launches draw nothing, so they leave the stream where it is.
+  if (captureKernel(shaderCode)) return;
+  state.counter += (size + 3) ~/ 4;
+  final int kernel = gpu.registerKernel(shaderCode);
+  final CommandList list = commandList(gpu);
+  for (int first = 0; first < size; first += chunk) {
+    final int n = first + chunk < size ? chunk : size - first;
+    final Buffer paramBuffer = uploadParams(
+        gpu,
+        list,
+        params.words
+          ..[4] = first
+          ..[5] = n);
+    list.bind(kernel, 0, dst.buffer, offset: first * 4, size: n * 4);
+    if (input != null) {
+      if (chunked) {
+        list.bind(kernel, 1, input.buffer,
+            offset: (input.offset + first) * 4, size: n * 4);
+      } else {
+        list.bind(kernel, 1, input.buffer);
+      }
+    }
+    list.bind(kernel, paramBinding, paramBuffer);
+    list.dispatch(kernel, (n + 1023) ~/ 1024);
+  }
+  list.submit();
+}
+
+/// Creates a tensor of [shape] and [dtype] whose values are generated by
+/// [_philoxInto]; non-f32 results are converted from an f32 draw.
+Future<Tensor> randomTensor(List<int> shape, Minigpu? gpu, DType dtype,
+    String Function(String index) value,
+    {List<double> scalars = const []}) async {
+  final Tensor result = await Tensor.create(shape, gpu: gpu);
+  _philoxInto(result, value, scalars: scalars);
+  if (dtype == DType.f32) {
+    return result;
+  }
+  final Tensor converted = await result.toDType(dtype);
+  result.destroy();
+  return converted;
+}
+
+extension TensorRandom on Tensor {
+  /// Zeroes each element with probability [p] and scales the survivors by
+  /// `1 / (1 - p)`, drawing the mask and applying it in one kernel. The mask
+  /// comes from the context's random stream, so [Tensor.manualSeed]
+  /// reproduces it.
+  Future<Tensor> dropout(double p) async {
+    if (p < 0 || p >= 1) {
+      throw Exception("dropout probability must be in [0, 1), got $p.");
+    }
+    requireF32(this);
+    final Tensor result = await Tensor.create(shape, gpu: gpu);
+    _philoxInto(
+        result,
+        (index) => 'select(0.0, A[$index] * s0, uniform01(r[j]) >= s1)',
+        input: this,
+        scalars: [1 / (1 - p), p]);
+    return result;
+  }
+}
@@ -0,0 +1,264 @@
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_data.dart';
+import 'gpu_kernel.dart';
+import 'gpu_tensor_base.dart';
+
+/// Elements of a row scanned by one workgroup (two per thread).
+const int _scanBlock = 512;
+
+extension TensorScan on Tensor {
+  /// Running sum along [axis].
+  Future<Tensor> cumsum({int axis = -1}) => _cumulative(axis, '+', 0.0);
+
+  /// Running product along [axis].
+  Future<Tensor> cumprod({int axis = -1}) => _cumulative(axis, '*', 1.0);
+
+  /// Inclusive scan with the associative [op] along [axis].
+  ///
+  /// Each workgroup scans a 512-element block of a row in shared memory and
+  /// records the block total. When a row spans several blocks the totals
+  /// are scanned the same way (recursively, as a `[rows, blocks]` tensor)
+  /// and folded back into the later blocks, so every level does linear work.
+  Future<Tensor> _cumulative(int axis, String op, double identity) async {
+    int n = shape.length;
+    // Normalize negative axis.
+    if (axis < 0) {
+      axis += n;
+    }
+    if (axis < 0 || axis >= n) {
+      throw Exception("Axis out of range.");
+    }
+    final AxisRows rows = AxisRows(shape, axis);
+    final int d = rows.d;
+    final int blocks = (d + _scanBlock - 1) ~/ _scanBlock;
+    Tensor result = await Tensor.create(shape, gpu: gpu);
+    Tensor? totals =
+        blocks > 1 ? await Tensor.create([rows.rows, blocks], gpu: gpu) : null;
+
+    final String totalsDecl = totals == null
+        ? ''
+        : '@group(0) @binding(2) var<storage, read_write> T: array<f32>;';
+    final String first = rows.wgslPos('row', 'j', d);
+    final String second = rows.wgslPos('row', '(j + 1u)', d);
+    final shaderCode = '''
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> B: array<f32>;
+$totalsDecl
+
+${wgslLoadFn('load_A', 'A', this)}
+const ROWS: u32 = ${rows.rows}u;
+const D: u32 = ${d}u;
+const BLOCKS: u32 = ${blocks}u;
+const IDENTITY: f32 = $identity;
+var<workgroup> partial: array<f32, 256>;
+
+fn combine(a: f32, b: f32) -> f32 {
+  return a $op b;
+}
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let g: u32 = $wgslGroupIndex;
+  if (g >= ROWS * BLOCKS) {
+    return;
+  }
+  let row: u32 = g / BLOCKS;
+  let j: u32 = (g % BLOCKS) * ${_scanBlock}u + 2u * lid.x;
+  var a: f32 = IDENTITY;
+  var b: f32 = IDENTITY;
+  if (j < D) {
+    a = load_A($first);
+  }
+  if (j + 1u < D) {
+    b = load_A($second);
+  }
+  // Inclusive Hillis-Steele scan of the pairs.
+  var acc: f32 = combine(a, b);
+  partial[lid.x] = acc;
+  workgroupBarrier();
+  for (var s: u32 = 1u; s < 256u; s = s << 1u) {
+    if (lid.x >= s) {
+      acc = combine(partial[lid.x - s], acc);
+    }
+    workgroupBarrier();
+    partial[lid.x] = acc;
+    workgroupBarrier();
+  }
+  var before: f32 = IDENTITY;
+  if (lid.x > 0u) {
+    before = partial[lid.x - 1u];
+  }
+  if (j < D) {
+    B[$first] = combine(before, a);
+  }
+  if (j + 1u < D) {
+    B[$second] = combine(combine(before, a), b);
+  }
+  ${totals == null ? '' : 'if (lid.x == 255u) {\n    T[g] = acc;\n  }'}
+}
+''';
+    launchKernel(
+        gpu,
+        shaderCode,
+        [buffer, result.buffer, if (totals != null) totals.buffer],
+        rows.rows * blocks);
+    if (totals == null) {
+      return result;
+    }
+
+    // Block b of a row starts from the scanned total of blocks 0..b-1.
+    final Tensor carries = await totals._cumulative(1, op, identity);
+    final int total = rows.rows * d;
+    final fixupCode = '''
+@group(0) @binding(0) var<storage, read_write> B: array<f32>;
+@group(0) @binding(1) var<storage, read_write> C: array<f32>;
+
+fn combine(a: f32, b: f32) -> f32 {
+  return a $op b;
+}
+
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let idx: u32 = $wgslLinearIndex;
+  if (idx < ${total}u) {
+    let row: u32 = idx / ${d}u;
+    let j: u32 = idx % ${d}u;
+    let block: u32 = j / ${_scanBlock}u;
+    if (block > 0u) {
+      let p: u32 = $first;
+      B[p] = combine(C[row * ${blocks}u + block - 1u], B[p]);
+    }
+  }
+}
+''';
+    launchKernel(gpu, fixupCode, [result.buffer, carries.buffer],
+        (total + 255) ~/ 256);
+    totals.destroy();
+    carries.destroy();
+    return result;
+  }
+
+  /// Elementwise select: this tensor where [mask] is nonzero, [other]
+  /// elsewhere. All three broadcast to a common shape.
+  Future<Tensor> where(Tensor mask, Tensor other) async {
+    final List<int> outShape =
+        broadcastShapes(broadcastShapes(shape, other.shape), mask.shape);
+    return elementwise(
+        gpu, [this, other, mask], outShape, 'select(b, a, c != 0.0)');
+  }
+
+  /// Gathers the elements where [mask] (broadcast to this shape) is
+  /// nonzero, in row-major order. Returns `(values, count)`.
+  ///
+  /// The output size is only known on the device, so `values` has room for
+  /// every element and `count` is a one-element tensor holding the number
+  /// written as the bits of a u32, exact for any size. Read it on the host
+  /// with `Uint32List.view((await count.getData()).buffer)[0]`, or bind it in
+  /// a later kernel and read `bitcast<u32>(Count[0])` instead of waiting for
+  /// the host. Entries past it stay zero.
+  Future<(Tensor, Tensor)> maskedSelect(Tensor mask) async {
+    requireF32(this);
+    final Tensor view = _sameShape(mask) ? mask : mask.expand(shape);
+    final Tensor values = await Tensor.create([size], gpu: gpu);
+    final Tensor count = await Tensor.create([1], gpu: gpu);
+    _compact(view, values, count, 'Out[o] = A[idx_A(i)];', input: this);
+    if (!identical(view, mask)) {
+      view.destroy();
+    }
+    return (values, count);
+  }
+
+  /// Coordinates of the nonzero elements in row-major order, as an f32
+  /// `[size, rank]` tensor, and the number of rows written; see
+  /// [maskedSelect] for how the count is reported.
+  Future<(Tensor, Tensor)> nonzero() async {
+    final Tensor indices = await Tensor.create([size, rank], gpu: gpu);
+    final Tensor count = await Tensor.create([1], gpu: gpu);
+    // Peel coordinates off the row-major index, last axis first.
+    final store = StringBuffer('var rest: u32 = i;\n');
+    for (int a = rank - 1; a >= 0; a--) {
+      store
+        ..writeln('      Out[o * ${rank}u + ${a}u] = f32(rest % ${shape[a]}u);')
+        ..writeln('      rest = rest / ${shape[a]}u;');
+    }
+    _compact(this, indices, count, store.toString());
+    return (indices, count);
+  }
+
+  bool _sameShape(Tensor other) =>
+      other.rank == rank &&
+      List.generate(rank, (i) => other.shape[i] == shape[i]).every((s) => s);
+
+  /// Stream compaction over this tensor's elements: flags where [mask] is
+  /// nonzero, scans the flags into output slots and runs [store] for each
+  /// kept element `i` with its slot `o`. The last thread writes the total to
+  /// [count] as u32 bits.
+  void _compact(Tensor mask, Tensor out, Tensor count, String store,
+      {Tensor? input}) {
+    if (out.size > maxBindingElements(gpu)) {
+      throw Exception("Compacting $size elements exceeds the storage binding "
+          "limit; split the tensor first.");
+    }
+    final Buffer slots = gpu.createBuffer(size * 4);
+    final flagCode = '''
+@group(0) @binding(0) var<storage, read_write> M: array<f32>;
+@group(0) @binding(1) var<storage, read_write> Pos: array<u32>;
+
+${wgslIndexFn('idx_M', mask)}
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < ${size}u) {
+    Pos[i] = select(0u, 1u, M[idx_M(i)] != 0.0);
+  }
+}
+''';
+    launchKernel(gpu, flagCode, [mask.buffer, slots], (size + 255) ~/ 256);
+    exclusiveScanU32(gpu, slots, size);
+
+    final String inputDecls = input == null
+        ? ''
+        : '@group(0) @binding(4) var<storage, read_write> A: array<f32>;\n'
+            '${wgslIndexFn('idx_A', input)}';
+    final scatterCode = '''
+@group(0) @binding(0) var<storage, read_write> M: array<f32>;
+@group(0) @binding(1) var<storage, read_write> Pos: array<u32>;
+@group(0) @binding(2) var<storage, read_write> Out: array<f32>;
+@group(0) @binding(3) var<storage, read_write> Count: array<f32>;
+$inputDecls
+${wgslIndexFn('idx_M', mask)}
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
+  if (i < ${size}u) {
+    let keep: bool = M[idx_M(i)] != 0.0;
+    if (keep) {
+      let o: u32 = Pos[i];
+      $store
+    }
+    if (i == ${size - 1}u) {
+      Count[0] = bitcast<f32>(Pos[i] + select(0u, 1u, keep));
+    }
+  }
+}
+''';
+    launchKernel(
+        gpu,
+        scatterCode,
+        [
+          mask.buffer,
+          slots,
+          out.buffer,
+          count.buffer,
+          if (input != null) input.buffer
+        ],
+        (size + 255) ~/ 256);
+    slots.destroy();
+  }
+}
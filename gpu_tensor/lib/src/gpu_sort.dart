@@ -0,0 +1,668 @@
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_kernel.dart';
+import 'gpu_tensor_base.dart';
+
+/// Rows up to this length are sorted by one workgroup in shared memory;
+/// longer ones go through the global radix sort.
+const int _bitonicMaxLength = 2048;
+
+/// Largest k [TensorSort.topK] selects without sorting the whole axis.
+const int topKMaxSelect = 16;
+
+/// Elements of a row scanned by one workgroup of the top-k selection.
+const int _selectSpan = 4096;
+
+/// `sort_key` maps f32 bit patterns to u32s whose unsigned order is the
+/// float order (-0 before +0, NaNs last), reversed for descending sorts;
+/// `sort_value` undoes it. Every NaN is first replaced by the positive quiet
+/// NaN, so a NaN with its sign bit set still sorts last (and comes back as
+/// that NaN). Every sort compares these keys and breaks ties by the original
+/// index, so all paths order equal elements the same way.
+String _wgslSortKey(bool descending) => '''
+const DESC_MASK: u32 = ${descending ? '0xffffffffu' : '0u'};
+
+fn sort_key(x: f32) -> u32 {
+  // Tested on the bits: compilers may fold x != x away.
+  let raw: u32 = bitcast<u32>(x);
+  let b: u32 = select(raw, 0x7fc00000u, (raw & 0x7fffffffu) > 0x7f800000u);
+  return select(b | 0x80000000u, ~b, (b & 0x80000000u) != 0u) ^ DESC_MASK;
+}
+
+fn sort_value(k: u32) -> f32 {
+  let b: u32 = k ^ DESC_MASK;
+  return bitcast<f32>(select(~b, b & 0x7fffffffu, (b & 0x80000000u) != 0u));
+}
+''';
+
+/// One pass of the least-significant-digit radix sort over 4-bit digits.
+/// The digit comes from the key at bit [shift], or from the row of a
+/// segmented sort (payload / [d]) when [segment] is set.
+class _RadixPass {
+  const _RadixPass(this.shift, {this.segment = false, this.d = 1});
+
+  final int shift;
+  final bool segment;
+  final int d;
+
+  String get wgslDigit {
+    final String x = segment ? '(x / ${d}u)' : 'x';
+    return 'fn digit_of(x: u32) -> u32 { return ($x >> ${shift}u) & 15u; }';
+  }
+}
+
+extension TensorSort on Tensor {
+  /// Sorts along [axis], ascending unless [descending]. Equal elements keep
+  /// their order and NaNs go last (first when descending). f16 tensors are
+  /// sorted by value into an f32 result.
+  Future<Tensor> sort({int axis = -1, bool descending = false}) async {
+    final (values, _) = await _sortAxis(axis, descending, indices: false);
+    return values!;
+  }
+
+  /// The indices along [axis] that would sort it, as f32 like [argmax].
+  Future<Tensor> argsort({int axis = -1, bool descending = false}) async {
+    final (_, indices) = await _sortAxis(axis, descending, values: false);
+    return indices!;
+  }
+
+  /// The [k] largest elements along [axis] (smallest unless [largest]) in
+  /// order, with their indices as f32. Returns `(values, indices)`, both
+  /// with [axis] shortened to [k].
+  ///
+  /// Up to [topKMaxSelect] the selection runs without sorting: each
+  /// workgroup keeps the best [k] of a 4096-element span of a row and the
+  /// spans' candidates are merged in further passes. Larger [k] sort the
+  /// axis and keep its head.
+  Future<(Tensor, Tensor)> topK(int k,
+      {int axis = -1, bool largest = true}) async {
+    axis = _normalizeAxis(axis);
+    if (k <= 0 || k > shape[axis]) {
+      throw Exception("k must be in [1, ${shape[axis]}], got $k.");
+    }
+    if (k > topKMaxSelect) {
+      final (values, indices) = await _sortAxis(axis, largest, keep: k);
+      return (values!, indices!);
+    }
+    return _selectTopK(axis, k, largest);
+  }
+
+  /// Radix sorts all elements as one flat list of keys, returning the
+  /// sorted keys as a 1-D tensor.
+  ///
+  /// With [u32Keys] the 32 bits of each element are ordered as an unsigned
+  /// integer (e.g. codes uploaded through an f32 view) instead of a float.
+  /// The 32-bit words of [payload], which must have as many elements, are
+  /// moved along with their keys and returned second; the bits are copied
+  /// unchanged, so payloads may carry u32 data too.
+  Future<(Tensor, Tensor?)> radixSort(
+      {Tensor? payload, bool u32Keys = false, bool descending = false}) async {
+    requireF32(this);
+    if (payload != null) {
+      requireF32(payload);
+      if (payload.size != size) {
+        throw Exception("payload has ${payload.size} elements, expected "
+            "$size to match the keys.");
+      }
+    }
+    _checkRadixSize(size);
+    final Tensor keys = await Tensor.create([size], gpu: gpu);
+    final Tensor? values =
+        payload == null ? null : await Tensor.create([size], gpu: gpu);
+
+    final String loadKey = u32Keys
+        ? 'bitcast<u32>(load_A(p)) ^ DESC_MASK'
+        : 'sort_key(load_A(p))';
+    final (k, v, scratch) = _radixSortBuffers(
+      loadKey: loadKey,
+      loadValue: payload == null ? 'p' : 'bitcast<u32>(P[idx_P(p)])',
+      payload: payload,
+      descending: descending,
+      passes: [for (int shift = 0; shift < 32; shift += 4) _RadixPass(shift)],
+    );
+
+    final outDecls = StringBuffer(
+        '@group(0) @binding(1) var<storage, read_write> Keys: array<f32>;\n');
+    final List<Buffer> buffers = [k, keys.buffer];
+    String storeValue = '';
+    if (values != null) {
+      outDecls
+        ..writeln('@group(0) @binding(2) '
+            'var<storage, read_write> V: array<u32>;')
+        ..writeln('@group(0) @binding(3) '
+            'var<storage, read_write> Values: array<f32>;');
+      buffers.addAll([v, values.buffer]);
+      storeValue = '    Values[p] = bitcast<f32>(V[p]);';
+    }
+    final String storeKey =
+        u32Keys ? 'bitcast<f32>(K[p] ^ DESC_MASK)' : 'sort_value(K[p])';
+    final shaderCode = '''
+@group(0) @binding(0) var<storage, read_write> K: array<u32>;
+$outDecls
+${_wgslSortKey(descending)}
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let p: u32 = $wgslLinearIndex;
+  if (p < ${size}u) {
+    Keys[p] = $storeKey;
+$storeValue
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, buffers, (size + 255) ~/ 256);
+    for (final buffer in scratch) {
+      buffer.destroy();
+    }
+    return (keys, values);
+  }
+
+  int _normalizeAxis(int axis) {
+    final int n = shape.length;
+    if (axis < 0) {
+      axis += n;
+    }
+    if (axis < 0 || axis >= n) {
+      throw Exception("Axis out of range.");
+    }
+    return axis;
+  }
+
+  void _checkRadixSize(int count) {
+    if (count > maxBindingElements(gpu)) {
+      throw Exception("Sorting $count elements exceeds the storage binding "
+          "limit; sort smaller slices.");
+    }
+  }
+
+  /// Sorts along [axis] and keeps the first [keep] elements of each row
+  /// (all of them by default), producing the values and/or indices.
+  Future<(Tensor?, Tensor?)> _sortAxis(int axis, bool descending,
+      {bool values = true, bool indices = true, int? keep}) async {
+    axis = _normalizeAxis(axis);
+    final AxisRows rows = AxisRows(shape, axis);
+    keep ??= rows.d;
+    final List<int> outShape = List.from(shape)..[axis] = keep;
+    final Tensor? valueOut =
+        values ? await Tensor.create(outShape, gpu: gpu) : null;
+    final Tensor? indexOut =
+        indices ? await Tensor.create(outShape, gpu: gpu) : null;
+
+    // Outputs are bound after the sorted data, as OutV / OutI.
+    String outDecls(int first) {
+      final sb = StringBuffer();
+      if (valueOut != null) {
+        sb.writeln('@group(0) @binding($first) '
+            'var<storage, read_write> OutV: array<f32>;');
+      }
+      if (indexOut != null) {
+        sb.writeln('@group(0) @binding(${first + (values ? 1 : 0)}) '
+            'var<storage, read_write> OutI: array<f32>;');
+      }
+      return sb.toString();
+    }
+
+    final List<Buffer> outBuffers = [
+      if (valueOut != null) valueOut.buffer,
+      if (indexOut != null) indexOut.buffer,
+    ];
+
+    if (rows.d <= _bitonicMaxLength) {
+      _bitonicRows(rows, keep, descending, outDecls(1), outBuffers,
+          values: values, indices: indices);
+      return (valueOut, indexOut);
+    }
+
+    // Sort every key, then stably by row, so each row ends up contiguous
+    // and in order. The payload is the element's position in [rows, d].
+    _checkRadixSize(rows.rows * rows.d);
+    final int rowBits = (rows.rows - 1).bitLength;
+    final String row = '(p / ${rows.d}u)';
+    final String pos = rows.wgslPos(row, '(p % ${rows.d}u)', rows.d);
+    final (k, v, scratch) = _radixSortBuffers(
+      loadKey: 'sort_key(load_A($pos))',
+      loadValue: 'p',
+      descending: descending,
+      passes: [
+        for (int shift = 0; shift < 32; shift += 4) _RadixPass(shift),
+        for (int shift = 0; shift < rowBits; shift += 4)
+          _RadixPass(shift, segment: true, d: rows.d),
+      ],
+    );
+
+    final int total = rows.rows * rows.d;
+    final List<String> sources = [
+      if (values)
+        '@group(0) @binding(0) var<storage, read_write> K: array<u32>;',
+      if (indices)
+        '@group(0) @binding(${values ? 1 : 0}) '
+            'var<storage, read_write> V: array<u32>;',
+    ];
+    final shaderCode = '''
+${sources.join('\n')}
+${outDecls(sources.length)}
+${_wgslSortKey(descending)}
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let p: u32 = $wgslLinearIndex;
+  let rank: u32 = p % ${rows.d}u;
+  if (p < ${total}u && rank < ${keep}u) {
+    let o: u32 = ${rows.wgslPos(row, 'rank', keep)};
+    ${values ? 'OutV[o] = sort_value(K[p]);' : ''}
+    ${indices ? 'OutI[o] = f32(V[p] % ${rows.d}u);' : ''}
+  }
+}
+''';
+    launchKernel(
+        gpu,
+        shaderCode,
+        [if (values) k, if (indices) v, ...outBuffers],
+        (total + 255) ~/ 256);
+    for (final buffer in scratch) {
+      buffer.destroy();
+    }
+    return (valueOut, indexOut);
+  }
+
+  /// Bitonic sort of each row by one workgroup, padded to a power of two
+  /// with keys that sort last.
+  void _bitonicRows(AxisRows rows, int keep, bool descending, String outDecls,
+      List<Buffer> outBuffers,
+      {required bool values, required bool indices}) {
+    int padded = 1;
+    while (padded < rows.d) {
+      padded <<= 1;
+    }
+    final shaderCode = '''
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+$outDecls
+${wgslLoadFn('load_A', 'A', this)}
+${_wgslSortKey(descending)}
+const ROWS: u32 = ${rows.rows}u;
+const D: u32 = ${rows.d}u;
+const P: u32 = ${padded}u;
+var<workgroup> sk: array<u32, P>;
+var<workgroup> si: array<u32, P>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let row: u32 = $wgslGroupIndex;
+  if (row >= ROWS) {
+    return;
+  }
+  for (var j: u32 = lid.x; j < P; j = j + 256u) {
+    if (j < D) {
+      sk[j] = sort_key(load_A(${rows.wgslPos('row', 'j', rows.d)}));
+      si[j] = j;
+    } else {
+      sk[j] = 0xffffffffu;
+      si[j] = 0xffffffffu;
+    }
+  }
+  workgroupBarrier();
+  for (var width: u32 = 2u; width <= P; width = width << 1u) {
+    for (var stride: u32 = width >> 1u; stride > 0u; stride = stride >> 1u) {
+      for (var t: u32 = lid.x; t < P / 2u; t = t + 256u) {
+        let a: u32 = 2u * t - (t & (stride - 1u));
+        let b: u32 = a + stride;
+        let ka: u32 = sk[a];
+        let kb: u32 = sk[b];
+        let ia: u32 = si[a];
+        let ib: u32 = si[b];
+        let after: bool = ka > kb || (ka == kb && ia > ib);
+        if (after == ((a & width) == 0u)) {
+          sk[a] = kb;
+          sk[b] = ka;
+          si[a] = ib;
+          si[b] = ia;
+        }
+      }
+      workgroupBarrier();
+    }
+  }
+  for (var j: u32 = lid.x; j < ${keep}u; j = j + 256u) {
+    let o: u32 = ${rows.wgslPos('row', 'j', keep)};
+    ${values ? 'OutV[o] = sort_value(sk[j]);' : ''}
+    ${indices ? 'OutI[o] = f32(si[j]);' : ''}
+  }
+}
+''';
+    launchKernel(gpu, shaderCode, [buffer, ...outBuffers], rows.rows);
+  }
+
+  /// Loads this tensor's elements as u32 keys ([loadKey], a WGSL expression
+  /// of the flat index `p` reading `load_A(..)`) with u32 payloads
+  /// ([loadValue], reading `P[idx_P(..)]` when [payload] is given), then
+  /// runs [passes]. Returns the sorted key and payload buffers and every
+  /// scratch buffer to destroy once the caller has read them.
+  (Buffer, Buffer, List<Buffer>) _radixSortBuffers({
+    required String loadKey,
+    required String loadValue,
+    required bool descending,
+    required List<_RadixPass> passes,
+    Tensor? payload,
+  }) {
+    final int n = size;
+    final int tiles = (n + 255) ~/ 256;
+    List<Buffer> keys = [gpu.createBuffer(n * 4), gpu.createBuffer(n * 4)];
+    List<Buffer> vals = [gpu.createBuffer(n * 4), gpu.createBuffer(n * 4)];
+    final Buffer hist = gpu.createBuffer(16 * tiles * 4);
+
+    final String payloadDecls = payload == null
+        ? ''
+        : '@group(0) @binding(3) var<storage, read_write> P: array<f32>;\n'
+            '${wgslIndexFn('idx_P', payload)}';
+    final prepareCode = '''
+${wgslEnableF16(gpu, [this])}@group(0) @binding(0) var<storage, read_write> A: array<${wgslArrayType(this)}>;
+@group(0) @binding(1) var<storage, read_write> K: array<u32>;
+@group(0) @binding(2) var<storage, read_write> V: array<u32>;
+$payloadDecls
+${wgslLoadFn('load_A', 'A', this)}
+${_wgslSortKey(descending)}
+@compute @workgroup_size(256)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let p: u32 = $wgslLinearIndex;
+  if (p < ${n}u) {
+    K[p] = $loadKey;
+    V[p] = $loadValue;
+  }
+}
+''';
+    launchKernel(
+        gpu,
+        prepareCode,
+        [buffer, keys[0], vals[0], if (payload != null) payload.buffer],
+        (n + 255) ~/ 256);
+
+    final header = '''
+const N: u32 = ${n}u;
+const TILES: u32 = ${tiles}u;
+''';
+    int current = 0;
+    for (final pass in passes) {
+      final countCode = '''
+@group(0) @binding(0) var<storage, read_write> S: array<u32>;
+@group(0) @binding(1) var<storage, read_write> Hist: array<u32>;
+$header${pass.wgslDigit}
+var<workgroup> counts: array<atomic<u32>, 16>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let tile: u32 = $wgslGroupIndex;
+  if (tile >= TILES) {
+    return;
+  }
+  if (lid.x < 16u) {
+    atomicStore(&counts[lid.x], 0u);
+  }
+  workgroupBarrier();
+  let i: u32 = tile * 256u + lid.x;
+  if (i < N) {
+    atomicAdd(&counts[digit_of(S[i])], 1u);
+  }
+  workgroupBarrier();
+  if (lid.x < 16u) {
+    // Digit-major, so the scan yields each tile's start within its digit.
+    Hist[lid.x * TILES + tile] = atomicLoad(&counts[lid.x]);
+  }
+}
+''';
+      launchKernel(
+          gpu,
+          countCode,
+          [pass.segment ? vals[current] : keys[current], hist],
+          tiles);
+      exclusiveScanU32(gpu, hist, 16 * tiles);
+
+      // Stable scatter: a thread's rank among equal digits of its tile is
+      // the count of earlier threads with that digit, taken from a scan of
+      // one-hot 16-bit counters packed two per u32.
+      final scatterCode = '''
+@group(0) @binding(0) var<storage, read_write> KIn: array<u32>;
+@group(0) @binding(1) var<storage, read_write> VIn: array<u32>;
+@group(0) @binding(2) var<storage, read_write> KOut: array<u32>;
+@group(0) @binding(3) var<storage, read_write> VOut: array<u32>;
+@group(0) @binding(4) var<storage, read_write> Hist: array<u32>;
+$header${pass.wgslDigit}
+var<workgroup> lows: array<vec4<u32>, 256>;
+var<workgroup> highs: array<vec4<u32>, 256>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let tile: u32 = $wgslGroupIndex;
+  if (tile >= TILES) {
+    return;
+  }
+  let i: u32 = tile * 256u + lid.x;
+  let valid: bool = i < N;
+  var key: u32 = 0u;
+  var value: u32 = 0u;
+  if (valid) {
+    key = KIn[i];
+    value = VIn[i];
+  }
+  let digit: u32 = digit_of(${pass.segment ? 'value' : 'key'});
+  let word: u32 = digit >> 1u;
+  let shift: u32 = (digit & 1u) * 16u;
+  var lo: vec4<u32> = vec4<u32>(0u);
+  var hi: vec4<u32> = vec4<u32>(0u);
+  if (valid) {
+    if (word < 4u) {
+      lo[word] = 1u << shift;
+    } else {
+      hi[word - 4u] = 1u << shift;
+    }
+  }
+  lows[lid.x] = lo;
+  highs[lid.x] = hi;
+  workgroupBarrier();
+  for (var s: u32 = 1u; s < 256u; s = s << 1u) {
+    if (lid.x >= s) {
+      lo = lo + lows[lid.x - s];
+      hi = hi + highs[lid.x - s];
+    }
+    workgroupBarrier();
+    lows[lid.x] = lo;
+    highs[lid.x] = hi;
+    workgroupBarrier();
+  }
+  if (valid) {
+    let packed: u32 = select(hi[word & 3u], lo[word & 3u], word < 4u);
+    let rank: u32 = ((packed >> shift) & 0xffffu) - 1u;
+    let dst: u32 = Hist[digit * TILES + tile] + rank;
+    KOut[dst] = key;
+    VOut[dst] = value;
+  }
+}
+''';
+      launchKernel(
+          gpu,
+          scatterCode,
+          [
+            keys[current],
+            vals[current],
+            keys[1 - current],
+            vals[1 - current],
+            hist
+          ],
+          tiles);
+      current = 1 - current;
+    }
+    return (
+      keys[current],
+      vals[current],
+      [...keys, ...vals, hist],
+    );
+  }
+
+  /// Top-k by repeated selection; see [topK].
+  Future<(Tensor, Tensor)> _selectTopK(int axis, int k, bool largest) async {
+    final AxisRows rows = AxisRows(shape, axis);
+    final List<int> outShape = List.from(shape)..[axis] = k;
+    final Tensor values = await Tensor.create(outShape, gpu: gpu);
+    final Tensor indices = await Tensor.create(outShape, gpu: gpu);
+
+    // Each pass leaves k candidates per span; candidates of a row are then
+    // a new, shorter row of (key, index) pairs.
+    int d = rows.d;
+    Buffer? keysIn;
+    Buffer? indicesIn;
+    while (true) {
+      final int blocks = (d + _selectSpan - 1) ~/ _selectSpan;
+      final bool last = blocks == 1;
+      final bool first = keysIn == null;
+      final String load = first
+          ? '''
+    let key: u32 = sort_key(load_A(${rows.wgslPos('row', 'j', rows.d)}));
+    let idx: u32 = j;'''
+          : '''
+    let key: u32 = KIn[row * D + j];
+    let idx: u32 = IIn[row * D + j];''';
+      final String store = last
+          ? '''
+    let o: u32 = ${rows.wgslPos('row', 'lid.x', k)};
+    OutV[o] = sort_value(mk[lid.x]);
+    OutI[o] = f32(mi[lid.x]);'''
+          : '''
+    let o: u32 = (row * BLOCKS + block) * K + lid.x;
+    KOut[o] = mk[lid.x];
+    IOut[o] = mi[lid.x];''';
+      final List<String> decls = [
+        if (first)
+          'var<storage, read_write> A: array<${wgslArrayType(this)}>;',
+        if (!first) 'var<storage, read_write> KIn: array<u32>;',
+        if (!first) 'var<storage, read_write> IIn: array<u32>;',
+        if (last) 'var<storage, read_write> OutV: array<f32>;',
+        if (last) 'var<storage, read_write> OutI: array<f32>;',
+        if (!last) 'var<storage, read_write> KOut: array<u32>;',
+        if (!last) 'var<storage, read_write> IOut: array<u32>;',
+      ];
+      final Buffer? keysOut =
+          last ? null : gpu.createBuffer(rows.rows * blocks * k * 4);
+      final Buffer? indicesOut =
+          last ? null : gpu.createBuffer(rows.rows * blocks * k * 4);
+
+      final String bindings = [
+        for (int b = 0; b < decls.length; b++)
+          '@group(0) @binding($b) ${decls[b]}'
+      ].join('\n');
+
+      final shaderCode = '''
+${first ? wgslEnableF16(gpu, [this]) : ''}$bindings
+${first ? wgslLoadFn('load_A', 'A', this) : ''}
+${_wgslSortKey(largest)}
+const ROWS: u32 = ${rows.rows}u;
+const D: u32 = ${d}u;
+const BLOCKS: u32 = ${blocks}u;
+const K: u32 = ${k}u;
+const SPAN: u32 = ${_selectSpan}u;
+var<workgroup> mk: array<u32, ${64 * k}>;
+var<workgroup> mi: array<u32, ${64 * k}>;
+
+fn better(ka: u32, ia: u32, kb: u32, ib: u32) -> bool {
+  return ka < kb || (ka == kb && ia < ib);
+}
+
+@compute @workgroup_size(64)
+fn main(@builtin(local_invocation_id) lid: vec3<u32>,
+        @builtin(workgroup_id) wid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let g: u32 = $wgslGroupIndex;
+  if (g >= ROWS * BLOCKS) {
+    return;
+  }
+  let row: u32 = g / BLOCKS;
+  let block: u32 = g % BLOCKS;
+
+  // Each thread keeps its best K in order; most elements are rejected by
+  // one comparison with the current K-th.
+  var bk: array<u32, K>;
+  var bi: array<u32, K>;
+  for (var t: u32 = 0u; t < K; t = t + 1u) {
+    bk[t] = 0xffffffffu;
+    bi[t] = 0xffffffffu;
+  }
+  let end: u32 = min(D, (block + 1u) * SPAN);
+  for (var j: u32 = block * SPAN + lid.x; j < end; j = j + 64u) {$load
+    if (better(key, idx, bk[K - 1u], bi[K - 1u])) {
+      var t: u32 = K - 1u;
+      while (t > 0u && better(key, idx, bk[t - 1u], bi[t - 1u])) {
+        bk[t] = bk[t - 1u];
+        bi[t] = bi[t - 1u];
+        t = t - 1u;
+      }
+      bk[t] = key;
+      bi[t] = idx;
+    }
+  }
+  for (var t: u32 = 0u; t < K; t = t + 1u) {
+    mk[lid.x * K + t] = bk[t];
+    mi[lid.x * K + t] = bi[t];
+  }
+  workgroupBarrier();
+
+  // Tree merge of the sorted lists; list lid.x absorbs list lid.x + s.
+  for (var s: u32 = 32u; s > 0u; s = s >> 1u) {
+    if (lid.x < s) {
+      let a0: u32 = lid.x * K;
+      let b0: u32 = (lid.x + s) * K;
+      var ia: u32 = 0u;
+      var ib: u32 = 0u;
+      for (var t: u32 = 0u; t < K; t = t + 1u) {
+        if (better(mk[a0 + ia], mi[a0 + ia], mk[b0 + ib], mi[b0 + ib])) {
+          bk[t] = mk[a0 + ia];
+          bi[t] = mi[a0 + ia];
+          ia = ia + 1u;
+        } else {
+          bk[t] = mk[b0 + ib];
+          bi[t] = mi[b0 + ib];
+          ib = ib + 1u;
+        }
+      }
+    }
+    workgroupBarrier();
+    if (lid.x < s) {
+      for (var t: u32 = 0u; t < K; t = t + 1u) {
+        mk[lid.x * K + t] = bk[t];
+        mi[lid.x * K + t] = bi[t];
+      }
+    }
+    workgroupBarrier();
+  }
+  if (lid.x < K) {$store
+  }
+}
+''';
+      launchKernel(
+          gpu,
+          shaderCode,
+          [
+            if (first) buffer,
+            if (!first) keysIn!,
+            if (!first) indicesIn!,
+            if (last) values.buffer,
+            if (last) indices.buffer,
+            if (!last) keysOut!,
+            if (!last) indicesOut!,
+          ],
+          rows.rows * blocks);
+      keysIn?.destroy();
+      indicesIn?.destroy();
+      if (last) {
+        break;
+      }
+      keysIn = keysOut;
+      indicesIn = indicesOut;
+      d = blocks * k;
+    }
+    return (values, indices);
+  }
+}
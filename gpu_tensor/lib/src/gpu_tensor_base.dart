@@ -1,20 +1,71 @@
+import 'dart:async';
 import 'dart:typed_data';
 
 import 'package:minigpu/minigpu.dart';
 
+import 'gpu_data.dart';
+import 'gpu_kernel.dart';
+import 'gpu_random.dart';
+
+/// Number of live tensors viewing each buffer. The buffer is destroyed when
+/// the last of them is.
+final Expando<_BufferRefs> _bufferRefs = Expando('gpu_tensor.bufferRefs');
+
+class _BufferRefs {
+  int count = 0;
+}
+
+/// Tensors created while a [Tensor.scope] body is running.
+class _TensorScope {
+  final List<Tensor> tensors = [];
+}
+
+const Symbol _scopeKey = #gpu_tensor.scope;
+
+/// Element type of a tensor's storage.
+///
+/// Kernels compute in f32 whatever the storage; [f16] halves the bytes each
+/// op moves and the memory a tensor occupies. f16 tensors are bound as
+/// `array<f16>` when the device has [MinigpuFeature.shaderF16], and packed
+/// two per u32 word otherwise.
+enum DType {
+  f32(4),
+  f16(2);
+
+  const DType(this.bytes);
+
+  /// Bytes per element.
+  final int bytes;
+}
+
 /// A helper that creates (or reuses) a default GPU context.
 class DefaultMinigpu {
   static final instance = Minigpu();
 }
 
 /// A generalized tensor supporting any rank. Data is stored in a GPU buffer.
+///
+/// A tensor is a view onto its [buffer]: element `[i0, i1, ...]` lives at
+/// `offset + i0 * strides[0] + i1 * strides[1] + ...`. Freshly created tensors
+/// are dense and row-major; views produced by `transpose`, `permute`, `slice`,
+/// `expand` or `squeeze` share the buffer and only change the metadata.
 class Tensor {
   /// The shape in terms of dimensions: e.g. [3, 4, 5] for a 3×4×5 tensor.
   final List<int> shape;
 
+  /// Distance, in elements, between consecutive indices of each dimension.
+  /// A stride of 0 repeats (broadcasts) the same element along a dimension.
+  final List<int> strides;
+
+  /// Position, in elements, of element `[0, 0, ...]` within [buffer].
+  final int offset;
+
   /// Total number of elements (computed as shape[0]shape[1]...).
   final int size;
 
+  /// Element type of [buffer].
+  final DType dtype;
+
   /// The rank (number of dimensions)
   int get rank => shape.length;
 
@@ -24,9 +75,27 @@ class Tensor {
   /// The GPU buffer storing the data.
   late Buffer buffer;
 
+  bool _released = false;
+
 // Private constructor.
-  Tensor._(this.shape, {required this.gpu, Float32List? data})
-      : size = shape.reduce((a, b) => a * b) {
+  Tensor._(this.shape,
+      {required this.gpu, Float32List? data, this.dtype = DType.f32})
+      : size = shape.reduce((a, b) => a * b),
+        strides = rowMajorStrides(shape),
+        offset = 0 {
+    if (capturingKernels) {
+      // Only the metadata of tensors made under captureKernels is used.
+      buffer = gpu.createBuffer(4);
+      _track();
+      return;
+    }
+    if (dtype != DType.f32) {
+      // Rounded up to whole 4-byte words, which packed f16 is bound as.
+      final int words = (size * dtype.bytes + 3) ~/ 4;
+      buffer = gpu.createBuffer(words * 4);
+      _track();
+      return;
+    }
 // Each float is 4 bytes.
     buffer = gpu.createBuffer(size * 4);
     if (data != null) {
@@ -35,40 +104,308 @@ class Tensor {
             "Provided data length (${data.length}) does not match tensor size ($size)");
       }
       buffer.setData(data, size);
-    } else {
-// Initialize with zero.
-      buffer.setData(Float32List(size), size);
     }
+    // Without data nothing is uploaded: WebGPU zero-initializes new buffers.
+    _track();
   }
 
   /// Asynchronous factory that initializes the GPU before creating the tensor.
+  ///
+  /// [data] is always given as f32; for other [dtype]s it is converted on the
+  /// GPU. Without [data] the tensor starts zeroed at no transfer cost, so op
+  /// results are allocated this way before their kernel overwrites them.
   static Future<Tensor> create(List<int> shape,
-      {Minigpu? gpu, Float32List? data}) async {
+      {Minigpu? gpu, Float32List? data, DType dtype = DType.f32}) async {
     gpu = gpu ?? DefaultMinigpu.instance;
     if (!gpu.isInitialized) {
       await gpu.init();
     }
-    return Tensor._(shape, gpu: gpu, data: data);
+    if (dtype != DType.f32 && data != null) {
+      final Tensor staged = Tensor._(shape, gpu: gpu, data: data);
+      final Tensor result = await staged.toDType(dtype);
+      staged.destroy();
+      return result;
+    }
+    return Tensor._(shape, gpu: gpu, data: data, dtype: dtype);
+  }
+
+  /// A tensor of zeros; the same as [create] without data.
+  static Future<Tensor> zeros(List<int> shape,
+          {Minigpu? gpu, DType dtype = DType.f32}) =>
+      create(shape, gpu: gpu, dtype: dtype);
+
+  /// A tensor of ones, filled on the device.
+  static Future<Tensor> ones(List<int> shape,
+          {Minigpu? gpu, DType dtype = DType.f32}) =>
+      full(shape, 1.0, gpu: gpu, dtype: dtype);
+
+  /// A tensor with every element set to [value], filled on the device.
+  static Future<Tensor> full(List<int> shape, double value,
+      {Minigpu? gpu, DType dtype = DType.f32}) async {
+    final Tensor result = await create(shape, gpu: gpu, dtype: dtype);
+    await result.fill(value);
+    return result;
+  }
+
+  /// The 1-D tensor `start, start + step, ...` of the values below [end]
+  /// (above it for a negative [step]), generated on the device.
+  static Future<Tensor> arange(double start, double end,
+      {double step = 1.0, Minigpu? gpu, DType dtype = DType.f32}) async {
+    if (step == 0) {
+      throw Exception("arange step must not be zero.");
+    }
+    final int count = ((end - start) / step).ceil();
+    if (count <= 0) {
+      throw Exception("arange($start, $end, step: $step) is empty.");
+    }
+    final Tensor result = await create([count], gpu: gpu, dtype: dtype);
+    await generateInto(result, 's0 + f32(i) * s1', scalars: [start, step]);
+    return result;
+  }
+
+  /// The 1-D tensor of [count] evenly spaced values from [start] to [end],
+  /// both included, generated on the device.
+  static Future<Tensor> linspace(double start, double end, int count,
+      {Minigpu? gpu, DType dtype = DType.f32}) async {
+    if (count <= 0) {
+      throw Exception("linspace needs a positive count.");
+    }
+    final Tensor result = await create([count], gpu: gpu, dtype: dtype);
+    if (count == 1) {
+      await result.fill(start);
+      return result;
+    }
+    // The last value is pinned so rounding never overshoots [end].
+    await generateInto(result, 'select(s0 + f32(i) * s1, s2, i + 1u == n)',
+        scalars: [start, (end - start) / (count - 1), end]);
+    return result;
+  }
+
+  /// The `[n, m]` identity matrix (`m` defaults to [n]): ones on the main
+  /// diagonal, generated on the device.
+  static Future<Tensor> eye(int n,
+      {int? m, Minigpu? gpu, DType dtype = DType.f32}) async {
+    m ??= n;
+    final Tensor result = await create([n, m], gpu: gpu, dtype: dtype);
+    // Columns fit f32 exactly: an [n, m] tensor needs m <= 2^24 to fit in a
+    // binding anyway.
+    await generateInto(result, 'select(0.0, 1.0, i / u32(s0) == i % u32(s0))',
+        scalars: [m.toDouble()]);
+    return result;
   }
 
+  /// Restarts the random stream of [gpu] (the default context if null) from
+  /// [seed]. Until then a context is seeded from the clock.
+  ///
+  /// Every random op takes the next range of counters from the stream, so
+  /// the same seed and sequence of calls give the same tensors whatever
+  /// their shapes.
+  static void manualSeed(int seed, {Minigpu? gpu}) =>
+      seedRandom(gpu ?? DefaultMinigpu.instance, seed);
+
+  /// A tensor of values drawn uniformly from `[low, high)` on the device.
+  static Future<Tensor> random(List<int> shape,
+          {double low = 0.0,
+          double high = 1.0,
+          Minigpu? gpu,
+          DType dtype = DType.f32}) =>
+      randomTensor(
+          shape,
+          gpu,
+          dtype,
+          (_) => 's0 + s1 * uniform01(r[j])',
+          scalars: [low, high - low]);
+
+  /// A tensor of normally distributed values with [mean] and standard
+  /// deviation [std], drawn on the device with the Box-Muller transform.
+  static Future<Tensor> randn(List<int> shape,
+          {double mean = 0.0,
+          double std = 1.0,
+          Minigpu? gpu,
+          DType dtype = DType.f32}) =>
+      randomTensor(shape, gpu, dtype, (_) => 's0 + s1 * normal(r, j)',
+          scalars: [mean, std]);
+
+  /// A tensor of ones with probability [p] and zeros otherwise, drawn on the
+  /// device.
+  static Future<Tensor> bernoulli(List<int> shape, double p,
+      {Minigpu? gpu, DType dtype = DType.f32}) {
+    if (p < 0 || p > 1) {
+      throw Exception("bernoulli probability must be in [0, 1], got $p.");
+    }
+    return randomTensor(
+        shape, gpu, dtype, (_) => 'select(0.0, 1.0, uniform01(r[j]) < s0)',
+        scalars: [p]);
+  }
+
+  /// Releases this tensor's reference to its buffer. Views share the buffer
+  /// of the tensor they were created from, and the buffer itself is freed
+  /// once every tensor referencing it has been destroyed. Calling this more
+  /// than once has no effect.
   void destroy() {
-    buffer.destroy();
+    if (_released) return;
+    _released = true;
+    final refs = _bufferRefs[buffer];
+    if (refs == null || --refs.count <= 0) {
+      buffer.destroy();
+    }
+  }
+
+  /// Waits for every op enqueued on this tensor's context. Ops return once
+  /// their kernels are recorded and reads such as [getData] wait for the
+  /// work they depend on, so this is only needed to fence or time a batch.
+  Future<void> sync() => gpu.sync();
+
+  void _track() {
+    (_bufferRefs[buffer] ??= _BufferRefs()).count++;
+    (Zone.current[_scopeKey] as _TensorScope?)?.tensors.add(this);
+  }
+
+  /// Runs [body] and destroys every tensor created while it runs, except the
+  /// ones it returns (a [Tensor], or tensors inside a returned [Iterable],
+  /// [Map] or positional record, such as the `(values, indices)` of `topK`).
+  /// Returned tensors are handed over to the enclosing scope, if any.
+  ///
+  /// ```dart
+  /// final y = await Tensor.scope(() async {
+  ///   final h = await x.matMul(w);
+  ///   return h.relu(); // h is destroyed, the relu output is kept
+  /// });
+  /// ```
+  ///
+  /// Intermediates are released even when [body] throws.
+  static Future<T> scope<T>(Future<T> Function() body) async {
+    final scope = _TensorScope();
+    final Set<Tensor> kept = {};
+    try {
+      final T result = await runZoned(body, zoneValues: {_scopeKey: scope});
+      _collectTensors(result, kept);
+      return result;
+    } finally {
+      final outer = Zone.current[_scopeKey] as _TensorScope?;
+      for (final t in scope.tensors) {
+        if (kept.contains(t)) {
+          outer?.tensors.add(t);
+        } else {
+          t.destroy();
+        }
+      }
+    }
+  }
+
+  static void _collectTensors(Object? value, Set<Tensor> out) {
+    switch (value) {
+      case Tensor t:
+        out.add(t);
+      case Iterable values:
+        for (final v in values) {
+          _collectTensors(v, out);
+        }
+      case Map map:
+        for (final v in map.values) {
+          _collectTensors(v, out);
+        }
+      // Records cannot be walked generically; cover the arities ops return.
+      case (Object? a, Object? b):
+        _collectTensors(a, out);
+        _collectTensors(b, out);
+      case (Object? a, Object? b, Object? c):
+        _collectTensors(a, out);
+        _collectTensors(b, out);
+        _collectTensors(c, out);
+    }
   }
 
   /// Creates a tensor by reusing an already existing [buffer] and specifying a new [shape].
   /// (This is useful for operations like reshape that do not need to copy data.)
-  Tensor.fromBuffer(this.buffer, this.shape, {Minigpu? gpu})
+  ///
+  /// [strides] default to the row-major strides of [shape].
+  ///
+  /// The new tensor holds its own reference to [buffer]; see [destroy].
+  Tensor.fromBuffer(this.buffer, this.shape,
+      {Minigpu? gpu,
+      List<int>? strides,
+      this.offset = 0,
+      this.dtype = DType.f32})
       : gpu = gpu ?? DefaultMinigpu.instance,
-        size = shape.reduce((a, b) => a * b);
+        size = shape.reduce((a, b) => a * b),
+        strides = strides ?? rowMajorStrides(shape) {
+    _track();
+  }
+
+  /// Row-major (C order) strides for [shape].
+  static List<int> rowMajorStrides(List<int> shape) {
+    List<int> strides = List.filled(shape.length, 1);
+    for (int i = shape.length - 2; i >= 0; i--) {
+      strides[i] = strides[i + 1] * shape[i + 1];
+    }
+    return strides;
+  }
+
+  /// Whether the elements are laid out densely in row-major order, ignoring
+  /// [offset]. Size-1 dimensions may carry any stride.
+  bool get isRowMajor {
+    int expected = 1;
+    for (int i = rank - 1; i >= 0; i--) {
+      if (shape[i] != 1 && strides[i] != expected) return false;
+      expected *= shape[i];
+    }
+    return true;
+  }
+
+  /// Whether [buffer] can be consumed as a plain row-major array starting at
+  /// element 0, which is what kernels without stride support expect.
+  bool get isContiguous => offset == 0 && isRowMajor;
 
   /// Reads back the data from the GPU buffer.
   Future<Float32List> getData() async {
-    final Float32List data = Float32List(size);
-    await buffer.read(data, size);
+    // Native-backed, so the readback lands in it without a staging copy.
+    final Float32List data = gpu.allocHostBuffer(size);
+    if (dtype != DType.f32) {
+      final Tensor wide = await toDType(DType.f32);
+      await wide.buffer.read(data, size);
+      wide.destroy();
+      return data;
+    }
+    if (isRowMajor) {
+      await buffer.read(data, size, readOffset: offset);
+      return data;
+    }
+    // Gather the view into a dense temporary first.
+    final Tensor dense = await contiguous();
+    await dense.buffer.read(data, size);
+    dense.destroy();
     return data;
   }
 
   void setData(Float32List data) {
+    if (!isContiguous) {
+      throw Exception(
+          "setData requires a contiguous tensor; call contiguous() on views first.");
+    }
+    if (dtype != DType.f32) {
+      // Stage as f32 and convert straight into this buffer.
+      final Tensor staged = Tensor._(shape, gpu: gpu, data: data);
+      convertInto(staged, this);
+      staged.destroy();
+      return;
+    }
     buffer.setData(data, size);
   }
+
+  /// Sets every element to [value] without a host upload. Zero is a buffer
+  /// clear when the bytes cover whole words; anything else runs a fill
+  /// kernel.
+  Future<void> fill(double value) async {
+    if (!isContiguous) {
+      throw Exception(
+          "fill requires a contiguous tensor; call contiguous() on views first.");
+    }
+    final int bytes = size * dtype.bytes;
+    if (value == 0 && !value.isNegative && bytes % 4 == 0) {
+      buffer.clear(byteSize: bytes);
+      return;
+    }
+    await generateInto(this, 's0', scalars: [value]);
+  }
 }
@@ -1,6 +1,7 @@
 import 'dart:math' as math;
 import 'package:minigpu/minigpu.dart';
 import '../gpu_tensor.dart';
+import 'gpu_kernel.dart';
 
 extension GpuFft on Tensor {
   /// Upgrades a real tensor to a complex one by interleaving a zero for the
@@ -19,21 +20,18 @@ extension GpuFft on Tensor {
 
 const N: u32 = ${total}u;
 
+${wgslIndexFn('idx_in', this)}
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let i: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let i: u32 = $wgslLinearIndex;
   if (i >= N) { return; }
-  output[i * 2u] = input[i];
+  output[i * 2u] = input[idx_in(i)];
   output[i * 2u + 1u] = 0.0;
 }
 ''';
-    final ComputeShader shader = gpu.createComputeShader();
-    shader.loadKernelString(shaderCode);
-    shader.setBuffer('input', buffer);
-    shader.setBuffer('output', out.buffer);
     int workgroups = (total + 255) ~/ 256;
-    await shader.dispatch(workgroups, 1, 1);
-    shader.destroy();
+    launchKernel(gpu, shaderCode, [buffer, out.buffer], workgroups);
     return out;
   }
 
@@ -68,6 +66,7 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   /// Computes a 1D FFT on a tensor representing complex numbers in interleaved format.
   /// Expects a flat tensor ([N*2]) with an even number of elements.
   Future<Tensor> fft1d() async {
+    requireF32(this);
     if (shape.length != 1) {
       throw Exception("FFT supports 1D tensors only.");
     }
@@ -82,7 +81,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
     if (n == 1) return this; // FFT of a single point
 
     int stages = (math.log(n) / math.ln2).toInt();
-    Tensor ping = this;
+    // The butterflies index the interleaved data directly.
+    Tensor ping = await contiguous();
     Tensor pong = await Tensor.create(shape, gpu: gpu);
 
     for (int s = 0; s < stages; s++) {
@@ -95,8 +95,9 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
 @group(0) @binding(1) var<storage, read_write> output: array<f32>;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   let half: u32 = ${half}u;
   let m: u32 = ${m}u;
@@ -122,13 +123,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   output[idx1 + 1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
 
       Tensor temp = ping;
       ping = pong;
@@ -139,6 +135,7 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
 
   /// Computes a 2D FFT. If a real tensor is supplied, it is upgraded.
   Future<Tensor> fft2d() async {
+    requireF32(this);
     // Upgrade real tensor case.
     if (shape.length == 2) {
       int rows = shape[0], cols = shape[1];
@@ -161,7 +158,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
 
     // FFT on rows.
     int stagesRow = (math.log(cols) / math.ln2).toInt();
-    Tensor ping = this;
+    // The butterflies index the interleaved data directly.
+    Tensor ping = await contiguous();
     Tensor pong = await Tensor.create(shape, gpu: gpu);
     for (int s = 0; s < stagesRow; s++) {
       int m = 1 << (s + 1);
@@ -172,8 +170,9 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
 @group(0) @binding(1) var<storage, read_write> output: array<f32>;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   let row: u32 = t / ${(cols >> 1)}u;
   let t_row: u32 = t % ${(cols >> 1)}u;
@@ -202,13 +201,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   output[idx1+1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
       Tensor temp = ping;
       ping = pong;
       pong = temp;
@@ -225,8 +219,9 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
 @group(0) @binding(1) var<storage, read_write> output: array<f32>;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   let col: u32 = t / ${(rows >> 1)}u;
   let t_col: u32 = t % ${(rows >> 1)}u;
@@ -255,13 +250,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   output[base1+1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
       Tensor temp = ping;
       ping = pong;
       pong = temp;
@@ -272,6 +262,7 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   /// Computes a 3D FFT on a tensor representing complex numbers in interleaved format.
   /// If a real tensor with shape [D, R, C] is supplied, it is upgraded.
   Future<Tensor> fft3d() async {
+    requireF32(this);
     // Upgrade case: if a real tensor is supplied.
     if (shape.length == 3) {
       int D = shape[0], R = shape[1], C = shape[2];
@@ -295,7 +286,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
       throw Exception("D, R, and C must be powers of 2.");
     }
 
-    Tensor ping = this;
+    // The butterflies index the interleaved data directly.
+    Tensor ping = await contiguous();
     Tensor pong = await Tensor.create(shape, gpu: gpu);
 
     // FFT along depth dimension.
@@ -315,8 +307,9 @@ const m: u32 = ${m}u;
 const half: u32 = ${half}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   // Decode row and col.
   let rc: u32 = t / (D >> 1u);
@@ -348,13 +341,8 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
   output[idx1+1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
       Tensor temp = ping;
       ping = pong;
       pong = temp;
@@ -377,8 +365,9 @@ const m: u32 = ${m}u;
 const half: u32 = ${half}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   // Decode depth and col.
   let dc: u32 = t / (R >> 1u);
@@ -410,13 +399,8 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
   output[idx1+1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
       Tensor temp = ping;
       ping = pong;
       pong = temp;
@@ -439,8 +423,9 @@ const m: u32 = ${m}u;
 const half: u32 = ${half}u;
 
 @compute @workgroup_size(256)
-fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
-  let t: u32 = gid.x;
+fn main(@builtin(global_invocation_id) gid: vec3<u32>,
+        @builtin(num_workgroups) nwg: vec3<u32>) {
+  let t: u32 = $wgslLinearIndex;
   if (t >= ${numOperations}u) { return; }
   // Decode depth and row.
   let dr: u32 = t / (C >> 1u);
@@ -472,13 +457,8 @@ fn main(@builtin(global_invocation_id) gid : vec3<u32>) {
   output[idx1+1u] = temp2.y;
 }
 ''';
-      final ComputeShader shader = gpu.createComputeShader();
-      shader.loadKernelString(shaderCode);
-      shader.setBuffer('input', ping.buffer);
-      shader.setBuffer('output', pong.buffer);
       int workgroups = (numOperations + 255) ~/ 256;
-      await shader.dispatch(workgroups, 1, 1);
-      shader.destroy();
+      launchKernel(gpu, shaderCode, [ping.buffer, pong.buffer], workgroups);
       Tensor temp = ping;
       ping = pong;
       pong = temp;
@@ -0,0 +1,103 @@
+import 'package:minigpu/minigpu.dart';
+
+import 'gpu_activation.dart';
+import 'gpu_data.dart';
+import 'gpu_kernel.dart';
+import 'gpu_linear_ops.dart';
+import 'gpu_ops.dart';
+import 'gpu_random.dart';
+import 'gpu_scan.dart';
+import 'gpu_tensor_base.dart';
+
+/// Ops whose kernels do not depend on the shape: elementwise math, dtype
+/// conversion, device fills and random draws. One-element tensors stand in
+/// for every size.
+final List<Future<void> Function(Tensor a, Tensor b)> _shapeFreeOps = [
+  (a, b) => a.add(b),
+  (a, b) => a.subtract(b),
+  (a, b) => a.multiply(b),
+  (a, b) => a.divide(b),
+  (a, b) => a.mod(b),
+  (a, b) => a.greaterThan(b),
+  (a, b) => a.lessThan(b),
+  (a, b) => a.equalTo(b),
+  (a, b) => a.notEqualTo(b),
+  (a, b) => a.greaterThanOrEqual(b),
+  (a, b) => a.lessThanOrEqual(b),
+  (a, b) => a.where(b, b),
+  (a, _) => a.addScalar(1),
+  (a, _) => a.subtractScalar(1),
+  (a, _) => a.multiplyScalar(1),
+  (a, _) => a.divideScalar(1),
+  (a, _) => a.powScalar(2),
+  (a, _) => a.modScalar(1),
+  (a, _) => a.log(),
+  (a, _) => a.exp(),
+  (a, _) => a.sqrt(),
+  (a, _) => a.abs(),
+  (a, _) => a.relu(),
+  (a, _) => a.sigmoid(),
+  (a, _) => a.sin(),
+  (a, _) => a.cos(),
+  (a, _) => a.tanh(),
+  (a, _) => a.toDType(a.dtype == DType.f32 ? DType.f16 : DType.f32),
+  (a, _) => a.fill(0),
+  (a, _) => Tensor.arange(0, 1, gpu: a.gpu, dtype: a.dtype),
+  (a, _) => Tensor.linspace(0, 1, 2, gpu: a.gpu, dtype: a.dtype),
+  (a, _) => Tensor.eye(1, gpu: a.gpu, dtype: a.dtype),
+  (a, _) => Tensor.random([1], gpu: a.gpu, dtype: a.dtype),
+  (a, _) => Tensor.randn([1], gpu: a.gpu, dtype: a.dtype),
+  (a, _) => Tensor.bernoulli([1], 0.5, gpu: a.gpu, dtype: a.dtype),
+  (a, _) async {
+    if (a.dtype == DType.f32) await a.dropout(0.5);
+  },
+];
+
+/// Compiles the kernels of the built-in ops on [gpu] (the default context
+/// if null) in the background, so their first call does not wait for a
+/// shader compile.
+///
+/// Elementwise ops, conversions, fills and random draws use one kernel per
+/// op whatever the shape, and are warmed for dense [dtype] tensors.
+/// Reductions and matrix products bake their sizes into the kernel, so they
+/// are only warmed for the shapes declared: [reductions] lists input shapes
+/// and axes for `sum`, `mean`, `maxReduction`, `minReduction` and `argmax`,
+/// and [matMuls] the operand shapes of `matMul`.
+///
+/// The ops run under [captureKernels], which allocates and dispatches
+/// nothing; the sources they would launch go to [Minigpu.precompile].
+Future<void> warmupKernels({
+  Minigpu? gpu,
+  DType dtype = DType.f32,
+  List<(List<int>, int)> reductions = const [],
+  List<(List<int>, List<int>)> matMuls = const [],
+}) async {
+  final Minigpu device = gpu ?? DefaultMinigpu.instance;
+  if (!device.isInitialized) {
+    await device.init();
+  }
+  Future<Tensor> declare(List<int> shape) =>
+      Tensor.create(shape, gpu: device, dtype: dtype);
+
+  final List<String> sources = await captureKernels(() async {
+    await Tensor.scope(() async {
+      final Tensor a = await declare([1]);
+      final Tensor b = await declare([1]);
+      for (final op in _shapeFreeOps) {
+        await op(a, b);
+      }
+      for (final (shape, axis) in reductions) {
+        final Tensor t = await declare(shape);
+        await t.sum(axis: axis);
+        await t.mean(axis: axis);
+        await t.maxReduction(axis: axis);
+        await t.minReduction(axis: axis);
+        await t.argmax(axis: axis);
+      }
+      for (final (shapeA, shapeB) in matMuls) {
+        await (await declare(shapeA)).matMul(await declare(shapeB));
+      }
+    });
+  });
+  await device.precompile(sources.toSet().toList());
+}
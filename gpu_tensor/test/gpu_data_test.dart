@@ -138,6 +138,32 @@ void main() {
         tensor.destroy();
       });
 
+      test('setElements and getElements scatter and gather in one pass',
+          () async {
+        Tensor tensor = await Tensor.create([3, 4]);
+        final indices = [
+          for (int r = 0; r < 3; r++) [r, (r * 3) % 4]
+        ];
+        await tensor.setElements(indices, [1.5, -2.0, 7.0]);
+        expect(
+            await tensor.getData(),
+            equals(
+                Float32List.fromList([1.5, 0, 0, 0, 0, 0, 0, -2, 0, 0, 7, 0])));
+
+        // Gather through a transposed view.
+        Tensor view = await tensor.transpose();
+        final values = await view.getElements([
+          [0, 0],
+          [3, 1],
+          [2, 2],
+          [1, 1],
+        ]);
+        expect(values, equals(Float32List.fromList([1.5, -2, 7, 0])));
+        expect(() => tensor.setElements(indices, [1.0]), throwsException);
+        view.destroy();
+        tensor.destroy();
+      });
+
       test('getElement throws error on invalid indices', () async {
         final data = Float32List.fromList([0, 1, 2, 3, 4, 5]);
         Tensor tensor = await Tensor.create([2, 3], data: data);
@@ -210,4 +236,114 @@ void main() {
       });
     });
   });
+
+  group('Strided views', () {
+    test('transpose returns a view sharing the buffer', () async {
+      // [[0, 1, 2],
+      //  [3, 4, 5]]
+      final data = Float32List.fromList([0, 1, 2, 3, 4, 5]);
+      Tensor tensor = await Tensor.create([2, 3], data: data);
+      Tensor t = await tensor.transpose();
+      expect(identical(t.buffer, tensor.buffer), isTrue);
+      expect(t.shape, equals([3, 2]));
+      expect(t.strides, equals([1, 3]));
+      expect(await t.getData(), equals([0.0, 3.0, 1.0, 4.0, 2.0, 5.0]));
+      expect(await t.getElement([2, 1]), equals(5.0));
+      tensor.destroy();
+    });
+
+    test('permute of a 3D tensor gathers correctly', () async {
+      final data =
+          Float32List.fromList(List<double>.generate(24, (i) => i.toDouble()));
+      Tensor tensor = await Tensor.create([2, 3, 4], data: data);
+      Tensor p = tensor.permute([2, 0, 1]);
+      expect(p.shape, equals([4, 2, 3]));
+      final result = await p.getData();
+      for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 2; b++) {
+          for (int c = 0; c < 3; c++) {
+            expect(result[(a * 2 + b) * 3 + c], equals(data[(b * 3 + c) * 4 + a]));
+          }
+        }
+      }
+      tensor.destroy();
+    });
+
+    test('contiguous copies a large transposed view', () async {
+      // Large enough to span several 32x32 copy tiles.
+      final data =
+          Float32List.fromList(List<double>.generate(70 * 45, (i) => i.toDouble()));
+      Tensor tensor = await Tensor.create([70, 45], data: data);
+      Tensor t = await tensor.transpose();
+      Tensor dense = await t.contiguous();
+      expect(dense.isContiguous, isTrue);
+      final result = await dense.getData();
+      for (int r = 0; r < 45; r++) {
+        for (int c = 0; c < 70; c++) {
+          expect(result[r * 70 + c], equals(data[c * 45 + r]));
+        }
+      }
+      tensor.destroy();
+      dense.destroy();
+    });
+
+    test('contiguous copies a transpose past the workgroup grid limit',
+        () async {
+      // One copy tile per leading index, more than one grid dimension holds.
+      const outer = 70000;
+      final data = Float32List.fromList(
+          List<double>.generate(outer * 6, (i) => i.toDouble()));
+      Tensor tensor = await Tensor.create([outer, 2, 3], data: data);
+      Tensor dense = await tensor.permute([0, 2, 1]).contiguous();
+      final result = await dense.getData();
+      for (final n in [0, 1, outer ~/ 2, outer - 1]) {
+        for (int r = 0; r < 3; r++) {
+          for (int c = 0; c < 2; c++) {
+            expect(result[n * 6 + r * 2 + c], equals(data[n * 6 + c * 3 + r]));
+          }
+        }
+      }
+      tensor.destroy();
+      dense.destroy();
+    });
+
+    test('column slice is a strided view', () async {
+      final data = Float32List.fromList([0, 1, 2, 3, 4, 5, 6, 7, 8]);
+      Tensor tensor = await Tensor.create([3, 3], data: data);
+      Tensor col = await tensor.slice(startIndices: [0, 1], endIndices: [3, 2]);
+      expect(col.offset, equals(1));
+      expect(col.isRowMajor, isFalse);
+      expect(await col.getData(), equals([1.0, 4.0, 7.0]));
+      expect(() => col.reshape([3]), throwsException);
+      tensor.destroy();
+    });
+
+    test('expand, squeeze and unsqueeze change only metadata', () async {
+      final data = Float32List.fromList([1, 2, 3]);
+      Tensor tensor = await Tensor.create([3], data: data);
+      Tensor row = tensor.unsqueeze(0);
+      expect(row.shape, equals([1, 3]));
+      Tensor tiled = row.expand([2, 3]);
+      expect(tiled.strides, equals([0, 1]));
+      expect(await tiled.getData(), equals([1.0, 2.0, 3.0, 1.0, 2.0, 3.0]));
+      expect(row.squeeze().shape, equals([3]));
+      expect(() => tensor.expand([2, 4]), throwsException);
+      tensor.destroy();
+    });
+
+    test('elementwise ops and matMul read transposed views', () async {
+      final data = Float32List.fromList([1, 2, 3, 4, 5, 6]);
+      Tensor a = await Tensor.create([2, 3], data: data);
+      Tensor at = await a.transpose();
+      Tensor sum = await at.add(at);
+      expect(await sum.getData(), equals([2.0, 8.0, 4.0, 10.0, 6.0, 12.0]));
+      // A^T (3x2) x A (2x3)
+      Tensor gram = await at.matMul(a);
+      expect(await gram.getData(),
+          equals([17.0, 22.0, 27.0, 22.0, 29.0, 36.0, 27.0, 36.0, 45.0]));
+      a.destroy();
+      sum.destroy();
+      gram.destroy();
+    });
+  });
 }
@@ -1,3 +1,4 @@
+import 'dart:math' as math;
 import 'dart:typed_data';
 import 'package:gpu_tensor/gpu_tensor.dart';
 import 'package:test/test.dart';
@@ -44,6 +45,71 @@ Future<void> main() async {
       result.destroy();
     });
 
+    test('Skinny matMul matches the reference', () async {
+      // m = 1 with vec4 weight reads, and m = 5 against a transposed
+      // (strided) B with an odd column count.
+      for (final (m, k, p, transposed) in [
+        (1, 300, 260, false),
+        (5, 37, 7, true),
+      ]) {
+        final aData = Float32List.fromList(
+            [for (int i = 0; i < m * k; i++) (i % 13) - 6.0]);
+        final bData = Float32List.fromList(
+            [for (int i = 0; i < k * p; i++) (i % 7) * 0.5 - 1.5]);
+        var a = await Tensor.create([m, k], data: aData);
+        var stored = await Tensor.create(transposed ? [p, k] : [k, p],
+            data: bData);
+        var b = transposed ? await stored.transpose() : stored;
+        var result = await a.matMul(b);
+        var resultData = await result.getData();
+        for (int r = 0; r < m; r++) {
+          for (int c = 0; c < p; c++) {
+            double expected = 0;
+            for (int i = 0; i < k; i++) {
+              expected += aData[r * k + i] *
+                  (transposed ? bData[c * k + i] : bData[i * p + c]);
+            }
+            expect(resultData[r * p + c], closeTo(expected, 1e-3));
+          }
+        }
+        a.destroy();
+        if (transposed) b.destroy();
+        stored.destroy();
+        result.destroy();
+      }
+    });
+
+    test('Batched matMul past the workgroup grid limit', () async {
+      // One workgroup per batch for both the skinny (m = 1) and the tiled
+      // (m = 9) kernel, more than one grid dimension holds.
+      const batch = 70000, k = 2, p = 3;
+      for (final m in [1, 9]) {
+        final aData = Float32List.fromList(
+            [for (int i = 0; i < batch * m * k; i++) (i % 11) - 5.0]);
+        final bData = Float32List.fromList(
+            [for (int i = 0; i < batch * k * p; i++) (i % 5) - 2.0]);
+        var a = await Tensor.create([batch, m, k], data: aData);
+        var b = await Tensor.create([batch, k, p], data: bData);
+        var result = await a.matMul(b);
+        var resultData = await result.getData();
+        for (final n in [0, 1, batch ~/ 2, batch - 1]) {
+          for (int r = 0; r < m; r++) {
+            for (int c = 0; c < p; c++) {
+              double expected = 0;
+              for (int i = 0; i < k; i++) {
+                expected += aData[(n * m + r) * k + i] *
+                    bData[(n * k + i) * p + c];
+              }
+              expect(resultData[(n * m + r) * p + c], equals(expected));
+            }
+          }
+        }
+        a.destroy();
+        b.destroy();
+        result.destroy();
+      }
+    });
+
     test('Matrix multiplication with incompatible shapes throws exception',
         () async {
       var tensorA = await Tensor.create([2, 2]);
@@ -181,5 +247,310 @@ Future<void> main() async {
       imageTensor.destroy();
       kernelTensor.destroy();
     });
+
+    test('conv2dBatched NCHW matches a direct convolution', () async {
+      // N=2, Cin=2, H=W=5, Cout=3, 3x3 kernel with stride 2 and padding 1.
+      const n = 2, cin = 2, h = 5, w = 5, cout = 3, k = 3;
+      var input = Float32List.fromList(
+          List.generate(n * cin * h * w, (i) => ((i * 7) % 11 - 5).toDouble()));
+      var weights = Float32List.fromList(
+          List.generate(cout * cin * k * k, (i) => ((i * 5) % 7 - 3).toDouble()));
+      var expected = _referenceConvNchw(input, weights,
+          n: n, cin: cin, h: h, w: w, cout: cout, k: k, stride: 2, pad: 1);
+
+      var inputTensor = await Tensor.create([n, cin, h, w], data: input);
+      var kernelTensor = await Tensor.create([cout, cin, k, k], data: weights);
+      var outputTensor = await inputTensor.conv2dBatched(kernelTensor,
+          strideH: 2, strideW: 2, padH: 1, padW: 1);
+      expect(outputTensor.shape, equals([n, cout, 3, 3]));
+      expect(await outputTensor.getData(), equals(expected));
+
+      inputTensor.destroy();
+      kernelTensor.destroy();
+      outputTensor.destroy();
+    });
+
+    test('conv2dBatched Winograd path matches the GEMM path', () async {
+      const n = 1, cin = 3, h = 6, w = 7, cout = 2;
+      var input = Float32List.fromList(
+          List.generate(n * cin * h * w, (i) => ((i * 3) % 13 - 6) / 4));
+      var weights = Float32List.fromList(
+          List.generate(cout * cin * 9, (i) => ((i * 5) % 9 - 4) / 2));
+      var inputTensor = await Tensor.create([n, cin, h, w], data: input);
+      var kernelTensor = await Tensor.create([cout, cin, 3, 3], data: weights);
+
+      var fast = await inputTensor.conv2dBatched(kernelTensor, padH: 1, padW: 1);
+      var gemm = await inputTensor.conv2dBatched(kernelTensor,
+          padH: 1, padW: 1, winograd: false);
+      expect(fast.shape, equals([n, cout, h, w]));
+      var fastData = await fast.getData();
+      var gemmData = await gemm.getData();
+      for (int i = 0; i < gemmData.length; i++) {
+        expect(fastData[i], closeTo(gemmData[i], 1e-3));
+      }
+
+      inputTensor.destroy();
+      kernelTensor.destroy();
+      fast.destroy();
+      gemm.destroy();
+    });
+
+    test('conv2dBatched NHWC matches NCHW', () async {
+      const n = 2, cin = 2, h = 4, w = 4, cout = 2, k = 2;
+      var nchw = Float32List.fromList(
+          List.generate(n * cin * h * w, (i) => (i % 9).toDouble()));
+      var oihw = Float32List.fromList(
+          List.generate(cout * cin * k * k, (i) => (i % 4 - 1).toDouble()));
+      // Re-lay the same data out as NHWC / HWIO.
+      var nhwc = Float32List(nchw.length);
+      for (int b = 0; b < n; b++) {
+        for (int c = 0; c < cin; c++) {
+          for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+              nhwc[((b * h + y) * w + x) * cin + c] =
+                  nchw[((b * cin + c) * h + y) * w + x];
+            }
+          }
+        }
+      }
+      var hwio = Float32List(oihw.length);
+      for (int o = 0; o < cout; o++) {
+        for (int c = 0; c < cin; c++) {
+          for (int r = 0; r < k; r++) {
+            for (int s = 0; s < k; s++) {
+              hwio[((r * k + s) * cin + c) * cout + o] =
+                  oihw[((o * cin + c) * k + r) * k + s];
+            }
+          }
+        }
+      }
+      var expected = _referenceConvNchw(nchw, oihw,
+          n: n, cin: cin, h: h, w: w, cout: cout, k: k, stride: 1, pad: 0);
+
+      var inputTensor = await Tensor.create([n, h, w, cin], data: nhwc);
+      var kernelTensor = await Tensor.create([k, k, cin, cout], data: hwio);
+      var outputTensor = await inputTensor.conv2dBatched(kernelTensor,
+          layout: ConvLayout.nhwc);
+      expect(outputTensor.shape, equals([n, 3, 3, cout]));
+      var outputData = await outputTensor.getData();
+      for (int b = 0; b < n; b++) {
+        for (int o = 0; o < cout; o++) {
+          for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+              expect(outputData[((b * 3 + y) * 3 + x) * cout + o],
+                  equals(expected[((b * cout + o) * 3 + y) * 3 + x]));
+            }
+          }
+        }
+      }
+
+      inputTensor.destroy();
+      kernelTensor.destroy();
+      outputTensor.destroy();
+    });
   });
+
+  group('Linear layer tests', () {
+    test('linear fuses bias, activation and residual', () async {
+      var x = await Tensor.create([2, 3],
+          data: Float32List.fromList([1, 2, 3, -1, 0, 1]));
+      // The same weights stored as [k, n] and as [n, k].
+      var w = await Tensor.create([3, 2],
+          data: Float32List.fromList([1, 0, 0, 1, 1, -1]));
+      var wT = await Tensor.create([2, 3],
+          data: Float32List.fromList([1, 0, 1, 0, 1, -1]));
+      var bias =
+          await Tensor.create([2], data: Float32List.fromList([0.5, 0.5]));
+      var residual =
+          await Tensor.create([2], data: Float32List.fromList([1, 1]));
+      for (final transposed in [false, true]) {
+        var result = await x.linear(transposed ? wT : w,
+            bias: bias,
+            activation: Activation.relu,
+            residual: residual,
+            transposeWeight: transposed);
+        expect(result.shape, equals([2, 2]));
+        var resultData = await result.getData();
+        expect(resultData, equals(Float32List.fromList([5.5, 1, 1.5, 1])));
+        result.destroy();
+      }
+      x.destroy();
+      w.destroy();
+      wT.destroy();
+      bias.destroy();
+      residual.destroy();
+    });
+
+    test('linear with mismatched weight throws exception', () async {
+      var x = await Tensor.create([2, 3]);
+      var w = await Tensor.create([2, 2]);
+      expect(() => x.linear(w), throwsException);
+      x.destroy();
+      w.destroy();
+    });
+  });
+
+  group('Attention tests', () {
+    Float32List seq(int n, double step) =>
+        Float32List.fromList([for (int i = 0; i < n; i++) math.sin(i * step)]);
+
+    test('scaledDotProductAttention matches the reference', () async {
+      // Two batches of two heads; more keys than one staged block.
+      const heads = 4, lq = 70, lk = 150, d = 16, dv = 8;
+      final qData = seq(heads * lq * d, 0.37);
+      final kData = seq(heads * lk * d, 0.53);
+      final vData = seq(heads * lk * dv, 0.71);
+      var q = await Tensor.create([2, 2, lq, d], data: qData);
+      var k = await Tensor.create([2, 2, lk, d], data: kData);
+      var v = await Tensor.create([2, 2, lk, dv], data: vData);
+      var result = await scaledDotProductAttention(q, k, v);
+      expect(result.shape, equals([2, 2, lq, dv]));
+      var resultData = await result.getData();
+      var expected = _referenceAttention(
+          qData, kData, vData, heads, lq, lk, d, dv,
+          causal: false);
+      for (int i = 0; i < expected.length; i++) {
+        expect(resultData[i], closeTo(expected[i], 1e-4));
+      }
+      q.destroy();
+      k.destroy();
+      v.destroy();
+      result.destroy();
+    });
+
+    test('scaledDotProductAttention past the workgroup grid limit', () async {
+      // One workgroup per batch, more than one grid dimension holds.
+      const batch = 70000, lk = 3, d = 2, dv = 2;
+      final qData = seq(batch * d, 0.37);
+      final kData = seq(batch * lk * d, 0.53);
+      final vData = seq(batch * lk * dv, 0.71);
+      var q = await Tensor.create([batch, 1, d], data: qData);
+      var k = await Tensor.create([batch, lk, d], data: kData);
+      var v = await Tensor.create([batch, lk, dv], data: vData);
+      var result = await scaledDotProductAttention(q, k, v);
+      var resultData = await result.getData();
+      var expected = _referenceAttention(
+          qData, kData, vData, batch, 1, lk, d, dv,
+          causal: false);
+      for (final i in [0, 1, batch, expected.length - 1]) {
+        expect(resultData[i], closeTo(expected[i], 1e-4));
+      }
+      q.destroy();
+      k.destroy();
+      v.destroy();
+      result.destroy();
+    });
+
+    test('scaledDotProductAttention with causal masking', () async {
+      const lq = 130, d = 8;
+      final qData = seq(lq * d, 0.29);
+      final kData = seq(lq * d, 0.61);
+      final vData = seq(lq * d, 0.17);
+      var q = await Tensor.create([lq, d], data: qData);
+      var k = await Tensor.create([lq, d], data: kData);
+      var v = await Tensor.create([lq, d], data: vData);
+      var result = await scaledDotProductAttention(q, k, v, causal: true);
+      var resultData = await result.getData();
+      var expected = _referenceAttention(qData, kData, vData, 1, lq, lq, d, d,
+          causal: true);
+      for (int i = 0; i < expected.length; i++) {
+        expect(resultData[i], closeTo(expected[i], 1e-4));
+      }
+      q.destroy();
+      k.destroy();
+      v.destroy();
+      result.destroy();
+    });
+
+    test('scaledDotProductAttention applies an additive mask', () async {
+      // Hiding the second key leaves only the first value.
+      var q = await Tensor.create([1, 2], data: Float32List.fromList([1, 0]));
+      var k = await Tensor.create([2, 2],
+          data: Float32List.fromList([1, 0, 0, 1]));
+      var v = await Tensor.create([2, 1], data: Float32List.fromList([3, 7]));
+      var mask =
+          await Tensor.create([1, 2], data: Float32List.fromList([0, -1e9]));
+      var result = await scaledDotProductAttention(q, k, v, mask: mask);
+      var resultData = await result.getData();
+      expect(resultData[0], closeTo(3.0, 1e-5));
+      q.destroy();
+      k.destroy();
+      v.destroy();
+      mask.destroy();
+      result.destroy();
+    });
+  });
+}
+
+/// Direct NCHW convolution on the CPU used as a reference.
+Float32List _referenceConvNchw(Float32List input, Float32List weights,
+    {required int n,
+    required int cin,
+    required int h,
+    required int w,
+    required int cout,
+    required int k,
+    required int stride,
+    required int pad}) {
+  int outH = (h + 2 * pad - k) ~/ stride + 1;
+  int outW = (w + 2 * pad - k) ~/ stride + 1;
+  var out = Float32List(n * cout * outH * outW);
+  for (int b = 0; b < n; b++) {
+    for (int o = 0; o < cout; o++) {
+      for (int oy = 0; oy < outH; oy++) {
+        for (int ox = 0; ox < outW; ox++) {
+          double sum = 0;
+          for (int c = 0; c < cin; c++) {
+            for (int r = 0; r < k; r++) {
+              for (int s = 0; s < k; s++) {
+                int y = oy * stride - pad + r;
+                int x = ox * stride - pad + s;
+                if (y < 0 || y >= h || x < 0 || x >= w) continue;
+                sum += input[((b * cin + c) * h + y) * w + x] *
+                    weights[((o * cin + c) * k + r) * k + s];
+              }
+            }
+          }
+          out[((b * cout + o) * outH + oy) * outW + ox] = sum;
+        }
+      }
+    }
+  }
+  return out;
+}
+
+/// Naive attention over [heads] independent `[lq, d]` x `[lk, d]` problems.
+Float32List _referenceAttention(Float32List q, Float32List k, Float32List v,
+    int heads, int lq, int lk, int d, int dv,
+    {required bool causal}) {
+  var out = Float32List(heads * lq * dv);
+  final double scale = 1 / math.sqrt(d);
+  for (int h = 0; h < heads; h++) {
+    for (int i = 0; i < lq; i++) {
+      final scores = List<double>.filled(lk, double.negativeInfinity);
+      double maxScore = double.negativeInfinity;
+      for (int j = 0; j < lk; j++) {
+        if (causal && j > i) continue;
+        double s = 0;
+        for (int c = 0; c < d; c++) {
+          s += q[(h * lq + i) * d + c] * k[(h * lk + j) * d + c];
+        }
+        scores[j] = s * scale;
+        maxScore = math.max(maxScore, scores[j]);
+      }
+      double total = 0;
+      for (int j = 0; j < lk; j++) {
+        scores[j] = math.exp(scores[j] - maxScore);
+        total += scores[j];
+      }
+      for (int c = 0; c < dv; c++) {
+        double acc = 0;
+        for (int j = 0; j < lk; j++) {
+          acc += scores[j] * v[(h * lk + j) * dv + c];
+        }
+        out[(h * lq + i) * dv + c] = acc / total;
+      }
+    }
+  }
+  return out;
 }
@@ -0,0 +1,112 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:test/test.dart';
+import 'package:gpu_tensor/gpu_tensor.dart';
+
+Future<void> main() async {
+  group('Normalization Tests', () {
+    test('meanVar over short rows', () async {
+      Tensor tensor = await Tensor.create([2, 4],
+          data: Float32List.fromList([1, 2, 3, 4, 10, 10, 10, 14]));
+      final (mean, variance) = await tensor.meanVar();
+      Float32List meanData = await mean.getData();
+      Float32List varData = await variance.getData();
+
+      expect(meanData[0], closeTo(2.5, 1e-5));
+      expect(meanData[1], closeTo(11.0, 1e-5));
+      expect(varData[0], closeTo(1.25, 1e-5));
+      expect(varData[1], closeTo(3.0, 1e-5));
+      tensor.destroy();
+      mean.destroy();
+      variance.destroy();
+    });
+
+    test('meanVar over a long axis with a large offset', () async {
+      // Values around 1e4 with unit spread lose everything to cancellation
+      // in a naive sum-of-squares variance.
+      const d = 3000;
+      final data = Float32List(2 * d);
+      for (int i = 0; i < d; i++) {
+        data[i * 2] = 10000.0 + (i % 2 == 0 ? 1.0 : -1.0);
+        data[i * 2 + 1] = i.toDouble();
+      }
+      Tensor tensor = await Tensor.create([d, 2], data: data);
+      final (mean, variance) = await tensor.meanVar(axis: 0, unbiased: true);
+      Float32List meanData = await mean.getData();
+      Float32List varData = await variance.getData();
+
+      expect(meanData[0], closeTo(10000.0, 1e-2));
+      expect(varData[0], closeTo(d / (d - 1), 1e-2));
+      expect(meanData[1], closeTo((d - 1) / 2, 1e-2));
+      expect(varData[1], closeTo(d * (d + 1) / 12, 1.0));
+      tensor.destroy();
+      mean.destroy();
+      variance.destroy();
+    });
+
+    test('layerNorm with gamma and beta', () async {
+      const rows = 3, d = 1000;
+      final data = Float32List(rows * d);
+      for (int i = 0; i < data.length; i++) {
+        data[i] = math.sin(i.toDouble()) * 5 + i ~/ d;
+      }
+      final gammaData = Float32List(d);
+      final betaData = Float32List(d);
+      for (int j = 0; j < d; j++) {
+        gammaData[j] = 1.0 + j / d;
+        betaData[j] = j / d - 0.5;
+      }
+      Tensor tensor = await Tensor.create([rows, d], data: data);
+      Tensor gamma = await Tensor.create([d], data: gammaData);
+      Tensor beta = await Tensor.create([d], data: betaData);
+      Tensor result = await tensor.layerNorm(gamma, beta);
+      Float32List resultData = await result.getData();
+
+      for (int r = 0; r < rows; r++) {
+        double mean = 0;
+        for (int j = 0; j < d; j++) {
+          mean += data[r * d + j];
+        }
+        mean /= d;
+        double variance = 0;
+        for (int j = 0; j < d; j++) {
+          variance += math.pow(data[r * d + j] - mean, 2);
+        }
+        variance /= d;
+        final double rstd = 1 / math.sqrt(variance + 1e-5);
+        for (int j = 0; j < d; j++) {
+          final double expected =
+              (data[r * d + j] - mean) * rstd * gammaData[j] + betaData[j];
+          expect(resultData[r * d + j], closeTo(expected, 1e-3));
+        }
+      }
+      tensor.destroy();
+      gamma.destroy();
+      beta.destroy();
+      result.destroy();
+    });
+
+    test('rmsNorm without weight', () async {
+      Tensor tensor = await Tensor.create([2, 2],
+          data: Float32List.fromList([3, 4, 1, -1]));
+      Tensor result = await tensor.rmsNorm(null, eps: 0.0);
+      Float32List resultData = await result.getData();
+
+      final double rms0 = math.sqrt(12.5);
+      List<double> expected = [3 / rms0, 4 / rms0, 1.0, -1.0];
+      for (int i = 0; i < expected.length; i++) {
+        expect(resultData[i], closeTo(expected[i], 1e-5));
+      }
+      tensor.destroy();
+      result.destroy();
+    });
+
+    test('rmsNorm rejects a mismatched weight', () async {
+      Tensor tensor = await Tensor.create([2, 4]);
+      Tensor weight = await Tensor.create([3]);
+      expect(() => tensor.rmsNorm(weight), throwsException);
+      tensor.destroy();
+      weight.destroy();
+    });
+  });
+}
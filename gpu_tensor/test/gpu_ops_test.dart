@@ -19,6 +19,40 @@ Future<void> main() async {
       result.destroy();
     });
 
+    test('Tensor addition past the workgroup grid limit', () async {
+      // 70000 workgroups of 256 threads, more than one grid dimension holds.
+      const size = 70000 * 256;
+      final aData = Float32List(size);
+      aData[size - 1] = 3;
+      final tensorA = await Tensor.create([size], data: aData);
+      final tensorB = await Tensor.create([1], data: Float32List.fromList([2]));
+      final result = await tensorA.add(tensorB);
+      final resultData = await result.getData();
+      expect(resultData[0], equals(2));
+      expect(resultData[size - 1], equals(5));
+      tensorA.destroy();
+      tensorB.destroy();
+      result.destroy();
+    });
+
+    test('Tensor sum over long rows', () async {
+      const rows = 3, cols = 5000;
+      final data = Float32List.fromList(
+          List.generate(rows * cols, (i) => (i % 7).toDouble()));
+      final tensor = await Tensor.create([rows, cols], data: data);
+      final sums = await tensor.sum();
+      final result = await sums.getData();
+      for (var r = 0; r < rows; r++) {
+        var expected = 0.0;
+        for (var c = 0; c < cols; c++) {
+          expected += data[r * cols + c];
+        }
+        expect(result[r], closeTo(expected, 1e-2));
+      }
+      tensor.destroy();
+      sums.destroy();
+    });
+
     test('Tensor multiply scalar', () async {
       var shape = [4];
       var dataIn = Float32List.fromList([1, 2, 3, 4]);
@@ -218,6 +252,35 @@ Future<void> main() async {
       result.destroy();
     });
 
+    test('scalar ops accept non-finite and fractional scalars', () async {
+      var tensor =
+          await Tensor.create([3], data: Float32List.fromList([1, 2, 3.5]));
+      var inf = await tensor.addScalar(double.infinity);
+      expect((await inf.getData()).every((v) => v == double.infinity), isTrue);
+      var nan = await tensor.multiplyScalar(double.nan);
+      expect((await nan.getData()).every((v) => v.isNaN), isTrue);
+      var mod = await tensor.modScalar(0.25);
+      expect(await mod.getData(), equals(Float32List.fromList([0, 0, 0])));
+      tensor.destroy();
+      inf.destroy();
+      nan.destroy();
+      mod.destroy();
+    });
+
+    test('chained scalar ops reuse params slots in order', () async {
+      // More launches than the params ring has slots, all left pending
+      // until the final read.
+      Tensor acc = await Tensor.create([4], data: Float32List(4));
+      for (int i = 1; i <= 100; i++) {
+        final Tensor next = await acc.addScalar(i.toDouble());
+        acc.destroy();
+        acc = next;
+      }
+      expect(await acc.getData(),
+          equals(Float32List.fromList([5050, 5050, 5050, 5050])));
+      acc.destroy();
+    });
+
     test('Operator overload % computes elementwise modulus for two tensors',
         () async {
       var shape = [4];
@@ -335,6 +398,56 @@ Future<void> main() async {
       result.destroy();
     });
 
+    test('add broadcasts a bias row across a matrix', () async {
+      var matrix = await Tensor.create([2, 3],
+          data: Float32List.fromList([1, 2, 3, 4, 5, 6]));
+      var bias = await Tensor.create([3],
+          data: Float32List.fromList([10, 20, 30]));
+      var result = await matrix.add(bias);
+      expect(result.shape, equals([2, 3]));
+      expect(await result.getData(),
+          equals(Float32List.fromList([11, 22, 33, 14, 25, 36])));
+      matrix.destroy();
+      bias.destroy();
+      result.destroy();
+    });
+
+    test('multiply broadcasts a column vector and a scalar tensor', () async {
+      var matrix = await Tensor.create([2, 3],
+          data: Float32List.fromList([1, 2, 3, 4, 5, 6]));
+      var column = await Tensor.create([2, 1],
+          data: Float32List.fromList([2, 10]));
+      var scalar = await Tensor.create([1], data: Float32List.fromList([0.5]));
+      var scaled = await matrix.multiply(column);
+      expect(await scaled.getData(),
+          equals(Float32List.fromList([2, 4, 6, 40, 50, 60])));
+      var halved = await scaled * scalar;
+      expect(await halved.getData(),
+          equals(Float32List.fromList([1, 2, 3, 20, 25, 30])));
+      matrix.destroy();
+      column.destroy();
+      scalar.destroy();
+      scaled.destroy();
+      halved.destroy();
+    });
+
+    test('broadcasting two operands grows both', () async {
+      var column = await Tensor.create([3, 1],
+          data: Float32List.fromList([1, 2, 3]));
+      var row =
+          await Tensor.create([1, 2], data: Float32List.fromList([1.5, 2.5]));
+      var result = await column.greaterThan(row);
+      expect(result.shape, equals([3, 2]));
+      expect(await result.getData(),
+          equals(Float32List.fromList([0, 0, 1, 0, 1, 1])));
+      var other = await Tensor.create([4, 2]);
+      expect(() => column.add(other), throwsException);
+      column.destroy();
+      row.destroy();
+      result.destroy();
+      other.destroy();
+    });
+
     test('Sum reduction along the last dimension', () async {
       // For a tensor of shape [2, 3]:
       // Row 1: 1+2+3 = 6, Row 2: 4+5+6 = 15
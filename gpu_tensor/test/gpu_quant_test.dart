@@ -0,0 +1,63 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:test/test.dart';
+import 'package:gpu_tensor/gpu_tensor.dart';
+
+Future<void> main() async {
+  group('Quantization Tests', () {
+    const k = 100, n = 37;
+    final weights = Float32List.fromList(
+        [for (int i = 0; i < k * n; i++) math.sin(i * 0.13) * (1 + i % 5)]);
+
+    for (final bits in [8, 4]) {
+      test('int$bits dequantize stays within half a step', () async {
+        final q = await QuantizedTensor.quantize(weights, [k, n],
+            bits: bits, groupSize: 32);
+        expect(q.sizeInBytes, lessThan(weights.length * 4));
+        Tensor dense = await q.dequantize();
+        Float32List denseData = await dense.getData();
+        Float32List scales = await q.scales.getData();
+        for (int i = 0; i < weights.length; i++) {
+          final double step = scales[(i ~/ n) ~/ 32 * n + i % n];
+          expect(denseData[i], closeTo(weights[i], step / 2 + 1e-5));
+        }
+        dense.destroy();
+        q.destroy();
+      });
+
+      test('int$bits matMulQuantized matches the dequantized weights',
+          () async {
+        final q = await QuantizedTensor.quantize(weights, [k, n], bits: bits);
+        Tensor dense = await q.dequantize();
+        Float32List w = await dense.getData();
+        // One row takes the GEMV path, 12 rows the tiled GEMM.
+        for (final m in [1, 12]) {
+          final xData = Float32List.fromList(
+              [for (int i = 0; i < m * k; i++) (i % 9) * 0.25 - 1]);
+          Tensor x = await Tensor.create([m, k], data: xData);
+          Tensor result = await x.matMulQuantized(q);
+          expect(result.shape, equals([m, n]));
+          Float32List resultData = await result.getData();
+          for (int r = 0; r < m; r++) {
+            for (int c = 0; c < n; c++) {
+              double expected = 0;
+              for (int i = 0; i < k; i++) {
+                expected += xData[r * k + i] * w[i * n + c];
+              }
+              expect(resultData[r * n + c], closeTo(expected, 1e-3));
+            }
+          }
+          x.destroy();
+          result.destroy();
+        }
+        dense.destroy();
+        q.destroy();
+      });
+    }
+
+    test('quantize rejects unsupported bit widths', () async {
+      expect(() => QuantizedTensor.quantize(weights, [k, n], bits: 2),
+          throwsException);
+    });
+  });
+}
@@ -0,0 +1,72 @@
+import 'dart:typed_data';
+import 'package:test/test.dart';
+import 'package:gpu_tensor/gpu_tensor.dart';
+
+Future<void> main() async {
+  group('Random Tests', () {
+    test('Philox matches the reference vector', () async {
+      // Random123 known answer for counter 0, key 0.
+      Tensor.manualSeed(0);
+      Tensor tensor = await Tensor.random([4]);
+      final expected = [0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8];
+      expect(
+          await tensor.getData(),
+          equals(Float32List.fromList(
+              [for (final x in expected) (x >> 8) / 16777216])));
+      tensor.destroy();
+    });
+
+    test('streams are reproducible and independent of shape', () async {
+      Tensor.manualSeed(42);
+      Tensor flat = await Tensor.random([1001]);
+      Tensor next = await Tensor.random([8]);
+      Tensor.manualSeed(42);
+      Tensor shaped = await Tensor.random([7, 11, 13]);
+      Float32List flatData = await flat.getData();
+      Float32List shapedData = await shaped.getData();
+      expect(shapedData, equals(flatData));
+      expect(await next.getData(), isNot(equals(flatData.sublist(0, 8))));
+      expect(flatData.every((v) => v >= 0 && v < 1), isTrue);
+      for (final t in [flat, next, shaped]) {
+        t.destroy();
+      }
+    });
+
+    test('randn has the requested mean and deviation', () async {
+      const n = 100000;
+      Tensor tensor = await Tensor.randn([n], mean: 2.0, std: 3.0);
+      Float32List data = await tensor.getData();
+      double mean = 0;
+      for (final v in data) {
+        mean += v;
+      }
+      mean /= n;
+      double variance = 0;
+      for (final v in data) {
+        variance += (v - mean) * (v - mean);
+      }
+      variance /= n;
+      expect(mean, closeTo(2.0, 0.05));
+      expect(variance, closeTo(9.0, 0.2));
+      tensor.destroy();
+    });
+
+    test('bernoulli and dropout keep the expected fraction', () async {
+      const n = 20000;
+      Tensor mask = await Tensor.bernoulli([n], 0.3);
+      Float32List maskData = await mask.getData();
+      expect(maskData.every((v) => v == 0 || v == 1), isTrue);
+      expect(maskData.where((v) => v == 1).length / n, closeTo(0.3, 0.02));
+
+      Tensor input = await Tensor.full([n], 2.0);
+      Tensor dropped = await input.dropout(0.75);
+      Float32List droppedData = await dropped.getData();
+      expect(droppedData.every((v) => v == 0 || v == 8), isTrue);
+      expect(droppedData.where((v) => v == 8).length / n, closeTo(0.25, 0.02));
+      expect(() => input.dropout(1.0), throwsException);
+      for (final t in [mask, input, dropped]) {
+        t.destroy();
+      }
+    });
+  });
+}
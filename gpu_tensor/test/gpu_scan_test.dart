@@ -0,0 +1,91 @@
+import 'dart:typed_data';
+import 'package:test/test.dart';
+import 'package:gpu_tensor/gpu_tensor.dart';
+
+Future<void> main() async {
+  group('Scan Tests', () {
+    test('cumsum along both axes', () async {
+      Tensor tensor = await Tensor.create([2, 3],
+          data: Float32List.fromList([1, 2, 3, 4, 5, 6]));
+      Tensor rows = await tensor.cumsum();
+      Tensor cols = await tensor.cumsum(axis: 0);
+      expect(await rows.getData(),
+          equals(Float32List.fromList([1, 3, 6, 4, 9, 15])));
+      expect(await cols.getData(),
+          equals(Float32List.fromList([1, 2, 3, 5, 7, 9])));
+      for (final t in [tensor, rows, cols]) {
+        t.destroy();
+      }
+    });
+
+    test('cumsum over rows spanning several levels of blocks', () async {
+      // 300000 elements need block totals of block totals.
+      const rows = 2, d = 300000;
+      final data = Float32List(rows * d);
+      for (int i = 0; i < data.length; i++) {
+        data[i] = (i % 3).toDouble();
+      }
+      Tensor tensor = await Tensor.create([rows, d], data: data);
+      Tensor result = await tensor.cumsum();
+      final expected = Float32List(rows * d);
+      for (int r = 0; r < rows; r++) {
+        double running = 0;
+        for (int j = 0; j < d; j++) {
+          running += data[r * d + j];
+          expected[r * d + j] = running;
+        }
+      }
+      expect(await result.getData(), equals(expected));
+      tensor.destroy();
+      result.destroy();
+    });
+
+    test('cumprod', () async {
+      Tensor tensor = await Tensor.create([5],
+          data: Float32List.fromList([1, 2, -3, 0.5, 4]));
+      Tensor result = await tensor.cumprod();
+      expect(await result.getData(),
+          equals(Float32List.fromList([1, 2, -6, -3, -12])));
+      tensor.destroy();
+      result.destroy();
+    });
+
+    test('maskedSelect and nonzero report the count on the device', () async {
+      Tensor tensor = await Tensor.create([2, 3],
+          data: Float32List.fromList([5, -1, 7, 0, 2, -4]));
+      Tensor zero = await Tensor.create([1]);
+      Tensor mask = await tensor.greaterThan(zero);
+
+      final (values, count) = await tensor.maskedSelect(mask);
+      expect(Uint32List.view((await count.getData()).buffer), equals([3]));
+      expect((await values.getData()).sublist(0, 3),
+          equals(Float32List.fromList([5, 7, 2])));
+
+      final (indices, nonzeroCount) = await tensor.nonzero();
+      expect(indices.shape, equals([6, 2]));
+      expect(Uint32List.view((await nonzeroCount.getData()).buffer),
+          equals([5]));
+      expect((await indices.getData()).sublist(0, 10),
+          equals(Float32List.fromList([0, 0, 0, 1, 0, 2, 1, 1, 1, 2])));
+
+      for (final t in [tensor, zero, mask, values, count, indices]) {
+        t.destroy();
+      }
+      nonzeroCount.destroy();
+    });
+
+    test('where selects elementwise with broadcasting', () async {
+      Tensor tensor = await Tensor.create([2, 2],
+          data: Float32List.fromList([1, 2, 3, 4]));
+      Tensor mask =
+          await Tensor.create([2], data: Float32List.fromList([1, 0]));
+      Tensor other = await Tensor.create([1], data: Float32List.fromList([-1]));
+      Tensor result = await tensor.where(mask, other);
+      expect(await result.getData(),
+          equals(Float32List.fromList([1, -1, 3, -1])));
+      for (final t in [tensor, mask, other, result]) {
+        t.destroy();
+      }
+    });
+  });
+}
@@ -0,0 +1,142 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:test/test.dart';
+import 'package:gpu_tensor/gpu_tensor.dart';
+
+/// Indices that stably sort [row]; the order every GPU path must match.
+List<int> _referenceArgsort(List<double> row, {bool descending = false}) {
+  final order = List<int>.generate(row.length, (i) => i);
+  order.sort((a, b) {
+    final int c =
+        descending ? row[b].compareTo(row[a]) : row[a].compareTo(row[b]);
+    return c != 0 ? c : a.compareTo(b);
+  });
+  return order;
+}
+
+Future<void> main() async {
+  group('Sort Tests', () {
+    // Few distinct values, so ties exercise stability.
+    final random = math.Random(7);
+    List<double> values(int n) =>
+        [for (int i = 0; i < n; i++) random.nextInt(50) - 25.0];
+
+    for (final d in [37, 3000]) {
+      test('sort and argsort rows of $d (${d <= 2048 ? 'bitonic' : 'radix'})',
+          () async {
+        const rows = 3;
+        final data = values(rows * d);
+        Tensor tensor =
+            await Tensor.create([rows, d], data: Float32List.fromList(data));
+        for (final descending in [false, true]) {
+          Tensor sorted = await tensor.sort(descending: descending);
+          Tensor order = await tensor.argsort(descending: descending);
+          Float32List sortedData = await sorted.getData();
+          Float32List orderData = await order.getData();
+          for (int r = 0; r < rows; r++) {
+            final row = data.sublist(r * d, (r + 1) * d);
+            final expected = _referenceArgsort(row, descending: descending);
+            for (int j = 0; j < d; j++) {
+              expect(orderData[r * d + j], equals(expected[j]));
+              expect(sortedData[r * d + j], equals(row[expected[j]]));
+            }
+          }
+          sorted.destroy();
+          order.destroy();
+        }
+        tensor.destroy();
+      });
+    }
+
+    test('NaNs sort last whatever their sign bit', () async {
+      // 0xffc00000 is a quiet NaN with the sign bit set.
+      final data = Float32List.fromList([2, 0, -1, 0, 1]);
+      Uint32List.view(data.buffer)
+        ..[1] = 0xffc00000
+        ..[3] = 0x7fc00000;
+      Tensor tensor = await Tensor.create([5], data: data);
+      Tensor order = await tensor.argsort();
+      Tensor sorted = await tensor.sort();
+      expect(await order.getData(),
+          equals(Float32List.fromList([2, 4, 0, 1, 3])));
+      final sortedData = await sorted.getData();
+      expect(
+          sortedData.sublist(0, 3), equals(Float32List.fromList([-1, 1, 2])));
+      expect(sortedData[3].isNaN && sortedData[4].isNaN, isTrue);
+      Tensor descending = await tensor.argsort(descending: true);
+      expect(await descending.getData(),
+          equals(Float32List.fromList([1, 3, 0, 4, 2])));
+      tensor.destroy();
+      order.destroy();
+      sorted.destroy();
+      descending.destroy();
+    });
+
+    test('sort along a leading axis', () async {
+      Tensor tensor = await Tensor.create([3, 2],
+          data: Float32List.fromList([3, -1, 1, 5, 2, 0]));
+      Tensor sorted = await tensor.sort(axis: 0);
+      Tensor order = await tensor.argsort(axis: 0);
+      expect(await sorted.getData(),
+          equals(Float32List.fromList([1, -1, 2, 0, 3, 5])));
+      expect(await order.getData(),
+          equals(Float32List.fromList([1, 0, 2, 2, 0, 1])));
+      tensor.destroy();
+      sorted.destroy();
+      order.destroy();
+    });
+
+    test('radixSort u32 keys with a payload', () async {
+      const n = 1000;
+      final keys = Uint32List.fromList(
+          [for (int i = 0; i < n; i++) (i * 2654435761) % 4294967296]);
+      final payload = Float32List.fromList(
+          [for (int i = 0; i < n; i++) i.toDouble()]);
+      Tensor keyTensor =
+          await Tensor.create([n], data: keys.buffer.asFloat32List());
+      Tensor payloadTensor = await Tensor.create([n], data: payload);
+      final (sortedKeys, sortedPayload) =
+          await keyTensor.radixSort(payload: payloadTensor, u32Keys: true);
+      final Uint32List keyData =
+          (await sortedKeys.getData()).buffer.asUint32List();
+      Float32List payloadData = await sortedPayload!.getData();
+
+      final expected = List<int>.generate(n, (i) => i)
+        ..sort((a, b) => keys[a].compareTo(keys[b]));
+      for (int i = 0; i < n; i++) {
+        expect(keyData[i], equals(keys[expected[i]]));
+        expect(payloadData[i], equals(expected[i]));
+      }
+      for (final t in [keyTensor, payloadTensor, sortedKeys, sortedPayload]) {
+        t.destroy();
+      }
+    });
+
+    for (final k in [5, 20]) {
+      test('topK($k) matches a full sort', () async {
+        const rows = 2, d = 10000;
+        final data = values(rows * d);
+        Tensor tensor =
+            await Tensor.create([rows, d], data: Float32List.fromList(data));
+        for (final largest in [true, false]) {
+          final (top, indices) = await tensor.topK(k, largest: largest);
+          expect(top.shape, equals([rows, k]));
+          Float32List topData = await top.getData();
+          Float32List indexData = await indices.getData();
+          for (int r = 0; r < rows; r++) {
+            final row = data.sublist(r * d, (r + 1) * d);
+            final expected = _referenceArgsort(row, descending: largest);
+            for (int j = 0; j < k; j++) {
+              expect(indexData[r * k + j], equals(expected[j]));
+              expect(topData[r * k + j], equals(row[expected[j]]));
+            }
+          }
+          top.destroy();
+          indices.destroy();
+        }
+        expect(() => tensor.topK(0), throwsException);
+        tensor.destroy();
+      });
+    }
+  });
+}
@@ -13,6 +13,36 @@ Future<void> main() async {
       tensor.destroy();
     });
 
+    test('device-side factories and fill', () async {
+      var full = await Tensor.full([3, 3], 2.5);
+      expect(
+          await full.getData(), equals(Float32List(9)..fillRange(0, 9, 2.5)));
+      await full.fill(0);
+      expect((await full.getData()).every((v) => v == 0), isTrue);
+
+      var ones = await Tensor.ones([5], dtype: DType.f16);
+      expect(await ones.getData(), equals(Float32List(5)..fillRange(0, 5, 1)));
+
+      var range = await Tensor.arange(1, 2, step: 0.25);
+      expect(await range.getData(),
+          equals(Float32List.fromList([1, 1.25, 1.5, 1.75])));
+      var down = await Tensor.arange(3, 0, step: -1);
+      expect(await down.getData(), equals(Float32List.fromList([3, 2, 1])));
+
+      var space = await Tensor.linspace(-1, 1, 5);
+      expect(await space.getData(),
+          equals(Float32List.fromList([-1, -0.5, 0, 0.5, 1])));
+
+      var eye = await Tensor.eye(2, m: 3);
+      expect(await eye.getData(),
+          equals(Float32List.fromList([1, 0, 0, 0, 1, 0])));
+
+      expect(() => Tensor.arange(0, 1, step: 0), throwsException);
+      for (final t in [full, ones, range, down, space, eye]) {
+        t.destroy();
+      }
+    });
+
     test('Tensor creation with initial data', () async {
       var shape = [3];
       var initialData = Float32List.fromList([1, 2, 3]);
@@ -21,5 +51,171 @@ Future<void> main() async {
       expect(data, equals(initialData));
       tensor.destroy();
     });
+
+    test('chained ops are visible to getData without explicit waits', () async {
+      var x = await Tensor.create([4], data: Float32List.fromList([1, 2, 3, 4]));
+      for (var i = 0; i < 20; i++) {
+        final next = await x.addScalar(1);
+        x.destroy();
+        x = next;
+      }
+      await x.sync();
+      expect(await x.getData(), equals(Float32List.fromList([21, 22, 23, 24])));
+      x.destroy();
+    });
+
+    test('scope destroys intermediates and keeps returned tensors', () async {
+      var input = await Tensor.create([3], data: Float32List.fromList([1, 2, 3]));
+      late Tensor intermediate;
+      var result = await Tensor.scope(() async {
+        intermediate = await input.multiplyScalar(2);
+        return intermediate.addScalar(1);
+      });
+      expect(intermediate.buffer.isDestroyed, isTrue);
+      expect(input.buffer.isDestroyed, isFalse);
+      expect(await result.getData(), equals(Float32List.fromList([3, 5, 7])));
+      input.destroy();
+      result.destroy();
+    });
+
+    test('scope keeps tensors returned in records', () async {
+      var input =
+          await Tensor.create([2, 2], data: Float32List.fromList([1, 4, 3, 2]));
+      late Tensor scratch;
+      var (values, indices) = await Tensor.scope(() async {
+        scratch = await input.addScalar(0);
+        return scratch.topK(1);
+      });
+      expect(scratch.buffer.isDestroyed, isTrue);
+      expect(await values.getData(), equals(Float32List.fromList([4, 3])));
+      expect(await indices.getData(), equals(Float32List.fromList([1, 0])));
+      var (mean, variance) = await Tensor.scope(() => input.meanVar());
+      expect(await mean.getData(), equals(Float32List.fromList([2.5, 2.5])));
+      expect(variance.buffer.isDestroyed, isFalse);
+      for (final t in [input, values, indices, mean, variance]) {
+        t.destroy();
+      }
+    });
+
+    test('nested scopes hand returned tensors to the outer scope', () async {
+      late Tensor inner;
+      await Tensor.scope(() async {
+        inner = await Tensor.scope(() async => Tensor.create([2]));
+        expect(inner.buffer.isDestroyed, isFalse);
+        return null;
+      });
+      expect(inner.buffer.isDestroyed, isTrue);
+    });
+
+    test('views keep a shared buffer alive until the last one is destroyed',
+        () async {
+      var tensor =
+          await Tensor.create([2, 2], data: Float32List.fromList([1, 2, 3, 4]));
+      var view = tensor.reshape([4]);
+      tensor.destroy();
+      tensor.destroy();
+      expect(view.buffer.isDestroyed, isFalse);
+      expect(await view.getData(), equals(Float32List.fromList([1, 2, 3, 4])));
+      view.destroy();
+      expect(view.buffer.isDestroyed, isTrue);
+    });
+
+    test('f16 tensors round-trip, convert and feed matMul', () async {
+      // Values exactly representable in half precision.
+      var data = Float32List.fromList([1, -2, 0.5, 3, 1024, -0.25]);
+      var half = await Tensor.create([2, 3], data: data, dtype: DType.f16);
+      expect(half.dtype, equals(DType.f16));
+      expect(await half.getData(), equals(data));
+      var transposed = await half.transpose();
+      expect(await transposed.getElement([2, 1]), equals(-0.25));
+      transposed.destroy();
+
+      var sum = await half.add(half);
+      expect(sum.dtype, equals(DType.f16));
+      expect(await sum.getData(),
+          equals(Float32List.fromList([2, -4, 1, 6, 2048, -0.5])));
+
+      var ones = await Tensor.create([3, 1],
+          data: Float32List.fromList([1, 1, 1]), dtype: DType.f16);
+      var product = await half.matMul(ones);
+      expect(product.dtype, equals(DType.f32));
+      expect(await product.getData(),
+          equals(Float32List.fromList([-0.5, 1026.75])));
+
+      var wide = await half.toDType(DType.f32);
+      expect(await wide.getData(), equals(data));
+      // Kernels that reinterpret raw bits still want f32.
+      expect(() => half.radixSort(), throwsUnsupportedError);
+
+      for (final t in [half, sum, ones, product, wide]) {
+        t.destroy();
+      }
+    });
+
+    test('reductions, norms, scans, sorts and attention read f16', () async {
+      // Exact in f16, so f16 and f32 inputs must give identical results.
+      final data = Float32List.fromList(
+          [for (int i = 0; i < 24; i++) ((i * 7) % 11 - 5) * 0.5]);
+      final full = await Tensor.create([2, 3, 4], data: data);
+      final half =
+          await Tensor.create([2, 3, 4], data: data, dtype: DType.f16);
+      final List<Future<Tensor> Function(Tensor)> ops = [
+        (t) => t.sum(),
+        (t) => t.mean(axis: 1),
+        (t) => t.maxReduction(),
+        (t) => t.minReduction(axis: 0),
+        (t) => t.argmax(),
+        (t) => t.softmax(),
+        (t) => t.variance(),
+        (t) => t.layerNorm(null, null),
+        (t) => t.rmsNorm(null),
+        (t) => t.cumsum(axis: 1),
+        (t) => t.sort(),
+        (t) => t.argsort(descending: true),
+        (t) async => (await t.topK(2)).$1,
+        (t) => scaledDotProductAttention(t, t, t),
+      ];
+      for (final op in ops) {
+        final expected = await op(full);
+        final actual = await op(half);
+        expect(actual.dtype, equals(DType.f32));
+        expect(await actual.getData(), equals(await expected.getData()));
+        expected.destroy();
+        actual.destroy();
+      }
+      full.destroy();
+      half.destroy();
+    });
+
+    test('warmupKernels precompiles the kernels ops launch', () async {
+      final gpu = DefaultMinigpu.instance;
+      Tensor.manualSeed(7);
+      final drawn = await Tensor.random([5]);
+      Tensor.manualSeed(7);
+      await warmupKernels(reductions: [
+        ([37, 29], 1)
+      ], matMuls: [
+        ([70, 33], [33, 19]),
+        ([3, 33], [33, 19])
+      ]);
+      // Captured draws do not advance the random stream.
+      final redrawn = await Tensor.random([5]);
+      expect(await redrawn.getData(), equals(await drawn.getData()));
+
+      final before = gpu.getStats();
+      await Tensor.scope(() async {
+        final x = await Tensor.create([37, 29]);
+        await x.sum(axis: 1);
+        await x.argmax(axis: 1);
+        final w = await Tensor.create([33, 19]);
+        await (await Tensor.create([70, 33])).matMul(w);
+        await (await Tensor.create([3, 33])).matMul(w);
+        await (await x.addScalar(1)).sigmoid();
+        await x.sync();
+      });
+      expect(gpu.getStats().compiles, equals(before.compiles));
+      drawn.destroy();
+      redrawn.destroy();
+    });
   });
 }
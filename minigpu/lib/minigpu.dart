@@ -1,3 +1,12 @@
 export 'package:minigpu/src/minigpu.dart' show Minigpu;
 export 'package:minigpu/src/compute_shader.dart' show ComputeShader;
 export 'package:minigpu/src/buffer.dart' show Buffer;
+export 'package:minigpu/src/command_list.dart' show CommandList;
+export 'package:minigpu_platform_interface/minigpu_platform_interface.dart'
+    show
+        MinigpuAdapterInfo,
+        MinigpuContextOptions,
+        MinigpuFeature,
+        MinigpuLimits,
+        MinigpuPowerPreference,
+        MinigpuStats;
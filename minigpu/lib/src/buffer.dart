@@ -3,25 +3,61 @@ import 'dart:typed_data';
 import 'package:minigpu_platform_interface/minigpu_platform_interface.dart';
 
 /// A buffer.
+///
+/// The native buffer is released by [destroy], or by a finalizer once this
+/// object becomes unreachable, whichever happens first.
 final class Buffer {
-  Buffer(PlatformBuffer buffer) : platformBuffer = buffer;
+  Buffer(PlatformBuffer buffer) : platformBuffer = buffer {
+    _finalizer.attach(this, buffer, detach: this);
+  }
+
+  static final _finalizer = Finalizer<PlatformBuffer>(
+    (buffer) => buffer.destroy(),
+  );
 
   final PlatformBuffer platformBuffer;
+  bool _destroyed = false;
+
+  /// Whether [destroy] has been called.
+  bool get isDestroyed => _destroyed;
+
+  // Buffers with a read in flight. The runtime copies out of the native
+  // buffer after read returns to the event loop, so the wrapper is held here
+  // until the copy completes; otherwise a temporary could be finalized, and
+  // its buffer released, mid-read.
+  static final List<Buffer> _reading = [];
 
   /// Reads data from the buffer synchronously.
   Future<void> read(
     Float32List outputData,
     int size, {
     int readOffset = 0,
-  }) async =>
-      platformBuffer.read(outputData, size, elementOffset: readOffset);
+  }) async {
+    _reading.add(this);
+    try {
+      await platformBuffer.read(outputData, size, elementOffset: readOffset);
+    } finally {
+      _reading.remove(this);
+    }
+  }
 
   /// Writes data to the buffer.
   void setData(Float32List inputData, int size) =>
       platformBuffer.setData(inputData, size);
 
-  /// Destroys the buffer.
-  void destroy() => platformBuffer.destroy();
+  /// Zeroes [byteSize] bytes starting at [byteOffset] without uploading
+  /// anything; a [byteSize] of 0 clears to the end of the buffer. The clear
+  /// is ordered with enqueued dispatches.
+  void clear({int byteOffset = 0, int byteSize = 0}) =>
+      platformBuffer.clear(byteOffset: byteOffset, byteSize: byteSize);
+
+  /// Destroys the buffer. Calling this more than once has no effect.
+  void destroy() {
+    if (_destroyed) return;
+    _destroyed = true;
+    _finalizer.detach(this);
+    platformBuffer.destroy();
+  }
 }
 
 class MinigpuAlreadyInitError extends Error {
@@ -0,0 +1,61 @@
+import 'dart:typed_data';
+
+import 'package:minigpu/src/buffer.dart';
+import 'package:minigpu_platform_interface/minigpu_platform_interface.dart';
+
+/// A reusable list of kernel launches, copies and uploads.
+///
+/// Commands are only recorded until [submit], which hands the whole list to
+/// the runtime in one call; launches and copies are then enqueued like
+/// [ComputeShader.enqueue]. Kernels are referred to by the id returned from
+/// [Minigpu.registerKernel], and bindings set on a kernel stay in place for
+/// later lists.
+///
+/// The native list is released by [destroy], or by a finalizer once this
+/// object becomes unreachable, whichever happens first.
+final class CommandList {
+  CommandList(PlatformCommandList list) : _list = list {
+    _finalizer.attach(this, list, detach: this);
+  }
+
+  static final _finalizer = Finalizer<PlatformCommandList>(
+    (list) => list.destroy(),
+  );
+
+  final PlatformCommandList _list;
+  bool _destroyed = false;
+
+  /// Binds [buffer] to `@binding(binding)` of [kernel]. Pass [offset] and
+  /// [size] (in bytes) to bind part of the buffer, as in
+  /// [ComputeShader.setBuffer].
+  void bind(int kernel, int binding, Buffer buffer,
+          {int offset = 0, int size = 0}) =>
+      _list.bind(kernel, binding, buffer.platformBuffer, offset, size);
+
+  /// Launches [kernel] over the given workgroup grid.
+  void dispatch(int kernel, int groupsX, [int groupsY = 1, int groupsZ = 1]) =>
+      _list.dispatch(kernel, groupsX, groupsY, groupsZ);
+
+  /// Copies [size] bytes from [source] to [target].
+  void copy(Buffer source, Buffer target, int size,
+          {int sourceOffset = 0, int targetOffset = 0}) =>
+      _list.copy(source.platformBuffer, sourceOffset, target.platformBuffer,
+          targetOffset, size);
+
+  /// Writes [data] into [buffer] at byte [offset] when the list runs. Host
+  /// buffers from [Minigpu.allocHostBuffer] are read in place and must not be
+  /// modified before [submit].
+  void upload(Buffer buffer, Float32List data, {int offset = 0}) =>
+      _list.upload(buffer.platformBuffer, offset, data);
+
+  /// Executes the recorded commands in order and empties the list.
+  void submit() => _list.submit();
+
+  /// Destroys the list. Calling this more than once has no effect.
+  void destroy() {
+    if (_destroyed) return;
+    _destroyed = true;
+    _finalizer.detach(this);
+    _list.destroy();
+  }
+}
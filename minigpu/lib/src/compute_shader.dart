@@ -2,10 +2,20 @@ import 'package:minigpu/src/buffer.dart';
 import 'package:minigpu_platform_interface/minigpu_platform_interface.dart';
 
 /// A compute shader.
+///
+/// The native shader is released by [destroy], or by a finalizer once this
+/// object becomes unreachable, whichever happens first.
 final class ComputeShader {
-  ComputeShader(PlatformComputeShader shader) : _shader = shader;
+  ComputeShader(PlatformComputeShader shader) : _shader = shader {
+    _finalizer.attach(this, shader, detach: this);
+  }
+
+  static final _finalizer = Finalizer<PlatformComputeShader>(
+    (shader) => shader.destroy(),
+  );
 
   final PlatformComputeShader _shader;
+  bool _destroyed = false;
   final Map<String, int> _kernelTags = {};
 
   /// Loads a kernel string into the shader.
@@ -16,19 +26,46 @@ final class ComputeShader {
   bool hasKernel() => _shader.hasKernel();
 
   /// Sets a buffer for the specified kernel and tag.
-  void setBuffer(String tag, Buffer buffer) {
+  ///
+  /// Pass [offset] and [size] (in bytes) to bind only part of the buffer, e.g.
+  /// to stay under the device's storage binding limit. The offset must be a
+  /// multiple of `minStorageBufferOffsetAlignment`; a size of 0 binds the rest
+  /// of the buffer.
+  void setBuffer(String tag, Buffer buffer, {int offset = 0, int size = 0}) {
     if (!_kernelTags.containsKey(tag)) {
       _kernelTags[tag] = _kernelTags.length;
     } else {
       _kernelTags[tag] = _kernelTags[tag]!;
     }
-    _shader.setBuffer(_kernelTags[tag]!, buffer.platformBuffer);
+    if (offset == 0 && size == 0) {
+      _shader.setBuffer(_kernelTags[tag]!, buffer.platformBuffer);
+    } else {
+      _shader.setBufferRange(
+          _kernelTags[tag]!, buffer.platformBuffer, offset, size);
+    }
   }
 
   /// Dispatches the specified kernel with the given work group counts.
   Future<void> dispatch(int groupsX, int groupsY, int groupsZ) async =>
       _shader.dispatch(groupsX, groupsY, groupsZ);
 
-  /// Destroys the compute shader.
-  void destroy() => _shader.destroy();
+  /// Like [dispatch], but returns as soon as the work is recorded. Dispatches
+  /// run in the order they were enqueued, buffer reads wait for the work
+  /// before them, and the shader and its buffers may be changed or destroyed
+  /// right away. Use [Minigpu.sync] to wait explicitly.
+  void enqueue(int groupsX, int groupsY, int groupsZ) =>
+      _shader.enqueue(groupsX, groupsY, groupsZ);
+
+  /// GPU execution time of the most recent dispatch in nanoseconds, measured
+  /// with timestamp queries while [Minigpu.setTimingEnabled] is on. 0 when no
+  /// timed dispatch has run or timing is unsupported.
+  int get lastGpuTimeNs => _shader.lastGpuTimeNs;
+
+  /// Destroys the compute shader. Calling this more than once has no effect.
+  void destroy() {
+    if (_destroyed) return;
+    _destroyed = true;
+    _finalizer.detach(this);
+    _shader.destroy();
+  }
 }
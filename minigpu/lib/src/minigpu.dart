@@ -1,4 +1,7 @@
+import 'dart:typed_data';
+
 import 'package:minigpu/src/buffer.dart';
+import 'package:minigpu/src/command_list.dart';
 import 'package:minigpu/src/compute_shader.dart';
 import 'package:minigpu_platform_interface/minigpu_platform_interface.dart';
 
@@ -11,37 +14,115 @@ final class Minigpu {
   static final _finalizer = Finalizer<MinigpuPlatform>(
     (platform) => platform.destroyContext(),
   );
-  static final _shaderFinalizer = Finalizer<ComputeShader>(
-    (shader) => shader.destroy(),
-  );
-  static final _bufferFinalizer = Finalizer<Buffer>(
-    (buffer) => buffer.destroy(),
-  );
 
   final _platform = MinigpuPlatform.instance;
   bool isInitialized = false;
 
   /// Initializes the minigpu context.
-  Future<void> init() async {
+  ///
+  /// With [cacheDirectory], compiled shaders and pipelines are kept on disk
+  /// (up to [cacheMaxBytes]) and reused by later processes on the same
+  /// adapter and driver. The persistent cache is native only.
+  ///
+  /// [options] selects the adapter and the features, limits and toggles the
+  /// device is created with; see [MinigpuContextOptions].
+  Future<void> init({
+    MinigpuContextOptions? options,
+    String? cacheDirectory,
+    int cacheMaxBytes = 256 * 1024 * 1024,
+  }) async {
     if (isInitialized) throw MinigpuAlreadyInitError();
 
-    await _platform.initializeContext();
+    if (cacheDirectory != null) {
+      _platform.setCacheOptions(cacheDirectory, cacheMaxBytes);
+    }
+    await _platform.initializeContext(options);
     isInitialized = true;
   }
 
-  /// Creates a compute shader.
+  /// The adapter in use, or null before [init] and on platforms that do not
+  /// report it.
+  MinigpuAdapterInfo? get adapterInfo => _platform.adapterInfo;
+
+  /// Limits granted to the device, or null when unavailable.
+  MinigpuLimits? get limits => _platform.limits;
+
+  /// Whether the device was created with [feature].
+  bool hasFeature(MinigpuFeature feature) => _platform.hasFeature(feature);
+
+  /// Whether the adapter supports timing dispatches with GPU timestamps.
+  bool get timingSupported => _platform.timingSupported;
+
+  /// Turns GPU timing of dispatches on or off. While on, each dispatch waits
+  /// for its timestamps, so leave it off outside of profiling.
+  void setTimingEnabled(bool enabled) => _platform.setTimingEnabled(enabled);
+
+  /// Compiles [kernels] on background threads and completes when they are
+  /// ready. Later dispatches of the same source reuse the compiled pipeline,
+  /// so calling this during startup removes first-dispatch compile stalls.
+  Future<void> precompile(List<String> kernels) =>
+      _platform.precompile(kernels);
+
+  /// Allocates a list of [length] floats in native memory. Passing it to
+  /// [Buffer.setData] or [Buffer.read] transfers straight from or into that
+  /// memory, skipping the staging copy (and allocation) ordinary lists need.
+  /// The memory is freed when the list is garbage collected. On the web this
+  /// is an ordinary list.
+  Float32List allocHostBuffer(int length) => _platform.allocHostBuffer(length);
+
+  /// Completes once all work from [ComputeShader.enqueue] has finished.
+  /// Buffer reads already wait for the work before them, so this is only
+  /// needed to time or fence a batch explicitly.
+  Future<void> sync() => _platform.sync();
+
+  /// Returns allocation, transfer, compile and queue-wait counters. Native
+  /// builds only.
+  MinigpuStats getStats() => _platform.getStats();
+
+  /// Clears the cumulative counters; live buffer counts are kept.
+  void resetStats() => _platform.resetStats();
+
+  /// Turns span tracing (buffer creation, uploads, compiles, dispatches and
+  /// readbacks) on or off. Native builds only.
+  void setTraceEnabled(bool enabled) => _platform.setTraceEnabled(enabled);
+
+  /// Writes the spans recorded so far to [path] as Chrome trace JSON, which
+  /// can be opened in chrome://tracing or Perfetto. Returns whether the file
+  /// was written.
+  bool dumpTrace(String path) => _platform.dumpTrace(path);
+
+  /// Drops all recorded spans.
+  void clearTrace() => _platform.clearTrace();
+
+  /// Creates a compute shader, freed by [ComputeShader.destroy] or when it is
+  /// garbage collected.
   ComputeShader createComputeShader() {
     final platformShader = _platform.createComputeShader();
-    final shader = ComputeShader(platformShader);
-    _shaderFinalizer.attach(this, shader);
-    return shader;
+    return ComputeShader(platformShader);
   }
 
   /// Creates a buffer.
+  ///
+  /// The buffer is freed when [Buffer.destroy] is called or when the returned
+  /// object is garbage collected; it is not tied to the lifetime of this
+  /// context.
   Buffer createBuffer(int bufferSize) {
     final platformBuffer = _platform.createBuffer(bufferSize);
-    final buff = Buffer(platformBuffer);
-    _bufferFinalizer.attach(this, buff);
-    return buff;
+    return Buffer(platformBuffer);
   }
+
+  /// Registers a kernel for use in [CommandList]s and returns its id. The
+  /// source is sent to the runtime once; registering it again returns the
+  /// same id. Only the [maxRegisteredKernels] most recently registered
+  /// kernels are kept, so register right before recording a list rather than
+  /// holding on to ids.
+  int registerKernel(String source) => _platform.registerKernel(source);
+
+  /// Kernels [registerKernel] keeps at once; registering another releases the
+  /// least recently registered one and its compiled pipeline.
+  static const int maxRegisteredKernels = MinigpuPlatform.maxRegisteredKernels;
+
+  /// Creates an empty [CommandList].
+  CommandList createCommandList() =>
+      CommandList(_platform.createCommandList());
 }
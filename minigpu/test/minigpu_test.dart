@@ -1,3 +1,4 @@
+import 'dart:io';
 import 'dart:typed_data';
 import 'package:minigpu/minigpu.dart';
 import 'package:test/test.dart';
@@ -38,6 +39,211 @@ void main() {
       buffer.destroy();
     });
 
+    test('lastGpuTimeNs stays 0 while timing is off', () async {
+      final shader = minigpu.createComputeShader();
+      final buffer = minigpu.createBuffer(4 * 4);
+      shader.loadKernelString('''
+@group(0) @binding(0) var<storage, read_write> out: array<f32>;
+@compute @workgroup_size(4)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
+  out[gid.x] = 1.0;
+}
+''');
+      shader.setBuffer('out', buffer);
+      minigpu.setTimingEnabled(false);
+      await shader.dispatch(1, 1, 1);
+      expect(shader.lastGpuTimeNs, equals(0));
+      shader.destroy();
+      buffer.destroy();
+    });
+
+    test('Buffer clear zeroes a byte range', () async {
+      const int n = 64;
+      final buffer = minigpu.createBuffer(n * 4);
+      buffer.setData(Float32List(n)..fillRange(0, n, 7.0), n);
+      buffer.clear(byteOffset: 16 * 4, byteSize: 16 * 4);
+      buffer.clear(byteOffset: 48 * 4);
+
+      final outputData = Float32List(n);
+      await buffer.read(outputData, n);
+      for (int i = 0; i < n; i++) {
+        final bool cleared = (i >= 16 && i < 32) || i >= 48;
+        expect(outputData[i], equals(cleared ? 0.0 : 7.0));
+      }
+      buffer.destroy();
+    });
+
+    test('Buffer destroy is idempotent', () {
+      final buffer = minigpu.createBuffer(16);
+      expect(buffer.isDestroyed, isFalse);
+      buffer.destroy();
+      buffer.destroy();
+      expect(buffer.isDestroyed, isTrue);
+    });
+
+    test('Stats track live buffers and uploaded bytes', () {
+      minigpu.resetStats();
+      final before = minigpu.getStats();
+      final buffer = minigpu.createBuffer(64);
+      buffer.setData(Float32List(16), 16);
+      final after = minigpu.getStats();
+      expect(after.liveBuffers, equals(before.liveBuffers + 1));
+      expect(after.bytesUploaded, equals(64));
+      buffer.destroy();
+      expect(minigpu.getStats().liveBuffers, equals(before.liveBuffers));
+    });
+
+    test('init with options reports adapter info and limits', () async {
+      final gpu = Minigpu();
+      await gpu.init(
+        options: const MinigpuContextOptions(
+          powerPreference: MinigpuPowerPreference.highPerformance,
+          optionalFeatures: {
+            MinigpuFeature.shaderF16,
+            MinigpuFeature.subgroups,
+            MinigpuFeature.timestampQuery,
+          },
+          useAdapterLimits: true,
+        ),
+      );
+      expect(gpu.adapterInfo, isNotNull);
+      final limits = gpu.limits!;
+      expect(limits.maxStorageBufferBindingSize, greaterThan(0));
+      expect(limits.maxComputeInvocationsPerWorkgroup,
+          greaterThanOrEqualTo(256));
+    });
+
+    test('init with a cache directory creates the cache', () async {
+      final dir = Directory.systemTemp.createTempSync('minigpu_cache');
+      final cached = Minigpu();
+      await cached.init(cacheDirectory: dir.path, cacheMaxBytes: 1 << 20);
+      expect(cached.isInitialized, isTrue);
+      expect(dir.listSync(), isNotEmpty);
+      dir.deleteSync(recursive: true);
+    });
+
+    test('Precompiled kernels hit the pipeline cache', () async {
+      const kernel = '''
+@group(0) @binding(0) var<storage, read_write> out: array<f32>;
+@compute @workgroup_size(4)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
+  out[gid.x] = 7.0;
+}
+''';
+      await minigpu.precompile([kernel]);
+      final before = minigpu.getStats();
+      final shader = minigpu.createComputeShader();
+      final buffer = minigpu.createBuffer(4 * 4);
+      shader.loadKernelString(kernel);
+      shader.setBuffer('out', buffer);
+      await shader.dispatch(1, 1, 1);
+      final after = minigpu.getStats();
+      expect(after.compiles, equals(before.compiles));
+      expect(after.pipelineCacheHits, equals(before.pipelineCacheHits + 1));
+      shader.destroy();
+      buffer.destroy();
+    });
+
+    test('Host buffers round-trip through a GPU buffer', () async {
+      const n = 1024;
+      final upload = minigpu.allocHostBuffer(n);
+      for (var i = 0; i < n; i++) {
+        upload[i] = i * 0.5;
+      }
+      final buffer = minigpu.createBuffer(n * 4);
+      buffer.setData(upload, n);
+      final download = minigpu.allocHostBuffer(n);
+      await buffer.read(download, n);
+      expect(download, equals(upload));
+      // Ordinary lists still work against the same buffer.
+      final plain = Float32List(n);
+      await buffer.read(plain, n);
+      expect(plain, equals(upload));
+      buffer.destroy();
+    });
+
+    test('Command lists upload, launch and copy in one submit', () async {
+      const kernel = '''
+@group(0) @binding(0) var<storage, read_write> inp: array<f32>;
+@group(0) @binding(1) var<storage, read_write> out: array<f32>;
+@compute @workgroup_size(4)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
+  out[gid.x] = inp[gid.x] + 10.0;
+}
+''';
+      final id = minigpu.registerKernel(kernel);
+      expect(minigpu.registerKernel(kernel), equals(id));
+      final inp = minigpu.createBuffer(4 * 4);
+      final out = minigpu.createBuffer(4 * 4);
+      final copy = minigpu.createBuffer(4 * 4);
+      final list = minigpu.createCommandList()
+        ..upload(inp, Float32List.fromList([1, 2, 3, 4]))
+        ..bind(id, 0, inp)
+        ..bind(id, 1, out)
+        ..dispatch(id, 1)
+        ..copy(out, copy, 4 * 4);
+      list.submit();
+      final result = Float32List(4);
+      await copy.read(result, 4);
+      expect(result, equals(Float32List.fromList([11, 12, 13, 14])));
+      list.destroy();
+      inp.destroy();
+      out.destroy();
+      copy.destroy();
+    });
+
+    test('Registered kernels are bounded and evicted oldest first', () async {
+      String kernel(int i) => '''
+@group(0) @binding(0) var<storage, read_write> out: array<f32>;
+@compute @workgroup_size(1)
+fn main() {
+  out[0] = $i.0;
+}
+''';
+      final first = minigpu.registerKernel(kernel(0));
+      var last = first;
+      for (var i = 1; i <= Minigpu.maxRegisteredKernels; i++) {
+        last = minigpu.registerKernel(kernel(i));
+      }
+      // The first kernel was released, so it comes back under a new id.
+      expect(minigpu.registerKernel(kernel(0)), isNot(equals(first)));
+      final out = minigpu.createBuffer(4);
+      final list = minigpu.createCommandList()
+        ..bind(last, 0, out)
+        ..dispatch(last, 1);
+      list.submit();
+      final result = Float32List(1);
+      await out.read(result, 1);
+      expect(result[0], equals(Minigpu.maxRegisteredKernels.toDouble()));
+      list.destroy();
+      out.destroy();
+    });
+
+    test('Enqueued dispatches run in order before a read', () async {
+      const kernel = '''
+@group(0) @binding(0) var<storage, read_write> acc: array<f32>;
+@compute @workgroup_size(4)
+fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
+  acc[gid.x] = acc[gid.x] * 2.0 + 1.0;
+}
+''';
+      final buffer = minigpu.createBuffer(4 * 4);
+      buffer.setData(Float32List(4), 4);
+      final shader = minigpu.createComputeShader();
+      shader.loadKernelString(kernel);
+      shader.setBuffer('acc', buffer);
+      for (var i = 0; i < 10; i++) {
+        shader.enqueue(1, 1, 1);
+      }
+      shader.destroy();
+      final out = Float32List(4);
+      await buffer.read(out, 4);
+      // x -> 2x + 1 applied ten times from 0 gives 2^10 - 1.
+      expect(out, equals(Float32List.fromList([1023, 1023, 1023, 1023])));
+      await minigpu.sync();
+      buffer.destroy();
+    });
+
     test('Compute Shader: adds 0.2 to each element', () async {
       const int numFloats = 100;
       final int memorySize = numFloats * 4;
@@ -1,6 +1,7 @@
 // ignore_for_file: omit_local_variable_types
 
 import 'dart:async';
+import 'dart:convert';
 import 'dart:ffi';
 import 'dart:typed_data';
 
@@ -13,12 +14,26 @@ typedef ReadAsyncCallback = Pointer<NativeFunction<ReadAsyncCallbackFunc>>;
 
 MinigpuPlatform registeredInstance() => MinigpuFfi();
 
+// Native address of every list returned by allocHostBuffer, so transfers can
+// hand it to the runtime directly instead of copying through malloc.
+final _hostBuffers = Expando<Pointer<Float>>();
+
+final _freeHostBuffer =
+    Native.addressOf<NativeFunction<Void Function(Pointer<Void>)>>(
+        ffi.mgpuFreeHostBuffer);
+
 // Minigpu FFI
 class MinigpuFfi extends MinigpuPlatform {
   MinigpuFfi();
 
   @override
-  Future<void> initializeContext() async {
+  Future<void> initializeContext([MinigpuContextOptions? options]) async {
+    // The runtime drops the old context's kernels when it replaces it.
+    _kernelIds.clear();
+    if (options != null) {
+      _initializeContextWithOptions(options);
+      return;
+    }
     final completer = Completer<void>();
 
     void nativeCallback() {
@@ -34,11 +49,110 @@ class MinigpuFfi extends MinigpuPlatform {
     nativeCallable.close();
   }
 
+  void _initializeContextWithOptions(MinigpuContextOptions options) {
+    final native = calloc<ffi.MGPUContextOptions>();
+    final strings = <Pointer<Utf8>>[];
+    Pointer<Pointer<Char>> toggleList(List<String> names) {
+      final list = calloc<Pointer<Char>>(names.length);
+      for (var i = 0; i < names.length; i++) {
+        final name = names[i].toNativeUtf8();
+        strings.add(name);
+        list[i] = name.cast();
+      }
+      return list;
+    }
+
+    int featureBits(Set<MinigpuFeature> features) =>
+        features.fold(0, (bits, feature) => bits | feature.bit);
+
+    try {
+      ffi.mgpuGetDefaultContextOptions(native);
+      final o = native.ref;
+      o.powerPreference = options.powerPreference.index;
+      o.requiredFeatures = featureBits(options.requiredFeatures);
+      o.optionalFeatures = featureBits(options.optionalFeatures);
+      o.useAdapterLimits = options.useAdapterLimits ? 1 : 0;
+      o.maxStorageBufferBindingSize = options.maxStorageBufferBindingSize;
+      o.maxBufferSize = options.maxBufferSize;
+      o.skipValidation = options.skipValidation ? 1 : 0;
+      o.enabledToggles = toggleList(options.enabledToggles);
+      o.enabledToggleCount = options.enabledToggles.length;
+      o.disabledToggles = toggleList(options.disabledToggles);
+      o.disabledToggleCount = options.disabledToggles.length;
+      if (ffi.mgpuInitializeContextWithOptions(native) == 0) {
+        throw Exception(
+            "Failed to create a GPU context with the requested options.");
+      }
+    } finally {
+      calloc.free(native.ref.enabledToggles);
+      calloc.free(native.ref.disabledToggles);
+      strings.forEach(malloc.free);
+      calloc.free(native);
+    }
+  }
+
   @override
   void destroyContext() {
+    _kernelIds.clear();
     ffi.mgpuDestroyContext();
   }
 
+  @override
+  MinigpuAdapterInfo? get adapterInfo {
+    final info = calloc<ffi.MGPUAdapterInfo>();
+    String read(Array<Char> chars, int capacity) {
+      final codes = <int>[];
+      for (var i = 0; i < capacity && chars[i] != 0; i++) {
+        codes.add(chars[i] & 0xff);
+      }
+      return utf8.decode(codes, allowMalformed: true);
+    }
+
+    try {
+      if (ffi.mgpuGetAdapterInfo(info) == 0) return null;
+      final i = info.ref;
+      return MinigpuAdapterInfo(
+        vendor: read(i.vendor, 128),
+        architecture: read(i.architecture, 128),
+        device: read(i.device, 128),
+        description: read(i.description, 256),
+        backendType: i.backendType,
+        adapterType: i.adapterType,
+        vendorId: i.vendorID,
+        deviceId: i.deviceID,
+      );
+    } finally {
+      calloc.free(info);
+    }
+  }
+
+  @override
+  MinigpuLimits? get limits {
+    final limits = calloc<ffi.MGPULimits>();
+    try {
+      if (ffi.mgpuGetLimits(limits) == 0) return null;
+      final l = limits.ref;
+      return MinigpuLimits(
+        maxBufferSize: l.maxBufferSize,
+        maxStorageBufferBindingSize: l.maxStorageBufferBindingSize,
+        maxStorageBuffersPerShaderStage: l.maxStorageBuffersPerShaderStage,
+        maxComputeWorkgroupStorageSize: l.maxComputeWorkgroupStorageSize,
+        maxComputeInvocationsPerWorkgroup: l.maxComputeInvocationsPerWorkgroup,
+        maxComputeWorkgroupSizeX: l.maxComputeWorkgroupSizeX,
+        maxComputeWorkgroupSizeY: l.maxComputeWorkgroupSizeY,
+        maxComputeWorkgroupSizeZ: l.maxComputeWorkgroupSizeZ,
+        maxComputeWorkgroupsPerDimension: l.maxComputeWorkgroupsPerDimension,
+        minStorageBufferOffsetAlignment: l.minStorageBufferOffsetAlignment,
+      );
+    } finally {
+      calloc.free(limits);
+    }
+  }
+
+  @override
+  bool hasFeature(MinigpuFeature feature) =>
+      ffi.mgpuHasFeature(feature.bit) != 0;
+
   @override
   PlatformComputeShader createComputeShader() {
     final self = ffi.mgpuCreateComputeShader();
@@ -52,6 +166,156 @@ class MinigpuFfi extends MinigpuPlatform {
     if (self == nullptr) throw MinigpuPlatformOutOfMemoryException();
     return FfiBuffer(self);
   }
+
+  @override
+  bool get timingSupported => ffi.mgpuTimingSupported() != 0;
+
+  @override
+  void setTimingEnabled(bool enabled) {
+    ffi.mgpuSetTimingEnabled(enabled ? 1 : 0);
+  }
+
+  @override
+  bool setCacheOptions(String directory, int maxBytes) {
+    final dirPtr = directory.toNativeUtf8();
+    try {
+      return ffi.mgpuSetCacheOptions(dirPtr.cast(), maxBytes) != 0;
+    } finally {
+      malloc.free(dirPtr);
+    }
+  }
+
+  @override
+  Future<void> precompile(List<String> kernels) async {
+    if (kernels.isEmpty) return;
+    final completer = Completer<void>();
+
+    void nativeCallback() {
+      completer.complete();
+    }
+
+    final nativeCallable =
+        NativeCallable<Void Function()>.listener(nativeCallback);
+    final kernelPtrs = malloc<Pointer<Char>>(kernels.length);
+    try {
+      for (var i = 0; i < kernels.length; i++) {
+        kernelPtrs[i] = kernels[i].toNativeUtf8().cast();
+      }
+      // The sources are copied before mgpuPrecompile returns.
+      ffi.mgpuPrecompile(
+          kernelPtrs, kernels.length, nativeCallable.nativeFunction);
+    } finally {
+      for (var i = 0; i < kernels.length; i++) {
+        malloc.free(kernelPtrs[i]);
+      }
+      malloc.free(kernelPtrs);
+    }
+
+    await completer.future;
+    nativeCallable.close();
+  }
+
+  // Ids of registered kernels, least recently used first, so repeat
+  // registrations skip the UTF-8 encoding and the native call. Cleared with
+  // the context.
+  final Map<String, int> _kernelIds = {};
+
+  @override
+  int registerKernel(String source) {
+    final cached = _kernelIds.remove(source);
+    if (cached != null) return _kernelIds[source] = cached;
+    if (_kernelIds.length >= MinigpuPlatform.maxRegisteredKernels) {
+      // Release before registering, so the native registry never has to
+      // evict an id this map still hands out.
+      ffi.mgpuReleaseKernel(_kernelIds.remove(_kernelIds.keys.first)!);
+    }
+    final sourcePtr = source.toNativeUtf8();
+    try {
+      final id = ffi.mgpuRegisterKernel(sourcePtr.cast());
+      if (id < 0) throw ArgumentError.value(source, 'source', 'Invalid kernel');
+      return _kernelIds[source] = id;
+    } finally {
+      malloc.free(sourcePtr);
+    }
+  }
+
+  @override
+  PlatformCommandList createCommandList() => FfiCommandList();
+
+  @override
+  Float32List allocHostBuffer(int length) {
+    final ptr = ffi.mgpuAllocHostBuffer(length * sizeOf<Float>());
+    if (ptr == nullptr) throw MinigpuPlatformOutOfMemoryException();
+    // The memory is freed once the list is garbage collected.
+    final list =
+        ptr.asTypedList(length, finalizer: _freeHostBuffer, token: ptr.cast());
+    _hostBuffers[list] = ptr;
+    return list;
+  }
+
+  @override
+  Future<void> sync() async {
+    final completer = Completer<void>();
+
+    void nativeCallback() {
+      completer.complete();
+    }
+
+    final nativeCallable =
+        NativeCallable<Void Function()>.listener(nativeCallback);
+    ffi.mgpuSyncAsync(nativeCallable.nativeFunction);
+    await completer.future;
+    nativeCallable.close();
+  }
+
+  @override
+  MinigpuStats getStats() {
+    final stats = calloc<ffi.MGPUStats>();
+    try {
+      ffi.mgpuGetStats(stats);
+      final s = stats.ref;
+      return MinigpuStats(
+        liveBuffers: s.liveBuffers,
+        liveBytes: s.liveBytes,
+        peakBytes: s.peakBytes,
+        bytesUploaded: s.bytesUploaded,
+        bytesDownloaded: s.bytesDownloaded,
+        dispatches: s.dispatches,
+        compiles: s.compiles,
+        compileNs: s.compileNs,
+        pipelineCacheHits: s.pipelineCacheHits,
+        queueWaits: s.queueWaits,
+        queueWaitNs: s.queueWaitNs,
+      );
+    } finally {
+      calloc.free(stats);
+    }
+  }
+
+  @override
+  void resetStats() {
+    ffi.mgpuResetStats();
+  }
+
+  @override
+  void setTraceEnabled(bool enabled) {
+    ffi.mgpuSetTraceEnabled(enabled ? 1 : 0);
+  }
+
+  @override
+  bool dumpTrace(String path) {
+    final pathPtr = path.toNativeUtf8();
+    try {
+      return ffi.mgpuDumpTrace(pathPtr.cast()) != 0;
+    } finally {
+      malloc.free(pathPtr);
+    }
+  }
+
+  @override
+  void clearTrace() {
+    ffi.mgpuClearTrace();
+  }
 }
 
 // Compute shader FFI
@@ -82,6 +346,17 @@ final class FfiComputeShader implements PlatformComputeShader {
     } finally {}
   }
 
+  @override
+  void setBufferRange(int tag, PlatformBuffer buffer, int offset, int size) {
+    ffi.mgpuSetBufferRange(
+        _self, tag, (buffer as FfiBuffer)._self, offset, size);
+  }
+
+  @override
+  void enqueue(int groupsX, int groupsY, int groupsZ) {
+    ffi.mgpuEnqueueDispatch(_self, groupsX, groupsY, groupsZ);
+  }
+
   @override
   Future<void> dispatch(int groupsX, int groupsY, int groupsZ) async {
     try {
@@ -100,6 +375,9 @@ final class FfiComputeShader implements PlatformComputeShader {
     } finally {}
   }
 
+  @override
+  int get lastGpuTimeNs => ffi.mgpuGetShaderLastGpuTimeNs(_self);
+
   @override
   void destroy() {
     ffi.mgpuDestroyComputeShader(_self);
@@ -107,6 +385,124 @@ final class FfiComputeShader implements PlatformComputeShader {
 }
 
 // Buffer FFI
+/// Packs commands into a native MGPUCommand array that is executed with a
+/// single mgpuExecuteCommands call. The array is kept and reused across
+/// submits.
+final class FfiCommandList implements PlatformCommandList {
+  Pointer<ffi.MGPUCommand> _commands = calloc<ffi.MGPUCommand>(_initialCapacity);
+  int _capacity = _initialCapacity;
+  int _length = 0;
+
+  // Upload sources that must stay valid until submit: native copies of
+  // ordinary lists (freed after submit) and host buffers (kept reachable).
+  final List<Pointer<Float>> _staging = [];
+  final List<Float32List> _pinned = [];
+
+  static const _initialCapacity = 16;
+
+  ffi.MGPUCommand _next(int type) {
+    if (_length == _capacity) {
+      final grown = calloc<ffi.MGPUCommand>(_capacity * 2);
+      final bytes = _capacity * sizeOf<ffi.MGPUCommand>();
+      grown.cast<Uint8>().asTypedList(bytes).setAll(
+          0, _commands.cast<Uint8>().asTypedList(bytes));
+      calloc.free(_commands);
+      _commands = grown;
+      _capacity *= 2;
+    }
+    final command = _commands[_length++]
+      ..type = type
+      ..kernel = -1
+      ..binding = 0
+      ..buffer = nullptr
+      ..target = nullptr
+      ..offset = 0
+      ..targetOffset = 0
+      ..size = 0
+      ..data = nullptr;
+    for (var i = 0; i < 3; i++) {
+      command.groups[i] = 1;
+    }
+    return command;
+  }
+
+  @override
+  void bind(
+      int kernel, int binding, PlatformBuffer buffer, int offset, int size) {
+    _next(ffi.MGPUCommandType.MGPU_COMMAND_BIND)
+      ..kernel = kernel
+      ..binding = binding
+      ..buffer = (buffer as FfiBuffer)._self
+      ..offset = offset
+      ..size = size;
+  }
+
+  @override
+  void dispatch(int kernel, int groupsX, int groupsY, int groupsZ) {
+    final command = _next(ffi.MGPUCommandType.MGPU_COMMAND_DISPATCH)
+      ..kernel = kernel;
+    command.groups[0] = groupsX;
+    command.groups[1] = groupsY;
+    command.groups[2] = groupsZ;
+  }
+
+  @override
+  void copy(PlatformBuffer source, int sourceOffset, PlatformBuffer target,
+      int targetOffset, int size) {
+    _next(ffi.MGPUCommandType.MGPU_COMMAND_COPY)
+      ..buffer = (source as FfiBuffer)._self
+      ..offset = sourceOffset
+      ..target = (target as FfiBuffer)._self
+      ..targetOffset = targetOffset
+      ..size = size;
+  }
+
+  @override
+  void upload(PlatformBuffer buffer, int offset, Float32List data) {
+    Pointer<Float>? dataPtr = _hostBuffers[data];
+    if (dataPtr != null) {
+      _pinned.add(data);
+    } else {
+      dataPtr = malloc.allocate<Float>(data.lengthInBytes);
+      dataPtr.asTypedList(data.length).setAll(0, data);
+      _staging.add(dataPtr);
+    }
+    _next(ffi.MGPUCommandType.MGPU_COMMAND_UPLOAD)
+      ..buffer = (buffer as FfiBuffer)._self
+      ..offset = offset
+      ..size = data.lengthInBytes
+      ..data = dataPtr.cast();
+  }
+
+  @override
+  void submit() {
+    if (_length == 0) return;
+    final executed = ffi.mgpuExecuteCommands(_commands, _length);
+    final count = _length;
+    _length = 0;
+    for (final ptr in _staging) {
+      malloc.free(ptr);
+    }
+    _staging.clear();
+    _pinned.clear();
+    if (executed != count) {
+      throw StateError('Command $executed of $count failed to execute');
+    }
+  }
+
+  @override
+  void destroy() {
+    for (final ptr in _staging) {
+      malloc.free(ptr);
+    }
+    _staging.clear();
+    _pinned.clear();
+    calloc.free(_commands);
+    _commands = nullptr;
+    _length = 0;
+  }
+}
+
 final class FfiBuffer implements PlatformBuffer {
   FfiBuffer(Pointer<ffi.MGPUBuffer> self) : _self = self;
 
@@ -135,8 +531,11 @@ final class FfiBuffer implements PlatformBuffer {
     // byteSize in bytes to pass to the native function.
     final int byteSize = sizeToRead * sizeOf<Float>();
 
-    // Allocate a temporary native Float array to receive the data.
-    final Pointer<Float> outputPtr = malloc.allocate<Float>(byteSize);
+    // Read straight into host buffers; anything else goes through a
+    // temporary native Float array.
+    final Pointer<Float>? hostPtr = _hostBuffers[outputData];
+    final Pointer<Float> outputPtr =
+        hostPtr ?? malloc.allocate<Float>(byteSize);
 
     // Create a completer that will be completed when the native callback fires.
     final completer = Completer<void>();
@@ -162,15 +561,19 @@ final class FfiBuffer implements PlatformBuffer {
 
     // Wait until the callback signals that the data is ready.
     await completer.future;
+    nativeCallable.close();
+
+    // outputData is used past the await on both paths, which keeps a host
+    // buffer from being finalized while the native side writes into it.
+    if (_hostBuffers[outputData] != null) return;
 
     // Convert the native memory to a Dart typed list.
     final List<double> readData = outputPtr.asTypedList(sizeToRead);
     // Write into the outputData starting at index zero.
     outputData.setAll(0, readData);
 
-    // Free the allocated native memory and close the native callback.
+    // Free the allocated native memory.
     malloc.free(outputPtr);
-    nativeCallable.close();
 
     return;
   }
@@ -178,6 +581,11 @@ final class FfiBuffer implements PlatformBuffer {
   @override
   void setData(Float32List inputData, int size) {
     int elementCount = inputData.length;
+    final Pointer<Float>? hostPtr = _hostBuffers[inputData];
+    if (hostPtr != null) {
+      ffi.mgpuSetBufferData(_self, hostPtr, elementCount * sizeOf<Float>());
+      return;
+    }
     final inputPtr = malloc.allocate<Float>(elementCount * sizeOf<Float>());
     final inputTypedList = inputPtr.asTypedList(elementCount);
     inputTypedList.setAll(0, inputData);
@@ -185,6 +593,11 @@ final class FfiBuffer implements PlatformBuffer {
     malloc.free(inputPtr);
   }
 
+  @override
+  void clear({int byteOffset = 0, int byteSize = 0}) {
+    ffi.mgpuClearBuffer(_self, byteOffset, byteSize);
+  }
+
   @override
   void destroy() {
     ffi.mgpuDestroyBuffer(_self);
@@ -43,7 +43,7 @@ external int mgpuHasKernel(
   ffi.Pointer<MGPUComputeShader> shader,
 );
 
-@ffi.Native<ffi.Pointer<MGPUBuffer> Function(ffi.Int)>()
+@ffi.Native<ffi.Pointer<MGPUBuffer> Function(ffi.Size)>()
 external ffi.Pointer<MGPUBuffer> mgpuCreateBuffer(
   int bufferSize,
 );
@@ -62,6 +62,17 @@ external void mgpuSetBuffer(
   ffi.Pointer<MGPUBuffer> buffer,
 );
 
+@ffi.Native<
+    ffi.Void Function(ffi.Pointer<MGPUComputeShader>, ffi.Int,
+        ffi.Pointer<MGPUBuffer>, ffi.Size, ffi.Size)>()
+external void mgpuSetBufferRange(
+  ffi.Pointer<MGPUComputeShader> shader,
+  int tag,
+  ffi.Pointer<MGPUBuffer> buffer,
+  int offset,
+  int size,
+);
+
 @ffi.Native<
     ffi.Void Function(
         ffi.Pointer<MGPUComputeShader>, ffi.Int, ffi.Int, ffi.Int)>()
@@ -83,6 +94,27 @@ external void mgpuDispatchAsync(
   MGPUCallback callback,
 );
 
+@ffi.Native<
+    ffi.Void Function(
+        ffi.Pointer<MGPUComputeShader>, ffi.Int, ffi.Int, ffi.Int)>()
+external void mgpuEnqueueDispatch(
+  ffi.Pointer<MGPUComputeShader> shader,
+  int groupsX,
+  int groupsY,
+  int groupsZ,
+);
+
+@ffi.Native<ffi.Void Function()>()
+external void mgpuFlush();
+
+@ffi.Native<ffi.Void Function()>()
+external void mgpuSync();
+
+@ffi.Native<ffi.Void Function(MGPUCallback)>()
+external void mgpuSyncAsync(
+  MGPUCallback callback,
+);
+
 @ffi.Native<
     ffi.Void Function(
         ffi.Pointer<MGPUBuffer>, ffi.Pointer<ffi.Float>, ffi.Size, ffi.Size)>()
@@ -113,10 +145,321 @@ external void mgpuSetBufferData(
   int byteSize,
 );
 
+@ffi.Native<ffi.Void Function(ffi.Pointer<MGPUBuffer>, ffi.Size, ffi.Size)>()
+external void mgpuClearBuffer(
+  ffi.Pointer<MGPUBuffer> buffer,
+  int offset,
+  int byteSize,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<ffi.Char>)>()
+external int mgpuRegisterKernel(
+  ffi.Pointer<ffi.Char> kernelString,
+);
+
+@ffi.Native<ffi.Void Function(ffi.Int)>()
+external void mgpuReleaseKernel(
+  int kernel,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPUCommand>, ffi.Int)>()
+external int mgpuExecuteCommands(
+  ffi.Pointer<MGPUCommand> commands,
+  int count,
+);
+
+@ffi.Native<ffi.Pointer<ffi.Float> Function(ffi.Size)>()
+external ffi.Pointer<ffi.Float> mgpuAllocHostBuffer(
+  int byteSize,
+);
+
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>)>()
+external void mgpuFreeHostBuffer(
+  ffi.Pointer<ffi.Void> ptr,
+);
+
+@ffi.Native<ffi.Int Function()>()
+external int mgpuTimingSupported();
+
+@ffi.Native<ffi.Void Function(ffi.Int)>()
+external void mgpuSetTimingEnabled(
+  int enabled,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPUDispatchTiming>)>()
+external int mgpuGetLastDispatchTiming(
+  ffi.Pointer<MGPUDispatchTiming> timing,
+);
+
+@ffi.Native<ffi.Uint64 Function(ffi.Pointer<MGPUComputeShader>)>()
+external int mgpuGetShaderLastGpuTimeNs(
+  ffi.Pointer<MGPUComputeShader> shader,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPUKernelTimingStats>, ffi.Int)>()
+external int mgpuGetKernelTimingStats(
+  ffi.Pointer<MGPUKernelTimingStats> stats,
+  int capacity,
+);
+
+@ffi.Native<ffi.Void Function()>()
+external void mgpuResetTimingStats();
+
+@ffi.Native<ffi.Void Function(ffi.Pointer<MGPUContextOptions>)>()
+external void mgpuGetDefaultContextOptions(
+  ffi.Pointer<MGPUContextOptions> options,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPUContextOptions>)>()
+external int mgpuInitializeContextWithOptions(
+  ffi.Pointer<MGPUContextOptions> options,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPUAdapterInfo>)>()
+external int mgpuGetAdapterInfo(
+  ffi.Pointer<MGPUAdapterInfo> info,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<MGPULimits>)>()
+external int mgpuGetLimits(
+  ffi.Pointer<MGPULimits> limits,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Int)>()
+external int mgpuHasFeature(
+  int feature,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<ffi.Char>, ffi.Uint64)>()
+external int mgpuSetCacheOptions(
+  ffi.Pointer<ffi.Char> dir,
+  int maxBytes,
+);
+
+@ffi.Native<
+    ffi.Void Function(
+        ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Int, MGPUCallback)>()
+external void mgpuPrecompile(
+  ffi.Pointer<ffi.Pointer<ffi.Char>> kernels,
+  int count,
+  MGPUCallback callback,
+);
+
+@ffi.Native<ffi.Void Function(ffi.Pointer<MGPUStats>)>()
+external void mgpuGetStats(
+  ffi.Pointer<MGPUStats> stats,
+);
+
+@ffi.Native<ffi.Void Function()>()
+external void mgpuResetStats();
+
+@ffi.Native<ffi.Void Function(ffi.Int)>()
+external void mgpuSetTraceEnabled(
+  int enabled,
+);
+
+@ffi.Native<ffi.Int Function(ffi.Pointer<ffi.Char>)>()
+external int mgpuDumpTrace(
+  ffi.Pointer<ffi.Char> path,
+);
+
+@ffi.Native<ffi.Void Function()>()
+external void mgpuClearTrace();
+
 final class MGPUComputeShader extends ffi.Opaque {}
 
 final class MGPUBuffer extends ffi.Opaque {}
 
+final class MGPUDispatchTiming extends ffi.Struct {
+  @ffi.Uint64()
+  external int kernelHash;
+
+  @ffi.Uint64()
+  external int gpuNs;
+
+  @ffi.Uint64()
+  external int hostNs;
+}
+
+final class MGPUKernelTimingStats extends ffi.Struct {
+  @ffi.Uint64()
+  external int kernelHash;
+
+  @ffi.Uint64()
+  external int count;
+
+  @ffi.Double()
+  external double meanNs;
+
+  @ffi.Double()
+  external double p99Ns;
+}
+
+final class MGPUContextOptions extends ffi.Struct {
+  @ffi.Int()
+  external int powerPreference;
+
+  @ffi.Uint32()
+  external int requiredFeatures;
+
+  @ffi.Uint32()
+  external int optionalFeatures;
+
+  @ffi.Int()
+  external int useAdapterLimits;
+
+  @ffi.Uint64()
+  external int maxStorageBufferBindingSize;
+
+  @ffi.Uint64()
+  external int maxBufferSize;
+
+  @ffi.Int()
+  external int skipValidation;
+
+  external ffi.Pointer<ffi.Pointer<ffi.Char>> enabledToggles;
+
+  @ffi.Int()
+  external int enabledToggleCount;
+
+  external ffi.Pointer<ffi.Pointer<ffi.Char>> disabledToggles;
+
+  @ffi.Int()
+  external int disabledToggleCount;
+}
+
+final class MGPUAdapterInfo extends ffi.Struct {
+  @ffi.Array.multi([128])
+  external ffi.Array<ffi.Char> vendor;
+
+  @ffi.Array.multi([128])
+  external ffi.Array<ffi.Char> architecture;
+
+  @ffi.Array.multi([128])
+  external ffi.Array<ffi.Char> device;
+
+  @ffi.Array.multi([256])
+  external ffi.Array<ffi.Char> description;
+
+  @ffi.Int()
+  external int backendType;
+
+  @ffi.Int()
+  external int adapterType;
+
+  @ffi.Uint32()
+  external int vendorID;
+
+  @ffi.Uint32()
+  external int deviceID;
+}
+
+final class MGPULimits extends ffi.Struct {
+  @ffi.Uint64()
+  external int maxBufferSize;
+
+  @ffi.Uint64()
+  external int maxStorageBufferBindingSize;
+
+  @ffi.Uint32()
+  external int maxStorageBuffersPerShaderStage;
+
+  @ffi.Uint32()
+  external int maxComputeWorkgroupStorageSize;
+
+  @ffi.Uint32()
+  external int maxComputeInvocationsPerWorkgroup;
+
+  @ffi.Uint32()
+  external int maxComputeWorkgroupSizeX;
+
+  @ffi.Uint32()
+  external int maxComputeWorkgroupSizeY;
+
+  @ffi.Uint32()
+  external int maxComputeWorkgroupSizeZ;
+
+  @ffi.Uint32()
+  external int maxComputeWorkgroupsPerDimension;
+
+  @ffi.Uint32()
+  external int minStorageBufferOffsetAlignment;
+}
+
+final class MGPUStats extends ffi.Struct {
+  @ffi.Uint64()
+  external int liveBuffers;
+
+  @ffi.Uint64()
+  external int liveBytes;
+
+  @ffi.Uint64()
+  external int peakBytes;
+
+  @ffi.Uint64()
+  external int bytesUploaded;
+
+  @ffi.Uint64()
+  external int bytesDownloaded;
+
+  @ffi.Uint64()
+  external int dispatches;
+
+  @ffi.Uint64()
+  external int compiles;
+
+  @ffi.Uint64()
+  external int compileNs;
+
+  @ffi.Uint64()
+  external int pipelineCacheHits;
+
+  @ffi.Uint64()
+  external int queueWaits;
+
+  @ffi.Uint64()
+  external int queueWaitNs;
+
+  @ffi.Double()
+  external double avgQueueWaitNs;
+}
+
+abstract class MGPUCommandType {
+  static const int MGPU_COMMAND_BIND = 0;
+  static const int MGPU_COMMAND_DISPATCH = 1;
+  static const int MGPU_COMMAND_COPY = 2;
+  static const int MGPU_COMMAND_UPLOAD = 3;
+}
+
+final class MGPUCommand extends ffi.Struct {
+  @ffi.Uint32()
+  external int type;
+
+  @ffi.Int32()
+  external int kernel;
+
+  @ffi.Uint32()
+  external int binding;
+
+  @ffi.Array(3)
+  external ffi.Array<ffi.Uint32> groups;
+
+  external ffi.Pointer<MGPUBuffer> buffer;
+
+  external ffi.Pointer<MGPUBuffer> target;
+
+  @ffi.Uint64()
+  external int offset;
+
+  @ffi.Uint64()
+  external int targetOffset;
+
+  @ffi.Uint64()
+  external int size;
+
+  external ffi.Pointer<ffi.Void> data;
+}
+
 typedef MGPUCallbackFunction = ffi.Void Function();
 typedef DartMGPUCallbackFunction = void Function();
 typedef MGPUCallback = ffi.Pointer<ffi.NativeFunction<MGPUCallbackFunction>>;
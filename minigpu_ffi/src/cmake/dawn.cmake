@@ -117,6 +117,32 @@ if(NOT DAWN_BUILD_FOUND)
   set(DAWN_BUILD_FOUND ON)
 endif()  # End pre-build Dawn
 
+# Identify the Dawn build for the persistent pipeline cache (see
+# include/disk_cache.h). DAWN_COMMIT is only set when Dawn is fetched above,
+# so ask the checkout, or hash a prebuilt library that has none.
+set(DAWN_VERSION_ID "")
+if(EXISTS "${DAWN_DIR}/.git")
+  execute_process(
+    COMMAND git rev-parse HEAD
+    WORKING_DIRECTORY "${DAWN_DIR}"
+    OUTPUT_VARIABLE DAWN_VERSION_ID
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET
+  )
+endif()
+if(NOT DAWN_VERSION_ID)
+  foreach(DAWN_LIB_FILE IN ITEMS "${WEBGPU_DAWN_LIB}" "${WEBGPU_DAWN_RELEASE}" "${WEBGPU_DAWN_DEBUG}")
+    if(DAWN_LIB_FILE AND EXISTS "${DAWN_LIB_FILE}")
+      file(SHA256 "${DAWN_LIB_FILE}" DAWN_VERSION_ID)
+      break()
+    endif()
+  endforeach()
+endif()
+if(NOT DAWN_VERSION_ID AND DEFINED DAWN_COMMIT)
+  set(DAWN_VERSION_ID "${DAWN_COMMIT}")
+endif()
+message(STATUS "Dawn version id: ${DAWN_VERSION_ID}")
+
 # Create an IMPORTED target for the Dawn library.
 # Adjust the expected output name/extension per platform.
 if(MSVC)
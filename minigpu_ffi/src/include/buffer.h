@@ -1,33 +1,142 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 
+#include "disk_cache.h"
 #include "gpuh.h"
+#include "pipeline_cache.h"
+#include "timing.h"
 #include <fstream>
 #include <future>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace mgpu {
+
+// How the adapter and device are chosen. Required features fail context
+// creation when missing; optional ones are enabled only if the adapter has
+// them. Limits left at 0 keep the WebGPU defaults.
+struct ContextOptions {
+  WGPUPowerPreference powerPreference = WGPUPowerPreference_Undefined;
+  std::vector<WGPUFeatureName> requiredFeatures;
+  std::vector<WGPUFeatureName> optionalFeatures = {
+      WGPUFeatureName_TimestampQuery};
+  // Requests every limit at the adapter's maximum.
+  bool useAdapterLimits = false;
+  uint64_t maxStorageBufferBindingSize = 0;
+  uint64_t maxBufferSize = 0;
+  // Dawn toggles, e.g. "skip_validation". Ignored on the web.
+  std::vector<std::string> enabledToggles;
+  std::vector<std::string> disabledToggles;
+};
+
+struct AdapterInfo {
+  std::string vendor;
+  std::string architecture;
+  std::string device;
+  std::string description;
+  WGPUBackendType backendType = WGPUBackendType_Undefined;
+  WGPUAdapterType adapterType = WGPUAdapterType_Unknown;
+  uint32_t vendorID = 0;
+  uint32_t deviceID = 0;
+};
+
 class MGPU {
 public:
-  void initializeContext();
+  void initializeContext() { initializeContext(ContextOptions{}); }
+  // Returns false if no adapter matches or a required feature is missing.
+  bool initializeContext(const ContextOptions &options);
   void initializeContextAsync(std::function<void()> callback);
   void destroyContext();
 
   gpu::Context &getContext() { return *ctx; }
+  bool hasContext() const { return ctx != nullptr; }
+
+  // Whether the device was created with feature.
+  bool hasFeature(WGPUFeatureName feature) const {
+    return ctx && wgpuDeviceHasFeature(ctx->device, feature);
+  }
+  AdapterInfo adapterInfo() const;
+  // Limits granted to the device.
+  WGPULimits limits() const;
+  // Cached from the device limits; used to fold large 1D grids.
+  uint32_t maxWorkgroupsPerDimension() const { return maxWorkgroups; }
+
+  // Timestamp-query timing of dispatches. Only available when the adapter
+  // exposes the timestamp-query feature; off until enabled.
+  bool timestampsSupported() const { return timestampFeature; }
+  bool timingActive() const { return timestampFeature && timingEnabled; }
+  void setTimingEnabled(bool enabled) { timingEnabled = enabled; }
+
+  // Query set with two slots (pass begin/end) and the buffer its values are
+  // resolved into. Created on first use; guarded by timingMutex.
+  WGPUQuerySet timestampQuerySet();
+  WGPUBuffer timestampResolveBuffer() const { return queryResolve; }
+  std::mutex timingMutex;
+  TimingRegistry timings;
+
+  // Compiled pipelines for this device, shared by every ComputeShader.
+  PipelineCache pipelines;
+
+  // Persistent blob cache handed to Dawn. Configure it before
+  // initializeContext; it only applies to devices created afterwards.
+  DiskCache diskCache;
+
+  // Command stream shared by every ComputeShader. Dispatches are recorded
+  // into one command encoder and submitted together by flush(), which runs
+  // once kMaxPendingPasses are recorded and before anything else touches
+  // the queue (reads, timed dispatches, uploads to a buffer a recorded pass
+  // touches). The queue executes in submission order and every recorded
+  // pass holds references to its buffers, so buffers may be rewritten or
+  // released as soon as the host is done with them. uses lists every buffer
+  // the recorded pass touches.
+  static constexpr int kMaxPendingPasses = 32;
+  void enqueue(const std::function<void(WGPUCommandEncoder)> &record,
+               const std::vector<WGPUBuffer> &uses);
+  // Submits the recorded passes without waiting for them.
+  void flush();
+  // Flushes only if a recorded pass touches buffer, so a queue write to a
+  // buffer nothing pending reads can go ahead without breaking the batch.
+  void flushIfPending(WGPUBuffer buffer);
+  // Submits the recorded passes and blocks until the queue is idle.
+  void sync();
+  void syncAsync(std::function<void()> callback);
 
 private:
+  void releaseTimestampQueries();
+  void flushLocked();
+
+  std::mutex streamMutex;
+  WGPUCommandEncoder streamEncoder = nullptr;
+  int pendingPasses = 0;
+  // Buffers touched by the recorded passes. A released handle may linger
+  // until the next flush; at worst that costs one early flush.
+  std::unordered_set<WGPUBuffer> pendingBuffers;
+
   std::unique_ptr<gpu::Context> ctx;
+  bool timestampFeature = false;
+  bool timingEnabled = false;
+  uint32_t maxWorkgroups = 65535;
+  WGPUQuerySet querySet = nullptr;
+  WGPUBuffer queryResolve = nullptr;
 };
 
 class Buffer {
 public:
   Buffer(MGPU &mgpu);
-  void createBuffer(int bufferSize);
+  void createBuffer(size_t bufferSize);
   void readSync(void *outputData, size_t size, size_t offset = 0);
   void readAsync(void *outputData, size_t size, size_t offset,
                  std::function<void()> callback);
   void setData(const float *inputData, size_t byteSize);
+  // Writes byteSize bytes at offset (both multiples of 4) without resizing.
+  bool write(const void *data, size_t byteSize, size_t offset);
+  // Records a copy into dst on the context stream.
+  bool copyTo(const Buffer &dst, size_t srcOffset, size_t dstOffset,
+              size_t byteSize) const;
+  // Records a zero fill of [offset, offset + byteSize) on the context
+  // stream. Both must be multiples of 4.
+  bool clear(size_t offset, size_t byteSize);
   void release();
 
   gpu::Array bufferData;
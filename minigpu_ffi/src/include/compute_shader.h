@@ -12,14 +12,49 @@ namespace mgpu
         void loadKernelString(const std::string &kernelString);
         void loadKernelFile(const std::string &path);
         bool hasKernel() const;
-        void setBuffer(int tag, const Buffer &buffer);
+        // Binds buffer to tag. A non-zero size binds only [offset,
+        // offset + size), which lets kernels work through buffers larger
+        // than maxStorageBufferBindingSize in chunks; offset must be a
+        // multiple of minStorageBufferOffsetAlignment.
+        void setBuffer(int tag, const Buffer &buffer, size_t offset = 0,
+                       size_t size = 0);
+        // Records the dispatch on the context stream and waits for it.
         void dispatch(int groupsX, int groupsY, int groupsZ);
+        // Records the dispatch on the context stream and returns without
+        // waiting; MGPU::sync() or a buffer read waits for it. Returns true
+        // if work was left pending (false on error or for timed dispatches,
+        // which complete before returning).
+        bool enqueue(int groupsX, int groupsY, int groupsZ);
         void dispatchAsync(int groupsX, int groupsY, int groupsZ,
                           std::function<void()> callback);
 
+        // Kernel source as it is compiled and keyed in the pipeline cache,
+        // after template placeholders have been filled in.
+        static std::string prepareSource(const std::string &kernelString);
+
+        // GPU time of the most recent timed dispatch, or 0 if none.
+        uint64_t lastGpuTimeNs() const { return lastGpuNs; }
+
     private:
+        WGPUBindGroup createBindGroup(const CachedPipeline &pipeline) const;
+        static void encodePass(WGPUCommandEncoder encoder,
+                               const CachedPipeline &pipeline,
+                               WGPUBindGroup bindGroup, int groupsX,
+                               int groupsY, int groupsZ,
+                               WGPUComputePassTimestampWrites *timestamps);
+        uint64_t submitTimed(const CachedPipeline &pipeline,
+                             WGPUBindGroup bindGroup, int groupsX, int groupsY,
+                             int groupsZ);
+
+        uint64_t lastGpuNs = 0;
         gpu::KernelCode code;
-        std::vector<gpu::Tensor> bindings;
+        struct BufferBinding
+        {
+            WGPUBuffer buffer = nullptr;
+            size_t offset = 0;
+            size_t size = 0;
+        };
+        std::vector<BufferBinding> bindings;
         MGPU &mgpu;
     };
 }
@@ -0,0 +1,55 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+namespace mgpu {
+
+// Persistent store for Dawn's blob cache (compiled shaders and pipelines),
+// wired into the device through the DawnCacheDeviceDescriptor load/store
+// callbacks.
+//
+// Entries live under <root>/v<format>-<dawn commit>/<adapter hash>/, so a
+// different Dawn build, adapter or driver never reads another one's blobs.
+// Directories left behind by other versions are removed by configure().
+// When the store grows past maxBytes, the least recently used entries are
+// evicted.
+class DiskCache {
+public:
+  static constexpr uint32_t kFormatVersion = 1;
+
+  // Sets the cache root and size limit. Returns false if the directory
+  // cannot be created. A maxBytes of 0 disables the cache.
+  bool configure(const std::string &root, uint64_t maxBytes);
+  bool enabled() const;
+
+  // Selects the entry directory for an adapter, described by its vendor,
+  // architecture, device and driver strings. Call before creating the device.
+  void selectAdapter(const std::string &adapterKey);
+
+  // Dawn callbacks. load returns the size of the stored value, or 0 on a
+  // miss; the value is only copied when valueSize is large enough.
+  size_t load(const void *key, size_t keySize, void *value, size_t valueSize);
+  void store(const void *key, size_t keySize, const void *value,
+             size_t valueSize);
+
+  uint64_t sizeBytes() const;
+
+private:
+  std::filesystem::path entryPath(const void *key, size_t keySize) const;
+  void evict(uint64_t incoming, const std::filesystem::path &keep = {});
+
+  mutable std::mutex mutex;
+  std::filesystem::path root;
+  std::filesystem::path dir;
+  uint64_t maxBytes = 0;
+  uint64_t totalBytes = 0;
+};
+
+} // namespace mgpu
+
+#endif // DISK_CACHE_H
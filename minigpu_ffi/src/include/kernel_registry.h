@@ -0,0 +1,55 @@
+#ifndef KERNEL_REGISTRY_H
+#define KERNEL_REGISTRY_H
+
+#include "compute_shader.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mgpu {
+
+// Kernels registered once and referred to by a small integer id afterwards,
+// so command lists can launch them without sending or hashing the source
+// again. Each id owns a ComputeShader whose bindings persist between
+// launches. Registering the same source twice returns the same id.
+//
+// At most kMaxKernels kernels are kept, half the pipeline cache, so the
+// registered kernels never push each other's pipelines out. Registering
+// past that releases the least recently used kernel and its pipeline; its
+// id then stops resolving and is never handed out again.
+class KernelRegistry {
+public:
+  static constexpr size_t kMaxKernels = PipelineCache::kMaxEntries / 2;
+
+  explicit KernelRegistry(MGPU &mgpu) : mgpu(mgpu) {}
+
+  int add(const std::string &source);
+  // Returns null for unknown or released ids.
+  std::shared_ptr<ComputeShader> get(int id);
+  // Releases the kernel and its cached pipeline; unknown ids are ignored.
+  void release(int id);
+  // Forgets every kernel; ids handed out earlier become invalid.
+  void clear();
+
+private:
+  struct Entry {
+    std::shared_ptr<ComputeShader> shader;
+    std::string source;
+    uint64_t lastUse = 0;
+  };
+
+  void erase(std::unordered_map<int, Entry>::iterator it);
+
+  MGPU &mgpu;
+  std::mutex mutex;
+  std::unordered_map<std::string, int> ids;
+  std::unordered_map<int, Entry> kernels;
+  int nextId = 0;
+  uint64_t useClock = 0;
+};
+
+} // namespace mgpu
+
+#endif // KERNEL_REGISTRY_H
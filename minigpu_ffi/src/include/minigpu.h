@@ -2,9 +2,12 @@
 #define MINIGPU_H
 
 #include "export.h"
+#include <stddef.h>
+#include <stdint.h>
 #ifdef __cplusplus
 #include "../include/buffer.h"
 #include "../include/compute_shader.h"
+#include "../include/kernel_registry.h"
 
 extern "C"
 {
@@ -17,15 +20,103 @@ extern "C"
     typedef void (*MGPUCallback)(void);
     EXPORT void mgpuInitializeContextAsync(MGPUCallback callback);
     EXPORT void mgpuDestroyContext();
+
+    // Context creation options. Start from mgpuGetDefaultContextOptions and
+    // change what is needed. Features are MGPU_FEATURE_* bits: required ones
+    // make creation fail when the adapter lacks them, optional ones are
+    // enabled when available. Limits left at 0 keep the WebGPU defaults and
+    // are clamped to what the adapter supports. Toggles are Dawn toggle names
+    // and are ignored on the web.
+    typedef enum MGPUPowerPreference
+    {
+        MGPU_POWER_DEFAULT = 0,
+        MGPU_POWER_LOW = 1,
+        MGPU_POWER_HIGH_PERFORMANCE = 2,
+    } MGPUPowerPreference;
+
+    typedef enum MGPUFeature
+    {
+        MGPU_FEATURE_SHADER_F16 = 1 << 0,
+        MGPU_FEATURE_SUBGROUPS = 1 << 1,
+        MGPU_FEATURE_TIMESTAMP_QUERY = 1 << 2,
+    } MGPUFeature;
+
+    typedef struct MGPUContextOptions
+    {
+        int powerPreference;
+        uint32_t requiredFeatures;
+        uint32_t optionalFeatures;
+        int useAdapterLimits;
+        uint64_t maxStorageBufferBindingSize;
+        uint64_t maxBufferSize;
+        // Shorthand for the "skip_validation" toggle, for trusted builds.
+        int skipValidation;
+        const char *const *enabledToggles;
+        int enabledToggleCount;
+        const char *const *disabledToggles;
+        int disabledToggleCount;
+    } MGPUContextOptions;
+
+    typedef struct MGPUAdapterInfo
+    {
+        char vendor[128];
+        char architecture[128];
+        char device[128];
+        char description[256];
+        int backendType;
+        int adapterType;
+        uint32_t vendorID;
+        uint32_t deviceID;
+    } MGPUAdapterInfo;
+
+    typedef struct MGPULimits
+    {
+        uint64_t maxBufferSize;
+        uint64_t maxStorageBufferBindingSize;
+        uint32_t maxStorageBuffersPerShaderStage;
+        uint32_t maxComputeWorkgroupStorageSize;
+        uint32_t maxComputeInvocationsPerWorkgroup;
+        uint32_t maxComputeWorkgroupSizeX;
+        uint32_t maxComputeWorkgroupSizeY;
+        uint32_t maxComputeWorkgroupSizeZ;
+        uint32_t maxComputeWorkgroupsPerDimension;
+        uint32_t minStorageBufferOffsetAlignment;
+    } MGPULimits;
+
+    EXPORT void mgpuGetDefaultContextOptions(MGPUContextOptions *options);
+    // Returns 1 on success.
+    EXPORT int mgpuInitializeContextWithOptions(const MGPUContextOptions *options);
+    // The following return 1 on success, 0 without a context.
+    EXPORT int mgpuGetAdapterInfo(MGPUAdapterInfo *info);
+    EXPORT int mgpuGetLimits(MGPULimits *limits);
+    // Whether the device was created with an MGPU_FEATURE_* feature.
+    EXPORT int mgpuHasFeature(int feature);
     EXPORT MGPUComputeShader *mgpuCreateComputeShader();
     EXPORT void mgpuDestroyComputeShader(MGPUComputeShader *shader);
     EXPORT void mgpuLoadKernel(MGPUComputeShader *shader, const char *kernelString);
     EXPORT int mgpuHasKernel(MGPUComputeShader *shader);
-    EXPORT MGPUBuffer *mgpuCreateBuffer(int bufferSize);
+    EXPORT MGPUBuffer *mgpuCreateBuffer(size_t bufferSize);
     EXPORT void mgpuDestroyBuffer(MGPUBuffer *buffer);
     EXPORT void mgpuSetBuffer(MGPUComputeShader *shader, int tag, MGPUBuffer *buffer);
+    // Binds size bytes of buffer starting at offset (a multiple of
+    // minStorageBufferOffsetAlignment). A size of 0 binds the rest of the
+    // buffer.
+    EXPORT void mgpuSetBufferRange(MGPUComputeShader *shader, int tag, MGPUBuffer *buffer, size_t offset, size_t size);
+    // A 1D dispatch with more than maxComputeWorkgroupsPerDimension groups
+    // is folded into 2D/3D; such kernels must derive their flat index from
+    // num_workgroups rather than global_invocation_id.x alone.
     EXPORT void mgpuDispatch(MGPUComputeShader *shader, int groupsX, int groupsY, int groupsZ);
     EXPORT void mgpuDispatchAsync(MGPUComputeShader *shader, int groupsX, int groupsY, int groupsZ, MGPUCallback callback);
+
+    // Non-blocking dispatch. The pass is recorded on the context stream and
+    // submitted in a batch; reads of any buffer wait for it, and mgpuSync
+    // waits for everything recorded so far. Buffers and shaders may be
+    // rewritten or released right after enqueuing.
+    EXPORT void mgpuEnqueueDispatch(MGPUComputeShader *shader, int groupsX, int groupsY, int groupsZ);
+    // Submits recorded dispatches without waiting for them.
+    EXPORT void mgpuFlush();
+    EXPORT void mgpuSync();
+    EXPORT void mgpuSyncAsync(MGPUCallback callback);
     EXPORT void mgpuReadBufferSync(MGPUBuffer *buffer, float *outputData, size_t size, size_t offset);
     EXPORT void mgpuReadBufferAsync(MGPUBuffer *buffer,
         float *outputData,
@@ -33,6 +124,128 @@ extern "C"
         size_t offset,
         MGPUCallback callback);
     EXPORT void mgpuSetBufferData(MGPUBuffer *buffer, const float *inputData, size_t byteSize);
+    // Zeroes byteSize bytes from offset on the device without an upload; a
+    // byteSize of 0 clears to the end of the buffer. Recorded like an
+    // enqueued dispatch, so it is ordered with the work around it.
+    EXPORT void mgpuClearBuffer(MGPUBuffer *buffer, size_t offset, size_t byteSize);
+
+    // Command lists. Kernels are registered once and launched by id; a
+    // sequence of binds, dispatches, copies and uploads is then executed
+    // with a single mgpuExecuteCommands call. Dispatches and copies are
+    // enqueued like mgpuEnqueueDispatch. Bindings set on a kernel id persist
+    // across lists. The registry is bounded: an id stays valid until it is
+    // evicted (see mgpuRegisterKernel), released with mgpuReleaseKernel, or
+    // the context is destroyed.
+    typedef enum MGPUCommandType
+    {
+        // kernel, binding, buffer, offset, size (0 = rest of the buffer)
+        MGPU_COMMAND_BIND = 0,
+        // kernel, groups
+        MGPU_COMMAND_DISPATCH = 1,
+        // buffer -> target, offset -> targetOffset, size bytes
+        MGPU_COMMAND_COPY = 2,
+        // data -> buffer at offset, size bytes
+        MGPU_COMMAND_UPLOAD = 3,
+    } MGPUCommandType;
+
+    typedef struct MGPUCommand
+    {
+        uint32_t type;
+        int32_t kernel;
+        uint32_t binding;
+        uint32_t groups[3];
+        MGPUBuffer *buffer;
+        MGPUBuffer *target;
+        uint64_t offset;
+        uint64_t targetOffset;
+        uint64_t size;
+        const void *data;
+    } MGPUCommand;
+
+    // Returns the kernel id, or -1 on error. The runtime keeps a bounded
+    // number of kernels and releases the least recently used one past that,
+    // so callers that cache ids should release kernels themselves first.
+    EXPORT int mgpuRegisterKernel(const char *kernelString);
+    // Releases a registered kernel and its compiled pipeline; the id becomes
+    // invalid.
+    EXPORT void mgpuReleaseKernel(int kernel);
+    // Runs commands in order and returns how many succeeded; execution stops
+    // at the first invalid command.
+    EXPORT int mgpuExecuteCommands(const MGPUCommand *commands, int count);
+
+    // 64-byte aligned host memory for staging transfers. Callers that fill
+    // it in place and pass it to mgpuSetBufferData / mgpuReadBuffer* skip
+    // the temporary copy a managed array would need. Returns null on failure.
+    EXPORT float *mgpuAllocHostBuffer(size_t byteSize);
+    EXPORT void mgpuFreeHostBuffer(void *ptr);
+
+    // Dispatch timing through GPU timestamp queries. Requires the adapter to
+    // support the timestamp-query feature (see mgpuTimingSupported); while
+    // enabled, each dispatch waits for its timestamps to be read back.
+    typedef struct MGPUDispatchTiming
+    {
+        uint64_t kernelHash;
+        uint64_t gpuNs;
+        uint64_t hostNs;
+    } MGPUDispatchTiming;
+
+    typedef struct MGPUKernelTimingStats
+    {
+        uint64_t kernelHash;
+        uint64_t count;
+        double meanNs;
+        double p99Ns;
+    } MGPUKernelTimingStats;
+
+    EXPORT int mgpuTimingSupported();
+    EXPORT void mgpuSetTimingEnabled(int enabled);
+    EXPORT int mgpuGetLastDispatchTiming(MGPUDispatchTiming *timing);
+    EXPORT uint64_t mgpuGetShaderLastGpuTimeNs(MGPUComputeShader *shader);
+    // Fills up to capacity rows, one per kernel; returns the number written.
+    // Pass a null table to query the number of kernels.
+    EXPORT int mgpuGetKernelTimingStats(MGPUKernelTimingStats *stats, int capacity);
+    EXPORT void mgpuResetTimingStats();
+
+    // Persistent shader and pipeline cache. Must be called before
+    // mgpuInitializeContext; compiled blobs are stored under dir, keyed by
+    // adapter, driver and Dawn version, and trimmed to maxBytes. A null dir
+    // or a maxBytes of 0 turns the cache off. Returns 1 on success.
+    EXPORT int mgpuSetCacheOptions(const char *dir, uint64_t maxBytes);
+
+    // Compiles kernels on background threads so that later dispatches of the
+    // same source hit the pipeline cache. Returns once the compiles are
+    // issued; callback runs on a background thread once every kernel has
+    // compiled or failed (immediately if there is no context).
+    // mgpuDestroyContext waits for pending precompiles.
+    EXPORT void mgpuPrecompile(const char **kernels, int count, MGPUCallback callback);
+
+    // Runtime counters since start (or the last mgpuResetStats). Live and
+    // peak figures describe buffers created through mgpuCreateBuffer.
+    typedef struct MGPUStats
+    {
+        uint64_t liveBuffers;
+        uint64_t liveBytes;
+        uint64_t peakBytes;
+        uint64_t bytesUploaded;
+        uint64_t bytesDownloaded;
+        uint64_t dispatches;
+        uint64_t compiles;
+        uint64_t compileNs;
+        uint64_t pipelineCacheHits;
+        uint64_t queueWaits;
+        uint64_t queueWaitNs;
+        double avgQueueWaitNs;
+    } MGPUStats;
+
+    EXPORT void mgpuGetStats(MGPUStats *stats);
+    EXPORT void mgpuResetStats();
+
+    // Tracing. Spans are only recorded when built with MGPU_TRACE and enabled
+    // at runtime. mgpuDumpTrace writes Chrome trace JSON and returns 1 on
+    // success.
+    EXPORT void mgpuSetTraceEnabled(int enabled);
+    EXPORT int mgpuDumpTrace(const char *path);
+    EXPORT void mgpuClearTrace();
 
 #ifdef __cplusplus
 }
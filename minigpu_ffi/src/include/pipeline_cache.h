@@ -0,0 +1,89 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "gpuh.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mgpu {
+
+// A compiled compute pipeline together with the layout its bind groups are
+// created from. Only @group(0) is used; bindings are read from the source.
+struct CachedPipeline {
+  WGPUComputePipeline pipeline = nullptr;
+  WGPUBindGroupLayout layout = nullptr;
+  std::vector<uint32_t> bindings;
+
+  CachedPipeline() = default;
+  CachedPipeline(const CachedPipeline &) = delete;
+  CachedPipeline &operator=(const CachedPipeline &) = delete;
+  ~CachedPipeline();
+};
+
+// Compute pipelines keyed by kernel source, so each kernel is compiled once
+// per device instead of on every dispatch. Pipelines can also be compiled
+// ahead of time on Dawn's worker threads with precompile().
+//
+// At most kMaxEntries pipelines are kept; past that the least recently used
+// one is released, so callers that generate sources per shape or value do
+// not grow native memory without bound. Evicted kernels are recompiled (or
+// loaded from the disk cache) on their next dispatch.
+class PipelineCache {
+public:
+  static constexpr size_t kMaxEntries = 512;
+
+  // Returns the pipeline for source, compiling it synchronously on a miss.
+  // Returns null if the pipeline could not be created.
+  std::shared_ptr<CachedPipeline> acquire(gpu::Context &ctx,
+                                          const std::string &source);
+
+  // Issues an asynchronous compile for every source that is not cached yet
+  // and returns; done runs on a background thread once all of them have
+  // finished (or failed). The device calls are made on the calling thread
+  // and the background thread only waits for their callbacks. clear()
+  // waits for outstanding precompiles.
+  void precompile(gpu::Context &ctx, std::vector<std::string> sources,
+                  std::function<void()> done);
+
+  size_t size() const;
+
+  // Releases the pipeline compiled from source, if cached.
+  void erase(const std::string &source);
+
+  // Waits for pending precompiles, then drops every pipeline. Call before
+  // the device is released.
+  void clear();
+
+private:
+  struct Entry {
+    std::shared_ptr<CachedPipeline> pipeline;
+    uint64_t lastUse = 0;
+  };
+
+  // A precompile's waiting thread; finished is set as its last action.
+  struct Worker {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> finished;
+  };
+
+  std::shared_ptr<CachedPipeline>
+  insert(const std::string &source, std::shared_ptr<CachedPipeline> pipeline);
+  void joinWorkers(bool finishedOnly);
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  uint64_t useClock = 0;
+
+  std::mutex workersMutex;
+  std::vector<Worker> workers;
+};
+
+} // namespace mgpu
+
+#endif // PIPELINE_CACHE_H
@@ -0,0 +1,68 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mgpu {
+
+// Process-wide runtime counters. Every update is a single relaxed atomic
+// operation, so they stay on in release builds.
+struct Stats {
+  std::atomic<uint64_t> liveBuffers{0};
+  std::atomic<uint64_t> liveBytes{0};
+  std::atomic<uint64_t> peakBytes{0};
+  std::atomic<uint64_t> bytesUploaded{0};
+  std::atomic<uint64_t> bytesDownloaded{0};
+  std::atomic<uint64_t> dispatches{0};
+  std::atomic<uint64_t> compiles{0};
+  std::atomic<uint64_t> compileNs{0};
+  std::atomic<uint64_t> pipelineCacheHits{0};
+  std::atomic<uint64_t> queueWaits{0};
+  std::atomic<uint64_t> queueWaitNs{0};
+
+  void bufferCreated(uint64_t bytes) {
+    liveBuffers.fetch_add(1, std::memory_order_relaxed);
+    uint64_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+  }
+
+  void bufferReleased(uint64_t bytes) {
+    liveBuffers.fetch_sub(1, std::memory_order_relaxed);
+    liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // Clears the cumulative counters. Live counts are kept and the peak
+  // restarts from the current live bytes.
+  void reset() {
+    for (auto *counter : {&bytesUploaded, &bytesDownloaded, &dispatches,
+                          &compiles, &compileNs, &pipelineCacheHits,
+                          &queueWaits, &queueWaitNs}) {
+      counter->store(0, std::memory_order_relaxed);
+    }
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  }
+};
+
+Stats &stats();
+
+// Nanoseconds elapsed since begin.
+inline uint64_t elapsedNs(std::chrono::steady_clock::time_point begin) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - begin)
+          .count());
+}
+
+} // namespace mgpu
+
+#endif // STATS_H
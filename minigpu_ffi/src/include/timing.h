@@ -0,0 +1,56 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mgpu {
+
+// GPU and host time of one dispatch. gpuNs comes from timestamp queries
+// written at the start and end of the compute pass; hostNs is the wall time
+// of the whole dispatch call, including encoding, submission and the wait.
+struct DispatchTiming {
+  uint64_t kernelHash;
+  uint64_t gpuNs;
+  uint64_t hostNs;
+};
+
+struct KernelTimingStats {
+  uint64_t kernelHash;
+  uint64_t count;
+  double meanNs;
+  double p99Ns;
+};
+
+// Per-kernel aggregate of timed dispatches, keyed by a hash of the kernel
+// source. p99 is computed over the most recent kSamplesPerKernel dispatches.
+class TimingRegistry {
+public:
+  static constexpr size_t kSamplesPerKernel = 1024;
+
+  void record(const DispatchTiming &timing);
+  bool last(DispatchTiming &out) const;
+  size_t snapshot(KernelTimingStats *out, size_t capacity) const;
+  size_t size() const;
+  void reset();
+
+private:
+  struct Entry {
+    uint64_t count = 0;
+    double totalNs = 0;
+    std::vector<uint64_t> samples;
+    size_t next = 0;
+  };
+
+  mutable std::mutex mutex;
+  std::unordered_map<uint64_t, Entry> entries;
+  DispatchTiming lastTiming{};
+  bool hasLast = false;
+};
+
+} // namespace mgpu
+
+#endif // TIMING_H
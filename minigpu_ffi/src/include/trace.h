@@ -0,0 +1,85 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Lightweight span tracing for the runtime.
+//
+// Spans are recorded into a fixed-size ring owned by the calling thread, so
+// the hot path is a clock read and a few stores with no locks or allocation.
+// Recording is off until enabled at runtime with mgpu::trace::setEnabled (or
+// mgpuSetTraceEnabled), and the MGPU_TRACE_SCOPE macro compiles to nothing
+// unless MGPU_TRACE is defined. mgpu::trace::dump writes every ring as Chrome
+// trace JSON, viewable in chrome://tracing or Perfetto.
+
+namespace mgpu {
+namespace trace {
+
+enum class Event : uint8_t {
+  Create,
+  Upload,
+  Dispatch,
+  Readback,
+  Compile,
+  Submit,
+  Sync
+};
+
+struct Span {
+  uint64_t beginNs;
+  uint64_t endNs;
+  uint64_t bytes;
+  Event event;
+};
+
+bool enabled();
+void setEnabled(bool on);
+
+// Nanoseconds since the trace epoch (process start).
+uint64_t nowNs();
+
+void record(Event event, uint64_t beginNs, uint64_t endNs, uint64_t bytes);
+
+// Writes all recorded spans as Chrome trace JSON. Threads may keep
+// recording meanwhile; spans they overwrite during the dump are left out.
+// Returns false if the file cannot be written.
+bool dump(const char *path);
+
+// Drops every span recorded so far. Safe while other threads record.
+void clear();
+
+// Records a span covering its own lifetime.
+class Scope {
+public:
+  explicit Scope(Event event, uint64_t bytes = 0)
+      : event(event), bytes(bytes), active(enabled()),
+        begin(active ? nowNs() : 0) {}
+  ~Scope() {
+    if (active) {
+      record(event, begin, nowNs(), bytes);
+    }
+  }
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  Event event;
+  uint64_t bytes;
+  bool active;
+  uint64_t begin;
+};
+
+} // namespace trace
+} // namespace mgpu
+
+#ifdef MGPU_TRACE
+#define MGPU_TRACE_CONCAT_(a, b) a##b
+#define MGPU_TRACE_CONCAT(a, b) MGPU_TRACE_CONCAT_(a, b)
+#define MGPU_TRACE_SCOPE(event, bytes)                                         \
+  ::mgpu::trace::Scope MGPU_TRACE_CONCAT(mgpuTraceScope_, __LINE__)(         \
+      ::mgpu::trace::Event::event, static_cast<uint64_t>(bytes))
+#else
+#define MGPU_TRACE_SCOPE(event, bytes) ((void)0)
+#endif
+
+#endif // TRACE_H
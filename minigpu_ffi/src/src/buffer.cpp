@@ -3,18 +3,200 @@
 #include "../include/buffer.h"
 #include "../include/compute_shader.h"
 #include "../include/gpuh.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 using namespace gpu;
 
 namespace mgpu {
-void MGPU::initializeContext() {
+namespace {
+
+AdapterInfo queryAdapterInfo(WGPUAdapter adapter) {
+  WGPUAdapterInfo info = {};
+  if (wgpuAdapterGetInfo(adapter, &info) != WGPUStatus_Success) {
+    return {};
+  }
+  auto str = [](WGPUStringView view) {
+    return view.data ? std::string(view.data, view.length == WGPU_STRLEN
+                                                   ? std::strlen(view.data)
+                                                   : view.length)
+                     : std::string();
+  };
+  AdapterInfo result{
+      .vendor = str(info.vendor),
+      .architecture = str(info.architecture),
+      .device = str(info.device),
+      .description = str(info.description),
+      .backendType = info.backendType,
+      .adapterType = info.adapterType,
+      .vendorID = info.vendorID,
+      .deviceID = info.deviceID,
+  };
+  wgpuAdapterInfoFreeMembers(info);
+  return result;
+}
+
+// Identifies the adapter and driver, so cached blobs are never shared
+// between GPUs or driver versions.
+std::string adapterCacheKey(WGPUAdapter adapter) {
+  AdapterInfo info = queryAdapterInfo(adapter);
+  return info.vendor + "|" + info.architecture + "|" + info.device + "|" +
+         info.description + "|" + std::to_string(info.backendType) + "|" +
+         std::to_string(info.vendorID) + "|" + std::to_string(info.deviceID);
+}
+
+} // namespace
+
+bool MGPU::initializeContext(const ContextOptions &options) {
   try {
-    // Wrap context in a unique_ptr.
-    ctx = std::make_unique<gpu::Context>(std::move(gpu::createContext()));
+    // The stream, timestamp queries and pipelines belong to the previous
+    // device, if any, and go with it.
+    if (ctx) {
+      destroyContext();
+    }
+    timestampFeature = false;
+
+    // Create a context on the chosen adapter first; its features and limits
+    // decide what the final device can be created with.
+    WGPURequestAdapterOptions adapterOptions = {};
+    adapterOptions.powerPreference = options.powerPreference;
+    ctx = std::make_unique<gpu::Context>(
+        std::move(gpu::createContext({}, adapterOptions, {})));
+
+    std::vector<WGPUFeatureName> features;
+    for (WGPUFeatureName feature : options.requiredFeatures) {
+      if (!wgpuAdapterHasFeature(ctx->adapter, feature)) {
+        LOG(kDefLog, kError, "Adapter does not support required feature %d",
+            static_cast<int>(feature));
+        ctx.reset();
+        return false;
+      }
+      features.push_back(feature);
+    }
+    std::vector<WGPUFeatureName> optionalFeatures = options.optionalFeatures;
+#ifndef __EMSCRIPTEN__
+    // Async reads, syncAsync and precompile wait for the device on their
+    // own threads while the caller keeps encoding, so Dawn has to lock
+    // around every device call.
+    optionalFeatures.push_back(WGPUFeatureName_ImplicitDeviceSynchronization);
+#endif
+    for (WGPUFeatureName feature : optionalFeatures) {
+      if (wgpuAdapterHasFeature(ctx->adapter, feature) &&
+          std::find(features.begin(), features.end(), feature) ==
+              features.end()) {
+        features.push_back(feature);
+      }
+    }
+
+    WGPULimits adapterLimits = WGPU_LIMITS_INIT;
+    wgpuAdapterGetLimits(ctx->adapter, &adapterLimits);
+    WGPULimits requiredLimits = WGPU_LIMITS_INIT;
+    bool customLimits = false;
+    if (options.useAdapterLimits) {
+      requiredLimits = adapterLimits;
+      requiredLimits.nextInChain = nullptr;
+      customLimits = true;
+    }
+    if (options.maxStorageBufferBindingSize > 0) {
+      requiredLimits.maxStorageBufferBindingSize =
+          std::min(options.maxStorageBufferBindingSize,
+                   adapterLimits.maxStorageBufferBindingSize);
+      customLimits = true;
+    }
+    if (options.maxBufferSize > 0) {
+      requiredLimits.maxBufferSize =
+          std::min(options.maxBufferSize, adapterLimits.maxBufferSize);
+      customLimits = true;
+    }
+
+    WGPUDeviceDescriptor devDescriptor = {};
+    devDescriptor.requiredFeatureCount = features.size();
+    devDescriptor.requiredFeatures = features.data();
+    if (customLimits) {
+      devDescriptor.requiredLimits = &requiredLimits;
+    }
+    bool extraChain = false;
+#ifndef __EMSCRIPTEN__
+    std::vector<const char *> enabledToggles;
+    std::vector<const char *> disabledToggles;
+    for (const std::string &toggle : options.enabledToggles) {
+      enabledToggles.push_back(toggle.c_str());
+    }
+    for (const std::string &toggle : options.disabledToggles) {
+      disabledToggles.push_back(toggle.c_str());
+    }
+    WGPUDawnTogglesDescriptor togglesDescriptor = {};
+    togglesDescriptor.chain.sType = WGPUSType_DawnTogglesDescriptor;
+    togglesDescriptor.enabledToggleCount = enabledToggles.size();
+    togglesDescriptor.enabledToggles = enabledToggles.data();
+    togglesDescriptor.disabledToggleCount = disabledToggles.size();
+    togglesDescriptor.disabledToggles = disabledToggles.data();
+    if (!enabledToggles.empty() || !disabledToggles.empty()) {
+      togglesDescriptor.chain.next = devDescriptor.nextInChain;
+      devDescriptor.nextInChain = &togglesDescriptor.chain;
+      extraChain = true;
+    }
+
+    // Persistent blob cache, if one is configured.
+    std::string adapterKey;
+    WGPUDawnCacheDeviceDescriptor cacheDescriptor = {};
+    if (diskCache.enabled()) {
+      adapterKey = adapterCacheKey(ctx->adapter);
+      diskCache.selectAdapter(adapterKey);
+      cacheDescriptor.chain.sType = WGPUSType_DawnCacheDeviceDescriptor;
+      cacheDescriptor.isolationKey = {.data = adapterKey.data(),
+                                      .length = adapterKey.size()};
+      cacheDescriptor.loadDataFunction =
+          [](const void *key, size_t keySize, void *value, size_t valueSize,
+             void *userdata) -> size_t {
+        return static_cast<DiskCache *>(userdata)->load(key, keySize, value,
+                                                        valueSize);
+      };
+      cacheDescriptor.storeDataFunction =
+          [](const void *key, size_t keySize, const void *value,
+             size_t valueSize, void *userdata) {
+            static_cast<DiskCache *>(userdata)->store(key, keySize, value,
+                                                      valueSize);
+          };
+      cacheDescriptor.functionUserdata = &diskCache;
+      cacheDescriptor.chain.next = devDescriptor.nextInChain;
+      devDescriptor.nextInChain = &cacheDescriptor.chain;
+      extraChain = true;
+    }
+#endif
+
+    // The probe device has no optional features, limits or toggles; only
+    // recreate it when something was asked for.
+    if (!features.empty() || customLimits || extraChain) {
+      ctx.reset();
+      ctx = std::make_unique<gpu::Context>(std::move(
+          gpu::createContext({}, adapterOptions, devDescriptor)));
+    }
+    timestampFeature = hasFeature(WGPUFeatureName_TimestampQuery);
+    maxWorkgroups = limits().maxComputeWorkgroupsPerDimension;
     LOG(kDefLog, kInfo, "GPU context initialized successfully.");
+    return true;
   } catch (const std::exception &ex) {
     LOG(kDefLog, kError, "Failed to create GPU context: %s", ex.what());
+    ctx.reset();
+    return false;
+  }
+}
+
+AdapterInfo MGPU::adapterInfo() const {
+  return ctx ? queryAdapterInfo(ctx->adapter) : AdapterInfo{};
+}
+
+WGPULimits MGPU::limits() const {
+  WGPULimits limits = WGPU_LIMITS_INIT;
+  if (ctx) {
+    wgpuDeviceGetLimits(ctx->device, &limits);
   }
+  return limits;
 }
 
 void MGPU::initializeContextAsync(std::function<void()> callback) {
@@ -28,8 +210,113 @@ void MGPU::initializeContextAsync(std::function<void()> callback) {
   }
 }
 
+WGPUQuerySet MGPU::timestampQuerySet() {
+  if (querySet == nullptr) {
+    WGPUQuerySetDescriptor descriptor = {};
+    descriptor.type = WGPUQueryType_Timestamp;
+    descriptor.count = 2;
+    querySet = wgpuDeviceCreateQuerySet(ctx->device, &descriptor);
+
+    WGPUBufferDescriptor resolveDescriptor = {};
+    resolveDescriptor.usage =
+        WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+    resolveDescriptor.size = 2 * sizeof(uint64_t);
+    queryResolve = wgpuDeviceCreateBuffer(ctx->device, &resolveDescriptor);
+  }
+  return querySet;
+}
+
+void MGPU::releaseTimestampQueries() {
+  if (querySet != nullptr) {
+    wgpuQuerySetRelease(querySet);
+    wgpuBufferRelease(queryResolve);
+    querySet = nullptr;
+    queryResolve = nullptr;
+  }
+}
+
+void MGPU::enqueue(const std::function<void(WGPUCommandEncoder)> &record,
+                   const std::vector<WGPUBuffer> &uses) {
+  std::lock_guard<std::mutex> lock(streamMutex);
+  if (streamEncoder == nullptr) {
+    streamEncoder = wgpuDeviceCreateCommandEncoder(ctx->device, nullptr);
+  }
+  record(streamEncoder);
+  pendingBuffers.insert(uses.begin(), uses.end());
+  if (++pendingPasses >= kMaxPendingPasses) {
+    flushLocked();
+  }
+}
+
+void MGPU::flush() {
+  std::lock_guard<std::mutex> lock(streamMutex);
+  flushLocked();
+}
+
+void MGPU::flushIfPending(WGPUBuffer buffer) {
+  std::lock_guard<std::mutex> lock(streamMutex);
+  if (pendingBuffers.count(buffer) != 0) {
+    flushLocked();
+  }
+}
+
+void MGPU::flushLocked() {
+  if (streamEncoder == nullptr) {
+    return;
+  }
+  MGPU_TRACE_SCOPE(Submit, pendingPasses);
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(streamEncoder, nullptr);
+  wgpuCommandEncoderRelease(streamEncoder);
+  streamEncoder = nullptr;
+  pendingPasses = 0;
+  pendingBuffers.clear();
+  wgpuQueueSubmit(ctx->queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+}
+
+void MGPU::sync() {
+  flush();
+  MGPU_TRACE_SCOPE(Sync, 0);
+  auto waitBegin = std::chrono::steady_clock::now();
+  std::atomic<bool> done{false};
+  WGPUQueueWorkDoneCallbackInfo doneInfo = {};
+  doneInfo.mode = WGPUCallbackMode_AllowProcessEvents;
+  doneInfo.callback = [](WGPUQueueWorkDoneStatus, void *userdata1, void *) {
+    static_cast<std::atomic<bool> *>(userdata1)->store(true);
+  };
+  doneInfo.userdata1 = &done;
+  wgpuQueueOnSubmittedWorkDone(ctx->queue, doneInfo);
+  while (!done.load()) {
+    processEvents(ctx->instance);
+  }
+  Stats &counters = stats();
+  counters.add(counters.queueWaitNs, elapsedNs(waitBegin));
+  counters.add(counters.queueWaits, 1);
+}
+
+void MGPU::syncAsync(std::function<void()> callback) {
+  std::thread([this, callback]() {
+    sync();
+    if (callback) {
+      callback();
+    }
+  }).detach();
+}
+
 void MGPU::destroyContext() {
   if (ctx) {
+    {
+      // Unsubmitted work is dropped along with the device.
+      std::lock_guard<std::mutex> lock(streamMutex);
+      if (streamEncoder != nullptr) {
+        wgpuCommandEncoderRelease(streamEncoder);
+        streamEncoder = nullptr;
+        pendingPasses = 0;
+      }
+      pendingBuffers.clear();
+    }
+    releaseTimestampQueries();
+    pipelines.clear();
     ctx.release();
     LOG(kDefLog, kInfo, "GPU context destroyed successfully.");
   } else {
@@ -42,7 +329,10 @@ Buffer::Buffer(MGPU &mgpu) : mgpu(mgpu) {
   bufferData.usage = 0;
   bufferData.size = 0;
 }
-void Buffer::createBuffer(int bufferSize) {
+void Buffer::createBuffer(size_t bufferSize) {
+  MGPU_TRACE_SCOPE(Create, bufferSize);
+  // Growing through setData replaces the old buffer.
+  release();
   WGPUBufferUsage usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst |
                           WGPUBufferUsage_CopySrc;
   WGPUBufferDescriptor descriptor = {};
@@ -61,34 +351,25 @@ void Buffer::createBuffer(int bufferSize) {
   bufferData = gpu::Array{
       .buffer = buffer,
       .usage = usage,
-      .size = static_cast<size_t>(bufferSize),
+      .size = bufferSize,
   };
+  stats().bufferCreated(bufferData.size);
 }
 
 void Buffer::readSync(void *outputData, size_t size, size_t offset) {
-
-  LOG(kDefLog, kInfo, "readSync: Reading %zu bytes from buffer", size);
-
+  MGPU_TRACE_SCOPE(Readback, size);
   gpu::Tensor tensor{bufferData, gpu::Shape{bufferData.size}}; // Shape is not used here.
+  // The copy is submitted after any recorded dispatches, so the read sees
+  // their results.
+  mgpu.flush();
   
   // Instead of copying the whole buffer, copy only the requested number of bytes.
+  auto waitBegin = std::chrono::steady_clock::now();
   gpu::toCPU(this->mgpu.getContext(), tensor, outputData, size, offset);
-
-  // Log the read data for verification.
-  float *data = reinterpret_cast<float *>(outputData);
-  size_t numFloats = size / sizeof(float);
-  if (numFloats > 0) {
-    std::string floatString = "readSync: Floats: ";
-    for (size_t i = 0; i < numFloats; i++) {
-      floatString += std::to_string(data[i]);
-      if (i < numFloats - 1) {
-        floatString += ", ";
-      }
-    }
-    LOG(kDefLog, kInfo, floatString.c_str());
-  } else {
-    LOG(kDefLog, kInfo, "readSync: Not enough data to display float values");
-  }
+  Stats &counters = stats();
+  counters.add(counters.queueWaitNs, elapsedNs(waitBegin));
+  counters.add(counters.queueWaits, 1);
+  counters.add(counters.bytesDownloaded, size);
 }
 
 void Buffer::readAsync(void *outputData, size_t size, size_t offset,
@@ -105,24 +386,77 @@ void Buffer::readAsync(void *outputData, size_t size, size_t offset,
 }
 
 void Buffer::setData(const float *inputData, size_t byteSize) {
+  MGPU_TRACE_SCOPE(Upload, byteSize);
   // Check if we need to create or resize the buffer
   if (bufferData.buffer == nullptr || byteSize > bufferData.size) {
     createBuffer(byteSize);
   }
-  std::string bufferString = "mgpuSetBufferData: Buffer: ";
-  for (size_t i = 0; i < byteSize / sizeof(float); i++) {
-    bufferString += std::to_string(inputData[i]);
-    if (i < byteSize / sizeof(float) - 1) {
-      bufferString += ", ";
-    }
-  }
-  LOG(kDefLog, kInfo, bufferString.c_str());
+
+  // Queue writes run before the next submission, so recorded dispatches
+  // that still read the old contents are submitted first.
+  mgpu.flush();
 
   // Copy the input data to the buffer using gpu::toGPU
   gpu::toGPU(this->mgpu.getContext(), inputData, bufferData.buffer, byteSize);
+  stats().add(stats().bytesUploaded, byteSize);
+}
+
+bool Buffer::write(const void *data, size_t byteSize, size_t offset) {
+  if (bufferData.buffer == nullptr || offset + byteSize > bufferData.size) {
+    LOG(kDefLog, kError, "Write of [%zu, %zu) exceeds buffer size %zu", offset,
+        offset + byteSize, bufferData.size);
+    return false;
+  }
+  MGPU_TRACE_SCOPE(Upload, byteSize);
+  // Queue writes run before the next submission, so only recorded passes
+  // that touch this buffer have to be submitted first.
+  mgpu.flushIfPending(bufferData.buffer);
+  wgpuQueueWriteBuffer(mgpu.getContext().queue, bufferData.buffer, offset,
+                       data, byteSize);
+  stats().add(stats().bytesUploaded, byteSize);
+  return true;
+}
+
+bool Buffer::copyTo(const Buffer &dst, size_t srcOffset, size_t dstOffset,
+                    size_t byteSize) const {
+  if (srcOffset + byteSize > bufferData.size ||
+      dstOffset + byteSize > dst.bufferData.size) {
+    LOG(kDefLog, kError, "Copy of %zu bytes is out of buffer bounds",
+        byteSize);
+    return false;
+  }
+  mgpu.enqueue([&](WGPUCommandEncoder encoder) {
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, bufferData.buffer, srcOffset,
+                                         dst.bufferData.buffer, dstOffset,
+                                         byteSize);
+  }, {bufferData.buffer, dst.bufferData.buffer});
+  return true;
+}
 
+bool Buffer::clear(size_t offset, size_t byteSize) {
+  if (bufferData.buffer == nullptr || offset + byteSize > bufferData.size) {
+    LOG(kDefLog, kError, "Clear of [%zu, %zu) exceeds buffer size %zu", offset,
+        offset + byteSize, bufferData.size);
+    return false;
+  }
+  if (offset % 4 != 0 || byteSize % 4 != 0) {
+    LOG(kDefLog, kError, "Clear offset and size must be multiples of 4");
+    return false;
+  }
+  mgpu.enqueue([&](WGPUCommandEncoder encoder) {
+    wgpuCommandEncoderClearBuffer(encoder, bufferData.buffer, offset, byteSize);
+  }, {bufferData.buffer});
+  return true;
 }
 
-void Buffer::release() { wgpuBufferRelease(bufferData.buffer); }
+void Buffer::release() {
+  if (bufferData.buffer == nullptr) {
+    return;
+  }
+  wgpuBufferRelease(bufferData.buffer);
+  stats().bufferReleased(bufferData.size);
+  bufferData.buffer = nullptr;
+  bufferData.size = 0;
+}
 
 } // namespace mgpu
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "../include/compute_shader.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <sstream>
 #include <stdexcept>
 
@@ -12,6 +17,10 @@ void ComputeShader::loadKernelString(const std::string &kernelString) {
   code = KernelCode{kernelString, Shape{256, 1, 1}, kf32};
 }
 
+std::string ComputeShader::prepareSource(const std::string &kernelString) {
+  return KernelCode{kernelString, Shape{256, 1, 1}, kf32}.data;
+}
+
 void ComputeShader::loadKernelFile(const std::string &path) {
   std::ifstream file(path);
   if (!file.is_open()) {
@@ -24,39 +33,163 @@ void ComputeShader::loadKernelFile(const std::string &path) {
 
 bool ComputeShader::hasKernel() const { return !code.data.empty(); }
 
-void ComputeShader::setBuffer(int tag, const Buffer &buffer) {
-
+void ComputeShader::setBuffer(int tag, const Buffer &buffer, size_t offset,
+                              size_t size) {
   if (tag >= static_cast<int>(bindings.size())) {
     bindings.resize(tag + 1);
   }
-
-  // For the input buffer, we assume it's already been created properly.
-  // For output, if buffer.bufferData.size is zero, we use a fallback value.
-  size_t numElements = 0;
-  if (buffer.bufferData.buffer != nullptr && buffer.bufferData.size > 0) {
-    numElements = buffer.bufferData.size / sizeof(float);
+  if (size == 0 && offset < buffer.bufferData.size) {
+    size = buffer.bufferData.size - offset;
   }
-  Shape shape{numElements};
-
-  bindings[tag] = Tensor{.data = buffer.bufferData, .shape = shape};
+  if (offset + size > buffer.bufferData.size) {
+    LOG(kDefLog, kError, "Binding range [%zu, %zu) exceeds buffer size %zu",
+        offset, offset + size, buffer.bufferData.size);
+    return;
+  }
+  bindings[tag] = BufferBinding{buffer.bufferData.buffer, offset, size};
 }
 
 void ComputeShader::dispatch(int groupsX, int groupsY, int groupsZ) {
+  if (enqueue(groupsX, groupsY, groupsZ)) {
+    mgpu.sync();
+  }
+}
 
-  // create array of view offsets for tensor, size_t all 0
-  std::vector<size_t> viewOffsets(bindings.size(), 0);
-
+bool ComputeShader::enqueue(int groupsX, int groupsY, int groupsZ) {
   LOG(kDefLog, kInfo,
       "Dispatching kernel with groups: (%d, %d, %d) and bindings size: %zu",
       groupsX, groupsY, groupsZ, bindings.size());
 
-  Kernel kernel =
-      createKernel(mgpu.getContext(), code, bindings.data(), bindings.size(),
-                   viewOffsets.data(),
-                   {static_cast<size_t>(groupsX), static_cast<size_t>(groupsY),
-                    static_cast<size_t>(groupsZ)});
+  std::shared_ptr<CachedPipeline> pipeline =
+      mgpu.pipelines.acquire(mgpu.getContext(), code.data);
+  if (!pipeline) {
+    return false;
+  }
+  WGPUBindGroup bindGroup = createBindGroup(*pipeline);
+  if (!bindGroup) {
+    return false;
+  }
+
+  // A 1D grid past the per-dimension limit is folded into 2D, then 3D.
+  // Kernels launched this way recover their flat index from
+  // num_workgroups and skip the overshoot.
+  const int limit = static_cast<int>(mgpu.maxWorkgroupsPerDimension());
+  if (groupsY == 1 && groupsZ == 1 && groupsX > limit) {
+    int total = groupsX;
+    groupsX = limit;
+    groupsY = (total + limit - 1) / limit;
+    if (groupsY > limit) {
+      groupsZ = (groupsY + limit - 1) / limit;
+      groupsY = limit;
+    }
+  }
+
+  MGPU_TRACE_SCOPE(Dispatch, 0);
+  Stats &counters = stats();
+  counters.add(counters.dispatches, 1);
+  if (!mgpu.timingActive()) {
+    std::vector<WGPUBuffer> uses;
+    uses.reserve(pipeline->bindings.size());
+    for (uint32_t binding : pipeline->bindings) {
+      uses.push_back(bindings[binding].buffer);
+    }
+    mgpu.enqueue(
+        [&](WGPUCommandEncoder encoder) {
+          encodePass(encoder, *pipeline, bindGroup, groupsX, groupsY, groupsZ,
+                     nullptr);
+        },
+        uses);
+    // The recorded pass keeps its own references to the bind group and
+    // pipeline.
+    wgpuBindGroupRelease(bindGroup);
+    return true;
+  }
+
+  auto hostBegin = std::chrono::steady_clock::now();
+  uint64_t gpuNs = submitTimed(*pipeline, bindGroup, groupsX, groupsY, groupsZ);
+  uint64_t hostNs = elapsedNs(hostBegin);
+  wgpuBindGroupRelease(bindGroup);
+  counters.add(counters.queueWaitNs, hostNs);
+  counters.add(counters.queueWaits, 1);
+
+  lastGpuNs = gpuNs;
+  mgpu.timings.record(DispatchTiming{
+      .kernelHash = std::hash<std::string>{}(code.data),
+      .gpuNs = gpuNs,
+      .hostNs = hostNs,
+  });
+  // Already complete; nothing left to wait for.
+  return false;
+}
+
+WGPUBindGroup
+ComputeShader::createBindGroup(const CachedPipeline &pipeline) const {
+  std::vector<WGPUBindGroupEntry> entries;
+  entries.reserve(pipeline.bindings.size());
+  for (uint32_t binding : pipeline.bindings) {
+    if (binding >= bindings.size() || bindings[binding].buffer == nullptr) {
+      LOG(kDefLog, kError, "No buffer set for binding %u", binding);
+      return nullptr;
+    }
+    WGPUBindGroupEntry entry = {};
+    entry.binding = binding;
+    entry.buffer = bindings[binding].buffer;
+    entry.offset = bindings[binding].offset;
+    entry.size = bindings[binding].size;
+    entries.push_back(entry);
+  }
+  WGPUBindGroupDescriptor descriptor = {};
+  descriptor.layout = pipeline.layout;
+  descriptor.entryCount = entries.size();
+  descriptor.entries = entries.data();
+  return wgpuDeviceCreateBindGroup(mgpu.getContext().device, &descriptor);
+}
+
+void ComputeShader::encodePass(WGPUCommandEncoder encoder,
+                               const CachedPipeline &pipeline,
+                               WGPUBindGroup bindGroup, int groupsX,
+                               int groupsY, int groupsZ,
+                               WGPUComputePassTimestampWrites *timestamps) {
+  WGPUComputePassDescriptor passDescriptor = {};
+  passDescriptor.timestampWrites = timestamps;
+  WGPUComputePassEncoder pass =
+      wgpuCommandEncoderBeginComputePass(encoder, &passDescriptor);
+  wgpuComputePassEncoderSetPipeline(pass, pipeline.pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+  wgpuComputePassEncoderDispatchWorkgroups(pass, groupsX, groupsY, groupsZ);
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+}
 
-  dispatchKernel(mgpu.getContext(), kernel);
+// Submits one pass on its own, bracketed by timestamps, and waits for it.
+// Returns the elapsed GPU time of the pass.
+uint64_t ComputeShader::submitTimed(const CachedPipeline &pipeline,
+                                    WGPUBindGroup bindGroup, int groupsX,
+                                    int groupsY, int groupsZ) {
+  Context &ctx = mgpu.getContext();
+  // Earlier recorded work must not land inside the measured interval.
+  mgpu.flush();
+  std::lock_guard<std::mutex> timingLock(mgpu.timingMutex);
+  WGPUComputePassTimestampWrites timestampWrites = {};
+  timestampWrites.querySet = mgpu.timestampQuerySet();
+  timestampWrites.beginningOfPassWriteIndex = 0;
+  timestampWrites.endOfPassWriteIndex = 1;
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(ctx.device, nullptr);
+  encodePass(encoder, pipeline, bindGroup, groupsX, groupsY, groupsZ,
+             &timestampWrites);
+  wgpuCommandEncoderResolveQuerySet(encoder, timestampWrites.querySet, 0, 2,
+                                    mgpu.timestampResolveBuffer(), 0);
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuCommandEncoderRelease(encoder);
+  wgpuQueueSubmit(ctx.queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+
+  // toCPU copies after our submission, so this also waits for the kernel.
+  uint64_t ticks[2] = {0, 0};
+  toCPU(ctx, mgpu.timestampResolveBuffer(), ticks, sizeof(ticks));
+  // Timestamps are in nanoseconds; some drivers report them out of order.
+  return ticks[1] > ticks[0] ? ticks[1] - ticks[0] : 0;
 }
 
 void ComputeShader::dispatchAsync(int groupsX, int groupsY, int groupsZ,
@@ -66,4 +199,4 @@ void ComputeShader::dispatchAsync(int groupsX, int groupsY, int groupsZ,
     callback();
   }
 }
-} // namespace mgpu
\ No newline at end of file
+} // namespace mgpu
@@ -0,0 +1,250 @@
+#include "../include/disk_cache.h"
+#include "../include/gpuh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifndef MGPU_DAWN_COMMIT
+#define MGPU_DAWN_COMMIT "unknown"
+#endif
+
+using namespace gpu;
+namespace fs = std::filesystem;
+
+namespace mgpu {
+
+namespace {
+
+// Written once per version directory; only directories carrying it are
+// ever deleted, so pointing the cache at a shared folder is safe.
+constexpr const char *kMarkerName = ".minigpu-cache";
+constexpr char kMagic[4] = {'M', 'G', 'P', 'C'};
+
+struct EntryHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t keySize;
+  uint64_t valueSize;
+};
+
+uint64_t fnv1a(const void *data, size_t size) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = 1469598103934665603ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string hex(uint64_t value) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(value));
+  return buffer;
+}
+
+std::string versionName() {
+  return "v" + std::to_string(DiskCache::kFormatVersion) + "-" +
+         std::string(MGPU_DAWN_COMMIT).substr(0, 12);
+}
+
+} // namespace
+
+bool DiskCache::configure(const std::string &rootPath, uint64_t limit) {
+  std::lock_guard<std::mutex> lock(mutex);
+  root.clear();
+  dir.clear();
+  totalBytes = 0;
+  maxBytes = limit;
+  if (rootPath.empty() || limit == 0) {
+    return true;
+  }
+
+  std::error_code ec;
+  fs::create_directories(rootPath, ec);
+  if (ec) {
+    LOG(kDefLog, kError, "Failed to create cache directory %s: %s",
+        rootPath.c_str(), ec.message().c_str());
+    return false;
+  }
+  root = rootPath;
+
+  const std::string current = versionName();
+  for (const auto &entry : fs::directory_iterator(root, ec)) {
+    if (entry.is_directory() && entry.path().filename() != current &&
+        fs::exists(entry.path() / kMarkerName)) {
+      fs::remove_all(entry.path(), ec);
+    }
+  }
+  return true;
+}
+
+bool DiskCache::enabled() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !root.empty();
+}
+
+void DiskCache::selectAdapter(const std::string &adapterKey) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (root.empty()) {
+    return;
+  }
+  fs::path versionDir = root / versionName();
+  dir = versionDir / hex(fnv1a(adapterKey.data(), adapterKey.size()));
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  if (ec) {
+    LOG(kDefLog, kError, "Failed to create cache directory: %s",
+        ec.message().c_str());
+    dir.clear();
+    return;
+  }
+  std::ofstream(versionDir / kMarkerName).put('\n');
+
+  totalBytes = 0;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+      totalBytes += entry.file_size(ec);
+    }
+  }
+  evict(0);
+}
+
+fs::path DiskCache::entryPath(const void *key, size_t keySize) const {
+  return dir / (hex(fnv1a(key, keySize)) + ".bin");
+}
+
+size_t DiskCache::load(const void *key, size_t keySize, void *value,
+                       size_t valueSize) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (dir.empty()) {
+    return 0;
+  }
+  fs::path path = entryPath(key, keySize);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return 0;
+  }
+
+  EntryHeader header = {};
+  std::vector<char> storedKey(keySize);
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kFormatVersion || header.keySize != keySize) {
+    return 0;
+  }
+  file.read(storedKey.data(), keySize);
+  if (!file || std::memcmp(storedKey.data(), key, keySize) != 0) {
+    // A different key with the same hash; treat it as a miss.
+    return 0;
+  }
+  if (value == nullptr || valueSize < header.valueSize) {
+    return header.valueSize;
+  }
+  file.read(static_cast<char *>(value), header.valueSize);
+  if (!file) {
+    return 0;
+  }
+
+  // Refresh the entry so eviction sees it as recently used.
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return header.valueSize;
+}
+
+void DiskCache::store(const void *key, size_t keySize, const void *value,
+                      size_t valueSize) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (dir.empty()) {
+    return;
+  }
+  uint64_t entryBytes = sizeof(EntryHeader) + keySize + valueSize;
+  if (entryBytes > maxBytes) {
+    return;
+  }
+
+  fs::path path = entryPath(key, keySize);
+  std::error_code ec;
+  uint64_t previous = fs::exists(path, ec) ? fs::file_size(path, ec) : 0;
+  if (ec) {
+    previous = 0;
+  }
+  // The entry being replaced is counted out here, so eviction must not
+  // remove (and subtract) it a second time.
+  totalBytes -= std::min(totalBytes, previous);
+  evict(entryBytes, path);
+
+  // Write to a temporary file first so that readers in other processes
+  // never see a partial entry.
+  fs::path temp = path;
+  temp += ".tmp";
+  {
+    EntryHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.keySize = keySize;
+    header.valueSize = valueSize;
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(static_cast<const char *>(key), keySize);
+    file.write(static_cast<const char *>(value), valueSize);
+    if (!file) {
+      LOG(kDefLog, kError, "Failed to write cache entry %s",
+          temp.string().c_str());
+      file.close();
+      fs::remove(temp, ec);
+      totalBytes += previous;
+      return;
+    }
+  }
+  fs::rename(temp, path, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+    totalBytes += previous;
+    return;
+  }
+  totalBytes += entryBytes;
+}
+
+uint64_t DiskCache::sizeBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return totalBytes;
+}
+
+// Removes least recently used entries other than keep until incoming more
+// bytes fit. Called with the mutex held.
+void DiskCache::evict(uint64_t incoming, const fs::path &keep) {
+  if (totalBytes + incoming <= maxBytes) {
+    return;
+  }
+  struct Candidate {
+    fs::file_time_type time;
+    fs::path path;
+    uint64_t size;
+  };
+  std::vector<Candidate> candidates;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".bin" &&
+        entry.path() != keep) {
+      candidates.push_back(
+          {entry.last_write_time(ec), entry.path(), entry.file_size(ec)});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              return a.time < b.time;
+            });
+  for (const Candidate &candidate : candidates) {
+    if (totalBytes + incoming <= maxBytes) {
+      break;
+    }
+    if (fs::remove(candidate.path, ec)) {
+      totalBytes -= std::min(totalBytes, candidate.size);
+    }
+  }
+}
+
+} // namespace mgpu
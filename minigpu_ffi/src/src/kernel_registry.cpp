@@ -0,0 +1,60 @@
+#include "../include/kernel_registry.h"
+
+namespace mgpu {
+
+int KernelRegistry::add(const std::string &source) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = ids.find(source);
+  if (it != ids.end()) {
+    kernels[it->second].lastUse = ++useClock;
+    return it->second;
+  }
+  if (kernels.size() >= kMaxKernels) {
+    auto oldest = kernels.begin();
+    for (auto k = kernels.begin(); k != kernels.end(); ++k) {
+      if (k->second.lastUse < oldest->second.lastUse) {
+        oldest = k;
+      }
+    }
+    erase(oldest);
+  }
+  auto shader = std::make_shared<ComputeShader>(mgpu);
+  shader->loadKernelString(source);
+  int id = nextId++;
+  kernels.emplace(id, Entry{std::move(shader), source, ++useClock});
+  ids.emplace(source, id);
+  return id;
+}
+
+std::shared_ptr<ComputeShader> KernelRegistry::get(int id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = kernels.find(id);
+  if (it == kernels.end()) {
+    return nullptr;
+  }
+  it->second.lastUse = ++useClock;
+  return it->second.shader;
+}
+
+void KernelRegistry::release(int id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = kernels.find(id);
+  if (it != kernels.end()) {
+    erase(it);
+  }
+}
+
+void KernelRegistry::erase(std::unordered_map<int, Entry>::iterator it) {
+  // Dispatches already recorded hold their own pipeline reference.
+  mgpu.pipelines.erase(ComputeShader::prepareSource(it->second.source));
+  ids.erase(it->second.source);
+  kernels.erase(it);
+}
+
+void KernelRegistry::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  ids.clear();
+  kernels.clear();
+}
+
+} // namespace mgpu
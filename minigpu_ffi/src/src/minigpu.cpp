@@ -1,4 +1,9 @@
 #include "../include/minigpu.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #ifdef __cplusplus
 using namespace mgpu;
 using namespace gpu;
@@ -6,19 +11,190 @@ extern "C" {
 #endif
 
 MGPU minigpu;
+mgpu::KernelRegistry kernelRegistry(minigpu);
 
+// Kernel ids refer to the device they were registered on, so a new
+// context starts with an empty registry.
 void mgpuInitializeContext() {
+  kernelRegistry.clear();
   minigpu.initializeContext();
   setLogLevel(4);
 }
 
 void mgpuInitializeContextAsync(MGPUCallback callback) {
-
+  kernelRegistry.clear();
   minigpu.initializeContextAsync(callback);
   setLogLevel(4);
 }
 
-void mgpuDestroyContext() { minigpu.destroyContext(); }
+void mgpuDestroyContext() {
+  kernelRegistry.clear();
+  minigpu.destroyContext();
+}
+
+namespace {
+
+const std::pair<int, WGPUFeatureName> kFeatures[] = {
+    {MGPU_FEATURE_SHADER_F16, WGPUFeatureName_ShaderF16},
+    {MGPU_FEATURE_SUBGROUPS, WGPUFeatureName_Subgroups},
+    {MGPU_FEATURE_TIMESTAMP_QUERY, WGPUFeatureName_TimestampQuery},
+};
+
+std::vector<WGPUFeatureName> featureNames(uint32_t bits) {
+  std::vector<WGPUFeatureName> names;
+  for (const auto &[bit, name] : kFeatures) {
+    if (bits & bit) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+void copyString(char *dst, size_t capacity, const std::string &src) {
+  size_t length = std::min(src.size(), capacity - 1);
+  memcpy(dst, src.data(), length);
+  dst[length] = '\0';
+}
+
+} // namespace
+
+void mgpuGetDefaultContextOptions(MGPUContextOptions *options) {
+  if (!options) {
+    LOG(kDefLog, kError, "Invalid options pointer (null)");
+    return;
+  }
+  *options = MGPUContextOptions{};
+  options->optionalFeatures = MGPU_FEATURE_TIMESTAMP_QUERY;
+}
+
+int mgpuInitializeContextWithOptions(const MGPUContextOptions *options) {
+  if (!options) {
+    LOG(kDefLog, kError, "Invalid options pointer (null)");
+    return 0;
+  }
+  mgpu::ContextOptions contextOptions;
+  switch (options->powerPreference) {
+  case MGPU_POWER_LOW:
+    contextOptions.powerPreference = WGPUPowerPreference_LowPower;
+    break;
+  case MGPU_POWER_HIGH_PERFORMANCE:
+    contextOptions.powerPreference = WGPUPowerPreference_HighPerformance;
+    break;
+  default:
+    break;
+  }
+  contextOptions.requiredFeatures = featureNames(options->requiredFeatures);
+  contextOptions.optionalFeatures = featureNames(options->optionalFeatures);
+  contextOptions.useAdapterLimits = options->useAdapterLimits != 0;
+  contextOptions.maxStorageBufferBindingSize =
+      options->maxStorageBufferBindingSize;
+  contextOptions.maxBufferSize = options->maxBufferSize;
+  for (int i = 0; i < options->enabledToggleCount; i++) {
+    contextOptions.enabledToggles.push_back(options->enabledToggles[i]);
+  }
+  for (int i = 0; i < options->disabledToggleCount; i++) {
+    contextOptions.disabledToggles.push_back(options->disabledToggles[i]);
+  }
+  if (options->skipValidation) {
+    contextOptions.enabledToggles.push_back("skip_validation");
+  }
+
+  kernelRegistry.clear();
+  bool ok = minigpu.initializeContext(contextOptions);
+  setLogLevel(4);
+  return ok ? 1 : 0;
+}
+
+int mgpuGetAdapterInfo(MGPUAdapterInfo *info) {
+  if (!info) {
+    LOG(kDefLog, kError, "Invalid adapter info pointer (null)");
+    return 0;
+  }
+  if (!minigpu.hasContext()) {
+    return 0;
+  }
+  mgpu::AdapterInfo adapter = minigpu.adapterInfo();
+  *info = MGPUAdapterInfo{};
+  copyString(info->vendor, sizeof(info->vendor), adapter.vendor);
+  copyString(info->architecture, sizeof(info->architecture),
+             adapter.architecture);
+  copyString(info->device, sizeof(info->device), adapter.device);
+  copyString(info->description, sizeof(info->description),
+             adapter.description);
+  info->backendType = static_cast<int>(adapter.backendType);
+  info->adapterType = static_cast<int>(adapter.adapterType);
+  info->vendorID = adapter.vendorID;
+  info->deviceID = adapter.deviceID;
+  return 1;
+}
+
+int mgpuGetLimits(MGPULimits *limits) {
+  if (!limits) {
+    LOG(kDefLog, kError, "Invalid limits pointer (null)");
+    return 0;
+  }
+  if (!minigpu.hasContext()) {
+    return 0;
+  }
+  WGPULimits device = minigpu.limits();
+  *limits = MGPULimits{
+      .maxBufferSize = device.maxBufferSize,
+      .maxStorageBufferBindingSize = device.maxStorageBufferBindingSize,
+      .maxStorageBuffersPerShaderStage = device.maxStorageBuffersPerShaderStage,
+      .maxComputeWorkgroupStorageSize = device.maxComputeWorkgroupStorageSize,
+      .maxComputeInvocationsPerWorkgroup =
+          device.maxComputeInvocationsPerWorkgroup,
+      .maxComputeWorkgroupSizeX = device.maxComputeWorkgroupSizeX,
+      .maxComputeWorkgroupSizeY = device.maxComputeWorkgroupSizeY,
+      .maxComputeWorkgroupSizeZ = device.maxComputeWorkgroupSizeZ,
+      .maxComputeWorkgroupsPerDimension =
+          device.maxComputeWorkgroupsPerDimension,
+      .minStorageBufferOffsetAlignment =
+          device.minStorageBufferOffsetAlignment,
+  };
+  return 1;
+}
+
+int mgpuHasFeature(int feature) {
+  for (const auto &[bit, name] : kFeatures) {
+    if (bit == feature) {
+      return minigpu.hasFeature(name) ? 1 : 0;
+    }
+  }
+  return 0;
+}
+
+void mgpuEnqueueDispatch(MGPUComputeShader *shader, int groupsX, int groupsY,
+                         int groupsZ) {
+  if (shader) {
+    reinterpret_cast<mgpu::ComputeShader *>(shader)->enqueue(groupsX, groupsY,
+                                                             groupsZ);
+  } else {
+    LOG(kDefLog, kError, "Invalid shader or kernel pointer");
+  }
+}
+
+void mgpuFlush() {
+  if (minigpu.hasContext()) {
+    minigpu.flush();
+  }
+}
+
+void mgpuSync() {
+  if (minigpu.hasContext()) {
+    minigpu.sync();
+  }
+}
+
+void mgpuSyncAsync(MGPUCallback callback) {
+  if (!minigpu.hasContext()) {
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+  minigpu.syncAsync(callback);
+}
 
 MGPUComputeShader *mgpuCreateComputeShader() {
   return reinterpret_cast<MGPUComputeShader *>(
@@ -58,7 +234,7 @@ int mgpuHasKernel(MGPUComputeShader *shader) {
   }
 }
 
-MGPUBuffer *mgpuCreateBuffer(int bufferSize) {
+MGPUBuffer *mgpuCreateBuffer(size_t bufferSize) {
   auto *buf = new mgpu::Buffer(minigpu);
   buf->createBuffer(bufferSize);
   return reinterpret_cast<MGPUBuffer *>(buf);
@@ -82,6 +258,16 @@ void mgpuSetBuffer(MGPUComputeShader *shader, int tag, MGPUBuffer *buffer) {
   }
 }
 
+void mgpuSetBufferRange(MGPUComputeShader *shader, int tag, MGPUBuffer *buffer,
+                        size_t offset, size_t size) {
+  if (shader && tag >= 0 && buffer) {
+    reinterpret_cast<mgpu::ComputeShader *>(shader)->setBuffer(
+        tag, *reinterpret_cast<mgpu::Buffer *>(buffer), offset, size);
+  } else {
+    LOG(kDefLog, kError, "Invalid shader, or buffer pointer");
+  }
+}
+
 void mgpuDispatch(MGPUComputeShader *shader, int groupsX, int groupsY,
                   int groupsZ) {
   if (shader) {
@@ -131,6 +317,238 @@ void mgpuSetBufferData(MGPUBuffer *buffer, const float *inputData,
   }
 }
 
+void mgpuClearBuffer(MGPUBuffer *buffer, size_t offset, size_t byteSize) {
+  if (!buffer) {
+    LOG(kDefLog, kError, "Invalid buffer pointer");
+    return;
+  }
+  auto *buf = reinterpret_cast<mgpu::Buffer *>(buffer);
+  if (byteSize == 0 && offset < buf->bufferData.size) {
+    byteSize = buf->bufferData.size - offset;
+  }
+  buf->clear(offset, byteSize);
+}
+
+int mgpuRegisterKernel(const char *kernelString) {
+  if (!kernelString || strlen(kernelString) == 0) {
+    LOG(kDefLog, kError, "Invalid or empty kernel string");
+    return -1;
+  }
+  return kernelRegistry.add(kernelString);
+}
+
+void mgpuReleaseKernel(int kernel) { kernelRegistry.release(kernel); }
+
+namespace {
+
+bool executeCommand(const MGPUCommand &command) {
+  auto *buffer = reinterpret_cast<mgpu::Buffer *>(command.buffer);
+  switch (command.type) {
+  case MGPU_COMMAND_BIND: {
+    std::shared_ptr<mgpu::ComputeShader> shader =
+        kernelRegistry.get(command.kernel);
+    if (!shader || !buffer) {
+      return false;
+    }
+    shader->setBuffer(command.binding, *buffer, command.offset, command.size);
+    return true;
+  }
+  case MGPU_COMMAND_DISPATCH: {
+    std::shared_ptr<mgpu::ComputeShader> shader =
+        kernelRegistry.get(command.kernel);
+    if (!shader) {
+      return false;
+    }
+    shader->enqueue(command.groups[0], command.groups[1], command.groups[2]);
+    return true;
+  }
+  case MGPU_COMMAND_COPY: {
+    auto *target = reinterpret_cast<mgpu::Buffer *>(command.target);
+    return buffer && target &&
+           buffer->copyTo(*target, command.offset, command.targetOffset,
+                          command.size);
+  }
+  case MGPU_COMMAND_UPLOAD:
+    return buffer && command.data &&
+           buffer->write(command.data, command.size, command.offset);
+  }
+  return false;
+}
+
+} // namespace
+
+int mgpuExecuteCommands(const MGPUCommand *commands, int count) {
+  if (!commands || !minigpu.hasContext()) {
+    return 0;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!executeCommand(commands[i])) {
+      LOG(kDefLog, kError, "Command %d (type %u) is invalid", i,
+          commands[i].type);
+      return i;
+    }
+  }
+  return count;
+}
+
+float *mgpuAllocHostBuffer(size_t byteSize) {
+  constexpr size_t kAlignment = 64;
+  // aligned_alloc needs a size that is a multiple of the alignment.
+  size_t size = std::max<size_t>(
+      (byteSize + kAlignment - 1) / kAlignment * kAlignment, kAlignment);
+#ifdef _WIN32
+  void *ptr = _aligned_malloc(size, kAlignment);
+#else
+  void *ptr = std::aligned_alloc(kAlignment, size);
+#endif
+  if (ptr == nullptr) {
+    LOG(kDefLog, kError, "Failed to allocate %zu bytes of host memory",
+        byteSize);
+  }
+  return static_cast<float *>(ptr);
+}
+
+void mgpuFreeHostBuffer(void *ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+int mgpuTimingSupported() { return minigpu.timestampsSupported() ? 1 : 0; }
+
+void mgpuSetTimingEnabled(int enabled) {
+  if (enabled && !minigpu.timestampsSupported()) {
+    LOG(kDefLog, kError, "Timestamp queries are not supported by this adapter");
+  }
+  minigpu.setTimingEnabled(enabled != 0);
+}
+
+int mgpuGetLastDispatchTiming(MGPUDispatchTiming *timing) {
+  if (!timing) {
+    LOG(kDefLog, kError, "Invalid timing pointer (null)");
+    return 0;
+  }
+  mgpu::DispatchTiming last;
+  if (!minigpu.timings.last(last)) {
+    return 0;
+  }
+  *timing = MGPUDispatchTiming{last.kernelHash, last.gpuNs, last.hostNs};
+  return 1;
+}
+
+uint64_t mgpuGetShaderLastGpuTimeNs(MGPUComputeShader *shader) {
+  if (!shader) {
+    LOG(kDefLog, kError, "Invalid shader pointer");
+    return 0;
+  }
+  return reinterpret_cast<mgpu::ComputeShader *>(shader)->lastGpuTimeNs();
+}
+
+int mgpuGetKernelTimingStats(MGPUKernelTimingStats *stats, int capacity) {
+  if (!stats) {
+    return static_cast<int>(minigpu.timings.size());
+  }
+  if (capacity <= 0) {
+    return 0;
+  }
+  std::vector<mgpu::KernelTimingStats> rows(capacity);
+  size_t count = minigpu.timings.snapshot(rows.data(), rows.size());
+  for (size_t i = 0; i < count; i++) {
+    stats[i] = MGPUKernelTimingStats{rows[i].kernelHash, rows[i].count,
+                                     rows[i].meanNs, rows[i].p99Ns};
+  }
+  return static_cast<int>(count);
+}
+
+void mgpuResetTimingStats() { minigpu.timings.reset(); }
+
+int mgpuSetCacheOptions(const char *dir, uint64_t maxBytes) {
+  return minigpu.diskCache.configure(dir ? dir : "", maxBytes) ? 1 : 0;
+}
+
+void mgpuPrecompile(const char **kernels, int count, MGPUCallback callback) {
+  // The callback always runs, so callers waiting on it are released even
+  // when there is nothing to compile.
+  if (!kernels && count > 0) {
+    LOG(kDefLog, kError, "Invalid kernels pointer (null)");
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+  if (!minigpu.hasContext()) {
+    LOG(kDefLog, kError, "No GPU context to precompile kernels on");
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+  std::vector<std::string> sources;
+  for (int i = 0; i < count; i++) {
+    if (kernels[i] && strlen(kernels[i]) > 0) {
+      sources.push_back(mgpu::ComputeShader::prepareSource(kernels[i]));
+    }
+  }
+  minigpu.pipelines.precompile(minigpu.getContext(), std::move(sources),
+                               callback);
+}
+
+void mgpuGetStats(MGPUStats *out) {
+  if (!out) {
+    LOG(kDefLog, kError, "Invalid stats pointer (null)");
+    return;
+  }
+  const mgpu::Stats &counters = mgpu::stats();
+  auto read = [](const std::atomic<uint64_t> &counter) {
+    return counter.load(std::memory_order_relaxed);
+  };
+  *out = MGPUStats{
+      .liveBuffers = read(counters.liveBuffers),
+      .liveBytes = read(counters.liveBytes),
+      .peakBytes = read(counters.peakBytes),
+      .bytesUploaded = read(counters.bytesUploaded),
+      .bytesDownloaded = read(counters.bytesDownloaded),
+      .dispatches = read(counters.dispatches),
+      .compiles = read(counters.compiles),
+      .compileNs = read(counters.compileNs),
+      .pipelineCacheHits = read(counters.pipelineCacheHits),
+      .queueWaits = read(counters.queueWaits),
+      .queueWaitNs = read(counters.queueWaitNs),
+      .avgQueueWaitNs = 0,
+  };
+  if (out->queueWaits > 0) {
+    out->avgQueueWaitNs =
+        static_cast<double>(out->queueWaitNs) / out->queueWaits;
+  }
+}
+
+void mgpuResetStats() { mgpu::stats().reset(); }
+
+void mgpuSetTraceEnabled(int enabled) {
+#ifndef MGPU_TRACE
+  if (enabled) {
+    LOG(kDefLog, kError, "Tracing was compiled out; rebuild with MGPU_TRACE");
+  }
+#endif
+  mgpu::trace::setEnabled(enabled != 0);
+}
+
+int mgpuDumpTrace(const char *path) {
+  if (!path) {
+    LOG(kDefLog, kError, "Invalid trace path pointer (null)");
+    return 0;
+  }
+  if (!mgpu::trace::dump(path)) {
+    LOG(kDefLog, kError, "Failed to write trace to %s", path);
+    return 0;
+  }
+  return 1;
+}
+
+void mgpuClearTrace() { mgpu::trace::clear(); }
+
 #ifdef __cplusplus
 }
 #endif // extern "C"
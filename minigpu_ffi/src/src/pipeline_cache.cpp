@@ -0,0 +1,376 @@
+#include "../include/pipeline_cache.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+using namespace gpu;
+
+namespace mgpu {
+
+namespace {
+
+struct BindingDecl {
+  uint32_t binding;
+  WGPUBufferBindingType type;
+};
+
+// Copy of source with comments blanked out, so declarations that are
+// commented out are not taken for bindings. WGSL block comments nest.
+std::string stripComments(const std::string &source) {
+  std::string out = source;
+  int depth = 0;
+  for (size_t i = 0; i < out.size(); i++) {
+    if (depth == 0 && out.compare(i, 2, "//") == 0) {
+      for (; i < out.size() && out[i] != '\n'; i++) {
+        out[i] = ' ';
+      }
+    } else if (out.compare(i, 2, "/*") == 0) {
+      depth++;
+      out[i] = out[i + 1] = ' ';
+      i++;
+    } else if (depth > 0 && out.compare(i, 2, "*/") == 0) {
+      depth--;
+      out[i] = out[i + 1] = ' ';
+      i++;
+    } else if (depth > 0 && out[i] != '\n') {
+      out[i] = ' ';
+    }
+  }
+  return out;
+}
+
+// Reads the integer argument of an attribute such as "@binding(" whose
+// name ends just before pos. Returns false unless it is a plain decimal
+// literal (optionally suffixed with u or i) followed by ')'.
+bool parseAttribute(const std::string &text, size_t pos, uint32_t &value) {
+  auto skipSpaces = [&]() {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(
+                                    text[pos]))) {
+      pos++;
+    }
+  };
+  skipSpaces();
+  uint64_t parsed = 0;
+  size_t digits = 0;
+  for (; pos < text.size() && std::isdigit(static_cast<unsigned char>(
+                                   text[pos]));
+       pos++, digits++) {
+    parsed = parsed * 10 + (text[pos] - '0');
+    if (parsed > UINT32_MAX) {
+      return false;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (pos < text.size() && (text[pos] == 'u' || text[pos] == 'i')) {
+    pos++;
+  }
+  skipSpaces();
+  if (pos >= text.size() || text[pos] != ')') {
+    return false;
+  }
+  value = static_cast<uint32_t>(parsed);
+  return true;
+}
+
+// Reads the buffer bindings of @group(0) from WGSL source. Each
+// "@binding(N)" is matched with the "@group" attribute and the var<...>
+// declaration of the same statement. Anything that does not parse as a
+// buffer declaration is skipped; this never throws.
+std::vector<BindingDecl> parseBindings(const std::string &source) {
+  const std::string text = stripComments(source);
+  std::vector<BindingDecl> decls;
+  const std::string marker = "@binding(";
+  const std::string groupMarker = "@group(";
+  for (size_t pos = text.find(marker); pos != std::string::npos;
+       pos = text.find(marker, pos + 1)) {
+    uint32_t binding = 0;
+    if (!parseAttribute(text, pos + marker.size(), binding)) {
+      continue;
+    }
+    // The statement runs from the previous ';' or brace to the next ';'.
+    size_t begin = text.find_last_of(";{}", pos);
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    size_t end = text.find(';', pos);
+    if (end == std::string::npos) {
+      continue;
+    }
+    size_t groupPos = text.find(groupMarker, begin);
+    uint32_t group = 0;
+    if (groupPos == std::string::npos || groupPos > end ||
+        !parseAttribute(text, groupPos + groupMarker.size(), group) ||
+        group != 0) {
+      continue;
+    }
+    // Buffers are declared var<...>; textures and samplers plain var.
+    size_t open = text.find("var", pos);
+    if (open == std::string::npos || open > end) {
+      continue;
+    }
+    open = text.find_first_not_of(" \t\r\n", open + 3);
+    if (open == std::string::npos || text[open] != '<') {
+      continue;
+    }
+    size_t close = text.find('>', open);
+    if (close == std::string::npos || close > end) {
+      continue;
+    }
+    std::string qualifier = text.substr(open + 1, close - open - 1);
+    qualifier.erase(std::remove_if(qualifier.begin(), qualifier.end(),
+                                   [](unsigned char c) {
+                                     return std::isspace(c);
+                                   }),
+                    qualifier.end());
+    WGPUBufferBindingType type = WGPUBufferBindingType_Storage;
+    if (qualifier == "uniform") {
+      type = WGPUBufferBindingType_Uniform;
+    } else if (qualifier == "storage" || qualifier == "storage,read") {
+      type = WGPUBufferBindingType_ReadOnlyStorage;
+    }
+    decls.push_back({binding, type});
+  }
+  std::sort(decls.begin(), decls.end(),
+            [](const BindingDecl &a, const BindingDecl &b) {
+              return a.binding < b.binding;
+            });
+  decls.erase(std::unique(decls.begin(), decls.end(),
+                          [](const BindingDecl &a, const BindingDecl &b) {
+                            return a.binding == b.binding;
+                          }),
+              decls.end());
+  return decls;
+}
+
+// Everything a compute pipeline descriptor points at. The module and the
+// pipeline layout are only needed until the create call returns.
+struct PipelineParts {
+  WGPUShaderModule module = nullptr;
+  WGPUPipelineLayout pipelineLayout = nullptr;
+  WGPUComputePipelineDescriptor descriptor = {};
+
+  PipelineParts() = default;
+  PipelineParts(const PipelineParts &) = delete;
+  PipelineParts &operator=(const PipelineParts &) = delete;
+  ~PipelineParts() {
+    if (pipelineLayout) {
+      wgpuPipelineLayoutRelease(pipelineLayout);
+    }
+    if (module) {
+      wgpuShaderModuleRelease(module);
+    }
+  }
+};
+
+// Creates the shader module and an explicit bind group layout for source,
+// storing the layout and binding numbers in entry.
+void prepare(WGPUDevice device, const std::string &source,
+             CachedPipeline &entry, PipelineParts &parts) {
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {.data = source.data(), .length = source.size()};
+  WGPUShaderModuleDescriptor moduleDescriptor = {};
+  moduleDescriptor.nextInChain = &wgsl.chain;
+  parts.module = wgpuDeviceCreateShaderModule(device, &moduleDescriptor);
+
+  std::vector<WGPUBindGroupLayoutEntry> layoutEntries;
+  for (const BindingDecl &decl : parseBindings(source)) {
+    WGPUBindGroupLayoutEntry layoutEntry = {};
+    layoutEntry.binding = decl.binding;
+    layoutEntry.visibility = WGPUShaderStage_Compute;
+    layoutEntry.buffer.type = decl.type;
+    layoutEntries.push_back(layoutEntry);
+    entry.bindings.push_back(decl.binding);
+  }
+  WGPUBindGroupLayoutDescriptor layoutDescriptor = {};
+  layoutDescriptor.entryCount = layoutEntries.size();
+  layoutDescriptor.entries = layoutEntries.data();
+  entry.layout = wgpuDeviceCreateBindGroupLayout(device, &layoutDescriptor);
+
+  WGPUPipelineLayoutDescriptor pipelineLayoutDescriptor = {};
+  pipelineLayoutDescriptor.bindGroupLayoutCount = 1;
+  pipelineLayoutDescriptor.bindGroupLayouts = &entry.layout;
+  parts.pipelineLayout =
+      wgpuDeviceCreatePipelineLayout(device, &pipelineLayoutDescriptor);
+
+  parts.descriptor.layout = parts.pipelineLayout;
+  parts.descriptor.compute.module = parts.module;
+  parts.descriptor.compute.entryPoint = {.data = "main",
+                                         .length = WGPU_STRLEN};
+}
+
+struct PendingCompile {
+  PipelineCache *cache;
+  std::string source;
+  std::shared_ptr<CachedPipeline> entry;
+  std::shared_ptr<std::atomic<size_t>> remaining;
+  std::chrono::steady_clock::time_point begin;
+};
+
+} // namespace
+
+CachedPipeline::~CachedPipeline() {
+  if (pipeline) {
+    wgpuComputePipelineRelease(pipeline);
+  }
+  if (layout) {
+    wgpuBindGroupLayoutRelease(layout);
+  }
+}
+
+std::shared_ptr<CachedPipeline>
+PipelineCache::acquire(Context &ctx, const std::string &source) {
+  Stats &counters = stats();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(source);
+    if (it != entries.end()) {
+      it->second.lastUse = ++useClock;
+      counters.add(counters.pipelineCacheHits, 1);
+      return it->second.pipeline;
+    }
+  }
+
+  // Compile outside the lock so other kernels are not held up.
+  MGPU_TRACE_SCOPE(Compile, source.size());
+  auto begin = std::chrono::steady_clock::now();
+  auto entry = std::make_shared<CachedPipeline>();
+  {
+    PipelineParts parts;
+    prepare(ctx.device, source, *entry, parts);
+    entry->pipeline =
+        wgpuDeviceCreateComputePipeline(ctx.device, &parts.descriptor);
+  }
+  counters.add(counters.compileNs, elapsedNs(begin));
+  counters.add(counters.compiles, 1);
+  if (entry->pipeline == nullptr) {
+    LOG(kDefLog, kError, "Failed to create compute pipeline");
+    return nullptr;
+  }
+  return insert(source, std::move(entry));
+}
+
+void PipelineCache::precompile(Context &ctx, std::vector<std::string> sources,
+                               std::function<void()> done) {
+  joinWorkers(/*finishedOnly=*/true);
+  auto remaining = std::make_shared<std::atomic<size_t>>(0);
+  for (const std::string &source : sources) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (entries.count(source)) {
+        continue;
+      }
+    }
+    auto *pending = new PendingCompile{this, source,
+                                       std::make_shared<CachedPipeline>(),
+                                       remaining,
+                                       std::chrono::steady_clock::now()};
+    PipelineParts parts;
+    prepare(ctx.device, source, *pending->entry, parts);
+
+    WGPUCreateComputePipelineAsyncCallbackInfo callbackInfo = {};
+    callbackInfo.mode = WGPUCallbackMode_AllowProcessEvents;
+    callbackInfo.callback = [](WGPUCreatePipelineAsyncStatus status,
+                               WGPUComputePipeline pipeline,
+                               WGPUStringView message, void *userdata1,
+                               void *) {
+      std::unique_ptr<PendingCompile> pending(
+          static_cast<PendingCompile *>(userdata1));
+      Stats &counters = stats();
+      counters.add(counters.compileNs, elapsedNs(pending->begin));
+      counters.add(counters.compiles, 1);
+      if (status == WGPUCreatePipelineAsyncStatus_Success) {
+        pending->entry->pipeline = pipeline;
+        pending->cache->insert(pending->source, pending->entry);
+      } else {
+        LOG(kDefLog, kError, "Failed to precompile kernel: %.*s",
+            static_cast<int>(message.length), message.data);
+      }
+      pending->remaining->fetch_sub(1);
+    };
+    callbackInfo.userdata1 = pending;
+    remaining->fetch_add(1);
+    wgpuDeviceCreateComputePipelineAsync(ctx.device, &parts.descriptor,
+                                         callbackInfo);
+  }
+
+  // Only waiting happens off the calling thread. Callbacks may also fire
+  // from another thread's processEvents (e.g. a sync); either way the
+  // counter drops to zero.
+  auto finished = std::make_shared<std::atomic<bool>>(false);
+  std::thread thread([instance = ctx.instance, remaining, finished,
+                      done = std::move(done)]() {
+    while (remaining->load() > 0) {
+      processEvents(instance);
+    }
+    if (done) {
+      done();
+    }
+    finished->store(true);
+  });
+  std::lock_guard<std::mutex> lock(workersMutex);
+  workers.push_back(Worker{std::move(thread), std::move(finished)});
+}
+
+void PipelineCache::joinWorkers(bool finishedOnly) {
+  std::vector<Worker> joining;
+  {
+    std::lock_guard<std::mutex> lock(workersMutex);
+    auto split = std::partition(
+        workers.begin(), workers.end(), [finishedOnly](const Worker &worker) {
+          return finishedOnly && !worker.finished->load();
+        });
+    joining.assign(std::make_move_iterator(split),
+                   std::make_move_iterator(workers.end()));
+    workers.erase(split, workers.end());
+  }
+  for (Worker &worker : joining) {
+    worker.thread.join();
+  }
+}
+
+std::shared_ptr<CachedPipeline>
+PipelineCache::insert(const std::string &source,
+                      std::shared_ptr<CachedPipeline> pipeline) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Another thread may have compiled the same source in the meantime.
+  auto [it, inserted] = entries.emplace(source, Entry{std::move(pipeline)});
+  it->second.lastUse = ++useClock;
+  if (inserted && entries.size() > kMaxEntries) {
+    auto oldest = entries.end();
+    for (auto e = entries.begin(); e != entries.end(); ++e) {
+      if (e != it && (oldest == entries.end() ||
+                      e->second.lastUse < oldest->second.lastUse)) {
+        oldest = e;
+      }
+    }
+    // Passes already recorded hold their own reference to the pipeline.
+    entries.erase(oldest);
+  }
+  return it->second.pipeline;
+}
+
+size_t PipelineCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void PipelineCache::erase(const std::string &source) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(source);
+}
+
+void PipelineCache::clear() {
+  // Pending callbacks insert into entries, so wait for them first.
+  joinWorkers(/*finishedOnly=*/false);
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+}
+
+} // namespace mgpu
@@ -0,0 +1,10 @@
+#include "../include/stats.h"
+
+namespace mgpu {
+
+Stats &stats() {
+  static Stats instance;
+  return instance;
+}
+
+} // namespace mgpu
@@ -0,0 +1,63 @@
+#include "../include/timing.h"
+
+#include <algorithm>
+
+namespace mgpu {
+
+void TimingRegistry::record(const DispatchTiming &timing) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Entry &entry = entries[timing.kernelHash];
+  entry.count++;
+  entry.totalNs += static_cast<double>(timing.gpuNs);
+  if (entry.samples.size() < kSamplesPerKernel) {
+    entry.samples.push_back(timing.gpuNs);
+  } else {
+    entry.samples[entry.next] = timing.gpuNs;
+    entry.next = (entry.next + 1) % kSamplesPerKernel;
+  }
+  lastTiming = timing;
+  hasLast = true;
+}
+
+bool TimingRegistry::last(DispatchTiming &out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!hasLast) {
+    return false;
+  }
+  out = lastTiming;
+  return true;
+}
+
+size_t TimingRegistry::snapshot(KernelTimingStats *out,
+                                size_t capacity) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t written = 0;
+  for (const auto &[hash, entry] : entries) {
+    if (written == capacity) {
+      break;
+    }
+    std::vector<uint64_t> sorted = entry.samples;
+    size_t rank = (sorted.size() * 99 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    out[written++] = KernelTimingStats{
+        .kernelHash = hash,
+        .count = entry.count,
+        .meanNs = entry.totalNs / static_cast<double>(entry.count),
+        .p99Ns = static_cast<double>(sorted[rank]),
+    };
+  }
+  return written;
+}
+
+size_t TimingRegistry::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void TimingRegistry::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  hasLast = false;
+}
+
+} // namespace mgpu
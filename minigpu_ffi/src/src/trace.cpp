@@ -0,0 +1,184 @@
+#include "../include/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mgpu {
+namespace trace {
+
+namespace {
+
+constexpr size_t kRingCapacity = 4096;
+
+// One ring entry. seq is a per-slot seqlock: odd while the owner writes,
+// 2 * (n + 1) once it holds the n-th span of the ring, so a reader can tell
+// both a torn read and a slot that has since moved on to a later span. The
+// fields are relaxed atomics so the concurrent reads are not data races.
+struct Slot {
+  std::atomic<uint64_t> seq{0};
+  std::atomic<uint64_t> beginNs{0};
+  std::atomic<uint64_t> endNs{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint8_t> event{0};
+};
+
+// Single-writer ring. Only the owning thread writes spans; dump() copies
+// them out through the slot seqlocks while the owner keeps recording.
+// clear() only moves start forward, so head is never written by another
+// thread.
+struct Ring {
+  Slot slots[kRingCapacity];
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> start{0};
+  std::atomic<bool> owned{true};
+  uint32_t tid = 0;
+};
+
+// Copies span n of ring into out. Returns false if the slot was being
+// written or already holds a later span.
+bool readSpan(const Ring &ring, uint64_t n, Span &out) {
+  const Slot &slot = ring.slots[n % kRingCapacity];
+  uint64_t expected = 2 * (n + 1);
+  if (slot.seq.load(std::memory_order_acquire) != expected) {
+    return false;
+  }
+  out = Span{slot.beginNs.load(std::memory_order_relaxed),
+             slot.endNs.load(std::memory_order_relaxed),
+             slot.bytes.load(std::memory_order_relaxed),
+             static_cast<Event>(slot.event.load(std::memory_order_relaxed))};
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.seq.load(std::memory_order_relaxed) == expected;
+}
+
+std::atomic<bool> gEnabled{false};
+std::atomic<uint32_t> gNextTid{1};
+const std::chrono::steady_clock::time_point gEpoch =
+    std::chrono::steady_clock::now();
+
+// Registration happens once per thread, so a mutex is fine here.
+std::mutex gRingsMutex;
+std::vector<std::shared_ptr<Ring>> gRings;
+
+// Hands a ring back to the pool when its thread exits, so short-lived
+// threads (e.g. async reads) reuse rings instead of growing the registry.
+struct RingHandle {
+  std::shared_ptr<Ring> ring;
+  RingHandle() {
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+    for (auto &candidate : gRings) {
+      bool expected = false;
+      if (candidate->owned.compare_exchange_strong(expected, true)) {
+        ring = candidate;
+        return;
+      }
+    }
+    ring = std::make_shared<Ring>();
+    ring->tid = gNextTid.fetch_add(1, std::memory_order_relaxed);
+    gRings.push_back(ring);
+  }
+  ~RingHandle() { ring->owned.store(false, std::memory_order_release); }
+};
+
+Ring &localRing() {
+  thread_local RingHandle handle;
+  return *handle.ring;
+}
+
+const char *eventName(Event event) {
+  switch (event) {
+  case Event::Create:
+    return "create";
+  case Event::Upload:
+    return "upload";
+  case Event::Dispatch:
+    return "dispatch";
+  case Event::Readback:
+    return "readback";
+  case Event::Compile:
+    return "compile";
+  case Event::Submit:
+    return "submit";
+  case Event::Sync:
+    return "sync";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+bool enabled() { return gEnabled.load(std::memory_order_relaxed); }
+
+void setEnabled(bool on) { gEnabled.store(on, std::memory_order_relaxed); }
+
+uint64_t nowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - gEpoch)
+          .count());
+}
+
+void record(Event event, uint64_t beginNs, uint64_t endNs, uint64_t bytes) {
+  Ring &ring = localRing();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  Slot &slot = ring.slots[head % kRingCapacity];
+  slot.seq.store(2 * head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.beginNs.store(beginNs, std::memory_order_relaxed);
+  slot.endNs.store(endNs, std::memory_order_relaxed);
+  slot.bytes.store(bytes, std::memory_order_relaxed);
+  slot.event.store(static_cast<uint8_t>(event), std::memory_order_relaxed);
+  slot.seq.store(2 * (head + 1), std::memory_order_release);
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool dump(const char *path) {
+  FILE *file = std::fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  std::fputs("{\"traceEvents\":[", file);
+  bool first = true;
+  {
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+    for (const auto &ring : gRings) {
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t begin = std::max<uint64_t>(
+          ring->start.load(std::memory_order_relaxed),
+          head - std::min<uint64_t>(head, kRingCapacity));
+      for (uint64_t i = begin; i < head; i++) {
+        // Spans overwritten since head was read are skipped.
+        Span span;
+        if (!readSpan(*ring, i, span)) {
+          continue;
+        }
+        std::fprintf(file,
+                     "%s\n{\"name\":\"%s\",\"cat\":\"minigpu\",\"ph\":\"X\","
+                     "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                     "\"args\":{\"bytes\":%llu}}",
+                     first ? "" : ",", eventName(span.event),
+                     span.beginNs / 1000.0,
+                     (span.endNs - span.beginNs) / 1000.0, ring->tid,
+                     static_cast<unsigned long long>(span.bytes));
+        first = false;
+      }
+    }
+  }
+  std::fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+  return std::fclose(file) == 0;
+}
+
+void clear() {
+  std::lock_guard<std::mutex> lock(gRingsMutex);
+  for (auto &ring : gRings) {
+    ring->start.store(ring->head.load(std::memory_order_acquire),
+                      std::memory_order_relaxed);
+  }
+}
+
+} // namespace trace
+} // namespace mgpu
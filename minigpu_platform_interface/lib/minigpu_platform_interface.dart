@@ -18,17 +18,112 @@ abstract class MinigpuPlatform {
   MinigpuPlatform registerInstance() =>
       throw UnimplementedError('No platform implementation available.');
 
-  Future<void> initializeContext();
+  /// Creates the GPU context. Without [options], the default adapter is used
+  /// and timestamp queries are enabled when available.
+  Future<void> initializeContext([MinigpuContextOptions? options]);
   void destroyContext();
+
+  /// Information about the adapter in use, or null when unavailable.
+  MinigpuAdapterInfo? get adapterInfo => null;
+
+  /// Limits granted to the device, or null when unavailable.
+  MinigpuLimits? get limits => null;
+
+  /// Whether the device was created with [feature].
+  bool hasFeature(MinigpuFeature feature) => false;
   PlatformComputeShader createComputeShader();
   PlatformBuffer createBuffer(int bufferSize);
+
+  /// Kernels kept registered at once; the native registry is bounded to the
+  /// same count.
+  static const int maxRegisteredKernels = 256;
+
+  /// Registers [source] for use in command lists and returns its kernel id.
+  /// Registering the same source again returns the same id. Past
+  /// [maxRegisteredKernels] kernels the least recently registered one is
+  /// released along with its pipeline, and its id becomes invalid.
+  int registerKernel(String source);
+  PlatformCommandList createCommandList();
+
+  /// Returns a list of [length] floats that uploads and readbacks can use
+  /// without an intermediate copy. Plain Dart memory where the platform has
+  /// no such allocation.
+  Float32List allocHostBuffer(int length) => Float32List(length);
+
+  /// Whether dispatches can be timed with GPU timestamp queries.
+  bool get timingSupported => false;
+
+  /// Turns timestamp-query timing of dispatches on or off. Ignored when
+  /// [timingSupported] is false.
+  void setTimingEnabled(bool enabled) {}
+
+  /// Stores compiled shaders and pipelines under [directory], limited to
+  /// [maxBytes], for devices created by later [initializeContext] calls.
+  /// Returns false when the platform has no persistent cache.
+  bool setCacheOptions(String directory, int maxBytes) => false;
+
+  /// Compiles [kernels] in the background so that their first dispatch
+  /// does not wait for the shader compiler. Completes once all of them have
+  /// compiled. Does nothing on platforms without a pipeline cache.
+  Future<void> precompile(List<String> kernels) async {}
+
+  /// Completes once every dispatch enqueued so far has finished on the GPU.
+  Future<void> sync() async {}
+
+  /// Returns the runtime counters accumulated since start or the last
+  /// [resetStats].
+  MinigpuStats getStats() =>
+      throw UnsupportedError('Stats are not supported on this platform.');
+
+  /// Clears the cumulative counters. Live buffer counts are kept.
+  void resetStats() =>
+      throw UnsupportedError('Stats are not supported on this platform.');
+
+  /// Turns runtime span tracing on or off.
+  void setTraceEnabled(bool enabled) =>
+      throw UnsupportedError('Tracing is not supported on this platform.');
+
+  /// Writes recorded spans to [path] as Chrome trace JSON. Returns whether
+  /// the file was written.
+  bool dumpTrace(String path) =>
+      throw UnsupportedError('Tracing is not supported on this platform.');
+
+  /// Drops all recorded spans.
+  void clearTrace() =>
+      throw UnsupportedError('Tracing is not supported on this platform.');
 }
 
 abstract class PlatformComputeShader {
   void loadKernelString(String kernelString);
   bool hasKernel();
   void setBuffer(int tag, PlatformBuffer buffer);
+
+  /// Binds [size] bytes of [buffer] starting at byte [offset]. A size of 0
+  /// binds the rest of the buffer.
+  void setBufferRange(int tag, PlatformBuffer buffer, int offset, int size);
   Future<void> dispatch(int groupsX, int groupsY, int groupsZ);
+
+  /// Records a dispatch on the context's stream without waiting for it.
+  void enqueue(int groupsX, int groupsY, int groupsZ);
+
+  /// GPU time of the last timed dispatch in nanoseconds, or 0.
+  int get lastGpuTimeNs;
+  void destroy();
+}
+
+/// Binds, dispatches, copies and uploads recorded on the host and executed
+/// in order by [submit], with one call into the runtime where the platform
+/// supports it. Dispatches and copies are enqueued, not waited for.
+abstract class PlatformCommandList {
+  void bind(
+      int kernel, int binding, PlatformBuffer buffer, int offset, int size);
+  void dispatch(int kernel, int groupsX, int groupsY, int groupsZ);
+  void copy(PlatformBuffer source, int sourceOffset, PlatformBuffer target,
+      int targetOffset, int size);
+  void upload(PlatformBuffer buffer, int offset, Float32List data);
+
+  /// Executes the recorded commands and clears the list for reuse.
+  void submit();
   void destroy();
 }
 
@@ -41,9 +136,158 @@ abstract class PlatformBuffer {
     int byteOffset = 0,
   });
   void setData(Float32List inputData, int size);
+
+  /// Zeroes [byteSize] bytes from [byteOffset] on the device; a [byteSize]
+  /// of 0 clears to the end. Both must be multiples of 4.
+  void clear({int byteOffset = 0, int byteSize = 0});
   void destroy();
 }
 
+enum MinigpuPowerPreference { defaultPower, lowPower, highPerformance }
+
+/// Optional device features. Kernels can check [Minigpu.hasFeature] to pick
+/// specialized variants.
+enum MinigpuFeature {
+  shaderF16,
+  subgroups,
+  timestampQuery;
+
+  /// Bit used for this feature by the native API.
+  int get bit => 1 << index;
+}
+
+/// How the adapter and device are chosen.
+///
+/// [requiredFeatures] make context creation fail when the adapter lacks
+/// them; [optionalFeatures] are enabled when available. Limits left at 0
+/// keep the WebGPU defaults and are clamped to the adapter's. Toggles are
+/// Dawn toggle names and only apply to native builds; [skipValidation]
+/// turns off Dawn's validation and should only be used for trusted kernels.
+final class MinigpuContextOptions {
+  const MinigpuContextOptions({
+    this.powerPreference = MinigpuPowerPreference.defaultPower,
+    this.requiredFeatures = const {},
+    this.optionalFeatures = const {MinigpuFeature.timestampQuery},
+    this.useAdapterLimits = false,
+    this.maxStorageBufferBindingSize = 0,
+    this.maxBufferSize = 0,
+    this.skipValidation = false,
+    this.enabledToggles = const [],
+    this.disabledToggles = const [],
+  });
+
+  final MinigpuPowerPreference powerPreference;
+  final Set<MinigpuFeature> requiredFeatures;
+  final Set<MinigpuFeature> optionalFeatures;
+
+  /// Requests every limit at the adapter's maximum.
+  final bool useAdapterLimits;
+  final int maxStorageBufferBindingSize;
+  final int maxBufferSize;
+  final bool skipValidation;
+  final List<String> enabledToggles;
+  final List<String> disabledToggles;
+}
+
+final class MinigpuAdapterInfo {
+  const MinigpuAdapterInfo({
+    required this.vendor,
+    required this.architecture,
+    required this.device,
+    required this.description,
+    required this.backendType,
+    required this.adapterType,
+    required this.vendorId,
+    required this.deviceId,
+  });
+
+  final String vendor;
+  final String architecture;
+  final String device;
+  final String description;
+
+  /// WGPUBackendType value.
+  final int backendType;
+
+  /// WGPUAdapterType value.
+  final int adapterType;
+  final int vendorId;
+  final int deviceId;
+
+  @override
+  String toString() => 'MinigpuAdapterInfo($description, vendor: $vendor, '
+      'architecture: $architecture, device: $device)';
+}
+
+final class MinigpuLimits {
+  const MinigpuLimits({
+    required this.maxBufferSize,
+    required this.maxStorageBufferBindingSize,
+    required this.maxStorageBuffersPerShaderStage,
+    required this.maxComputeWorkgroupStorageSize,
+    required this.maxComputeInvocationsPerWorkgroup,
+    required this.maxComputeWorkgroupSizeX,
+    required this.maxComputeWorkgroupSizeY,
+    required this.maxComputeWorkgroupSizeZ,
+    required this.maxComputeWorkgroupsPerDimension,
+    required this.minStorageBufferOffsetAlignment,
+  });
+
+  final int maxBufferSize;
+  final int maxStorageBufferBindingSize;
+  final int maxStorageBuffersPerShaderStage;
+  final int maxComputeWorkgroupStorageSize;
+  final int maxComputeInvocationsPerWorkgroup;
+  final int maxComputeWorkgroupSizeX;
+  final int maxComputeWorkgroupSizeY;
+  final int maxComputeWorkgroupSizeZ;
+  final int maxComputeWorkgroupsPerDimension;
+  final int minStorageBufferOffsetAlignment;
+}
+
+/// Snapshot of the runtime counters.
+///
+/// Live and peak figures cover buffers that have not been destroyed; the
+/// rest are cumulative. Times are in nanoseconds.
+final class MinigpuStats {
+  const MinigpuStats({
+    required this.liveBuffers,
+    required this.liveBytes,
+    required this.peakBytes,
+    required this.bytesUploaded,
+    required this.bytesDownloaded,
+    required this.dispatches,
+    required this.compiles,
+    required this.compileNs,
+    required this.pipelineCacheHits,
+    required this.queueWaits,
+    required this.queueWaitNs,
+  });
+
+  final int liveBuffers;
+  final int liveBytes;
+  final int peakBytes;
+  final int bytesUploaded;
+  final int bytesDownloaded;
+  final int dispatches;
+  final int compiles;
+  final int compileNs;
+  final int pipelineCacheHits;
+  final int queueWaits;
+  final int queueWaitNs;
+
+  /// Mean time spent blocked on the queue per wait.
+  double get avgQueueWaitNs => queueWaits == 0 ? 0 : queueWaitNs / queueWaits;
+
+  @override
+  String toString() => 'MinigpuStats(liveBuffers: $liveBuffers, '
+      'liveBytes: $liveBytes, peakBytes: $peakBytes, '
+      'bytesUploaded: $bytesUploaded, bytesDownloaded: $bytesDownloaded, '
+      'dispatches: $dispatches, compiles: $compiles, compileNs: $compileNs, '
+      'pipelineCacheHits: $pipelineCacheHits, queueWaits: $queueWaits, '
+      'avgQueueWaitNs: ${avgQueueWaitNs.toStringAsFixed(0)})';
+}
+
 final class MinigpuPlatformOutOfMemoryException implements Exception {
   @override
   String toString() => 'Out of memory';
@@ -118,6 +118,43 @@ void mgpuSetBuffer(MGPUComputeShader shader, int tag, MGPUBuffer buffer) {
   } finally {}
 }
 
+@JS('_mgpuSetBufferRange')
+external void _mgpuSetBufferRange(
+  MGPUComputeShader shader,
+  JSNumber tag,
+  MGPUBuffer buffer,
+  JSNumber offset,
+  JSNumber size,
+);
+
+void mgpuSetBufferRange(
+    MGPUComputeShader shader, int tag, MGPUBuffer buffer, int offset, int size) {
+  _mgpuSetBufferRange(shader, tag.toJS, buffer, offset.toJS, size.toJS);
+}
+
+@JS('_mgpuEnqueueDispatch')
+external void _mgpuEnqueueDispatch(
+  MGPUComputeShader shader,
+  JSNumber groupsX,
+  JSNumber groupsY,
+  JSNumber groupsZ,
+);
+
+void mgpuEnqueueDispatch(
+    MGPUComputeShader shader, int groupsX, int groupsY, int groupsZ) {
+  _mgpuEnqueueDispatch(shader, groupsX.toJS, groupsY.toJS, groupsZ.toJS);
+}
+
+Future<void> mgpuSync() async {
+  await ccall(
+    "mgpuSync".toJS,
+    "void".toJS,
+    <JSAny>[].toJSDeep,
+    <JSAny>[].toJSDeep,
+    {"async": true}.toJSDeep,
+  ).toDart;
+}
+
 Future<void> mgpuDispatch(
   MGPUComputeShader shader,
   int groupsX,
@@ -205,3 +242,14 @@ void mgpuSetBufferData(MGPUBuffer buffer, Float32List inputData, int size) {
     _mgpuSetBufferData(buffer, ptr, byteSize.toJS);
   } finally {}
 }
+
+@JS('_mgpuClearBuffer')
+external void _mgpuClearBuffer(
+  MGPUBuffer buffer,
+  JSNumber offset,
+  JSNumber byteSize,
+);
+
+void mgpuClearBuffer(MGPUBuffer buffer, int offset, int byteSize) {
+  _mgpuClearBuffer(buffer, offset.toJS, byteSize.toJS);
+}
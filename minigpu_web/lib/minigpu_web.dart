@@ -10,16 +10,33 @@ class MinigpuWeb extends MinigpuPlatform {
 
   static void registerWith(dynamic _) => MinigpuWeb._();
 
+  // Context options are not passed through to the browser adapter yet.
   @override
-  Future<void> initializeContext() async {
+  Future<void> initializeContext([MinigpuContextOptions? options]) async {
+    // Kernels of a context being replaced belong to its device.
+    _releaseKernels();
     await wasm.mgpuInitializeContext();
   }
 
   @override
   void destroyContext() {
+    _releaseKernels();
     wasm.mgpuDestroyContext();
   }
 
+  void _releaseKernels() {
+    for (final kernel in _kernels.values) {
+      kernel.destroy();
+    }
+    _kernels.clear();
+    _kernelIds.clear();
+  }
+
+  @override
+  Future<void> sync() async {
+    await wasm.mgpuSync();
+  }
+
   @override
   PlatformComputeShader createComputeShader() {
     final shader = wasm.mgpuCreateComputeShader();
@@ -31,6 +48,78 @@ class MinigpuWeb extends MinigpuPlatform {
     final buff = wasm.mgpuCreateBuffer(bufferSize);
     return WebBuffer(buff);
   }
+
+  // Registered kernels are plain shaders here; command lists replay their
+  // commands through the per-call bindings. Ids are listed least recently
+  // used first.
+  final Map<String, int> _kernelIds = {};
+  final Map<int, WebComputeShader> _kernels = {};
+  int _nextKernel = 0;
+
+  @override
+  int registerKernel(String source) {
+    final cached = _kernelIds.remove(source);
+    if (cached != null) return _kernelIds[source] = cached;
+    if (_kernelIds.length >= MinigpuPlatform.maxRegisteredKernels) {
+      _kernels.remove(_kernelIds.remove(_kernelIds.keys.first))!.destroy();
+    }
+    final shader = createComputeShader()..loadKernelString(source);
+    _kernels[_nextKernel] = shader as WebComputeShader;
+    return _kernelIds[source] = _nextKernel++;
+  }
+
+  @override
+  PlatformCommandList createCommandList() => WebCommandList(_kernels);
+}
+
+class WebCommandList implements PlatformCommandList {
+  WebCommandList(this._kernels);
+
+  final Map<int, WebComputeShader> _kernels;
+  final List<void Function()> _commands = [];
+
+  @override
+  void bind(
+      int kernel, int binding, PlatformBuffer buffer, int offset, int size) {
+    _commands.add(() {
+      if (offset == 0 && size == 0) {
+        _kernels[kernel]!.setBuffer(binding, buffer);
+      } else {
+        _kernels[kernel]!.setBufferRange(binding, buffer, offset, size);
+      }
+    });
+  }
+
+  @override
+  void dispatch(int kernel, int groupsX, int groupsY, int groupsZ) {
+    _commands.add(() => _kernels[kernel]!.enqueue(groupsX, groupsY, groupsZ));
+  }
+
+  @override
+  void copy(PlatformBuffer source, int sourceOffset, PlatformBuffer target,
+      int targetOffset, int size) {
+    throw UnsupportedError('Buffer copies are not available on the web yet');
+  }
+
+  @override
+  void upload(PlatformBuffer buffer, int offset, Float32List data) {
+    if (offset != 0) {
+      throw UnsupportedError('Offset uploads are not available on the web yet');
+    }
+    final copy = Float32List.fromList(data);
+    _commands.add(() => buffer.setData(copy, copy.length));
+  }
+
+  @override
+  void submit() {
+    for (final command in _commands) {
+      command();
+    }
+    _commands.clear();
+  }
+
+  @override
+  void destroy() => _commands.clear();
 }
 
 class WebComputeShader implements PlatformComputeShader {
@@ -54,11 +143,26 @@ class WebComputeShader implements PlatformComputeShader {
     wasm.mgpuSetBuffer(_shader, tag, (buffer as WebBuffer)._buffer);
   }
 
+  @override
+  void setBufferRange(int tag, PlatformBuffer buffer, int offset, int size) {
+    wasm.mgpuSetBufferRange(
+        _shader, tag, (buffer as WebBuffer)._buffer, offset, size);
+  }
+
+  @override
+  void enqueue(int groupsX, int groupsY, int groupsZ) {
+    wasm.mgpuEnqueueDispatch(_shader, groupsX, groupsY, groupsZ);
+  }
+
   @override
   Future<void> dispatch(int groupsX, int groupsY, int groupsZ) async {
     await wasm.mgpuDispatch(_shader, groupsX, groupsY, groupsZ);
   }
 
+  // Timestamp queries are not exposed on the web backend.
+  @override
+  int get lastGpuTimeNs => 0;
+
   @override
   void destroy() {
     wasm.mgpuDestroyComputeShader(_shader);
@@ -93,6 +197,11 @@ class WebBuffer implements PlatformBuffer {
     wasm.mgpuSetBufferData(_buffer, inputData, size);
   }
 
+  @override
+  void clear({int byteOffset = 0, int byteSize = 0}) {
+    wasm.mgpuClearBuffer(_buffer, byteOffset, byteSize);
+  }
+
   @override
   void destroy() {
     wasm.mgpuDestroyBuffer(_buffer);